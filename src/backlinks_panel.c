@@ -0,0 +1,157 @@
+#include <glib-object.h>
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "backlinks_panel.h"
+#include "editor_page.h"
+
+/* "Linked from" under the editor, the pages with links to the current one.
+ * Reads the backlinks the pages keep, so updating is proportional to the
+ * number of links to the page and not to the number of pages. */
+
+struct _NotesBacklinksPanel {
+  GtkBox parent;
+  EditorPage *page;
+  GtkWidget *title;
+  GtkWidget *links;
+};
+
+G_DEFINE_TYPE(NotesBacklinksPanel, notes_backlinks_panel, GTK_TYPE_BOX)
+
+static gint
+heading_cmp(gconstpointer a, gconstpointer b)
+{
+  EditorPage *pa = *((EditorPage **) a);
+  EditorPage *pb = *((EditorPage **) b);
+
+  return editor_page_cmp(pa, pb);
+}
+
+static void
+link_clicked(G_GNUC_UNUSED GtkButton *button, EditorPage *source)
+{
+  editor_page_switch_to(source);
+}
+
+static void
+update(NotesBacklinksPanel *self)
+{
+  GHashTable *backlinks;
+  GHashTableIter iter;
+  GPtrArray *sources;
+  GtkWidget *child;
+  EditorPage *source;
+
+  while ((child = gtk_widget_get_first_child(self->links)) != NULL) {
+    gtk_flow_box_remove(GTK_FLOW_BOX(self->links), child);
+  }
+
+  backlinks = editor_page_get_backlinks(self->page);
+  gtk_widget_set_visible(GTK_WIDGET(self), g_hash_table_size(backlinks) > 0);
+
+  sources = g_ptr_array_sized_new(g_hash_table_size(backlinks));
+  g_hash_table_iter_init(&iter, backlinks);
+  while (g_hash_table_iter_next(&iter, (gpointer *) &source, NULL)) {
+    g_ptr_array_add(sources, source);
+  }
+  g_ptr_array_sort(sources, heading_cmp);
+
+  for (guint i = 0; i < sources->len; i++) {
+    GtkWidget *button;
+    gchar *label;
+    guint count;
+
+    source = sources->pdata[i];
+    count = GPOINTER_TO_UINT(g_hash_table_lookup(backlinks, source));
+
+    if (count > 1) {
+      label = g_strdup_printf("%s (%u)", source->heading, count);
+    } else {
+      label = g_strdup(source->heading);
+    }
+
+    button = gtk_button_new_with_label(label);
+    gtk_widget_add_css_class(button, "flat");
+    g_signal_connect(button, "clicked", G_CALLBACK(link_clicked), source);
+    gtk_flow_box_append(GTK_FLOW_BOX(self->links), button);
+
+    g_free(label);
+  }
+
+  g_ptr_array_unref(sources);
+}
+
+static void
+backlinks_changed(G_GNUC_UNUSED EditorPage *page, NotesBacklinksPanel *self)
+{
+  update(self);
+}
+
+static void
+forget_page(NotesBacklinksPanel *self)
+{
+  if (self->page == NULL) {
+    return;
+  }
+
+  g_signal_handlers_disconnect_by_func(self->page, backlinks_changed, self);
+  g_clear_object(&self->page);
+}
+
+static void
+notes_backlinks_panel_dispose(GObject *obj)
+{
+  NotesBacklinksPanel *self = NOTES_BACKLINKS_PANEL(obj);
+
+  g_assert(self);
+
+  forget_page(self);
+
+  G_OBJECT_CLASS(notes_backlinks_panel_parent_class)->dispose(obj);
+}
+
+static void
+notes_backlinks_panel_class_init(NotesBacklinksPanelClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+  object_class->dispose = notes_backlinks_panel_dispose;
+}
+
+static void
+notes_backlinks_panel_init(NotesBacklinksPanel *self)
+{
+  self->title = gtk_label_new("Linked from");
+  gtk_widget_add_css_class(self->title, "heading");
+  gtk_label_set_xalign(GTK_LABEL(self->title), 0.0);
+  gtk_box_append(GTK_BOX(self), self->title);
+
+  self->links = gtk_flow_box_new();
+  gtk_flow_box_set_selection_mode(GTK_FLOW_BOX(self->links),
+                                  GTK_SELECTION_NONE);
+  gtk_box_append(GTK_BOX(self), self->links);
+
+  gtk_widget_set_visible(GTK_WIDGET(self), FALSE);
+}
+
+NotesBacklinksPanel *
+notes_backlinks_panel_new(void)
+{
+  return g_object_new(NOTES_TYPE_BACKLINKS_PANEL, "orientation",
+                      GTK_ORIENTATION_VERTICAL, "spacing", 5, NULL);
+}
+
+void
+notes_backlinks_panel_set_page(NotesBacklinksPanel *self, EditorPage *page)
+{
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+
+  forget_page(self);
+
+  self->page = g_object_ref(page);
+  g_signal_connect(page, "backlinks-changed", G_CALLBACK(backlinks_changed),
+                   self);
+
+  update(self);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glib-object.h>
+#include <gtk/gtk.h>
+
+#include "editor_page.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Type declaration.
+ */
+
+#define NOTES_TYPE_BACKLINKS_PANEL notes_backlinks_panel_get_type()
+G_DECLARE_FINAL_TYPE(NotesBacklinksPanel,
+                     notes_backlinks_panel,
+                     NOTES,
+                     BACKLINKS_PANEL,
+                     GtkBox)
+
+/*
+ * Method definitions.
+ */
+NotesBacklinksPanel *notes_backlinks_panel_new(void);
+
+void notes_backlinks_panel_set_page(NotesBacklinksPanel *self,
+                                    EditorPage *page);
+
+G_END_DECLS
@@ -0,0 +1,381 @@
+#include <glib.h>
+
+#include "batch.h"
+#include "editor_page.h"
+#include "link_graph.h"
+#include "markdown.h"
+
+/*
+ * The workspace without a window, for scripts and commit hooks:
+ *
+ *   check     files that can not be loaded and links to pages without a file
+ *   reformat  every file loaded into a page and written back through
+ *             editor_page_to_md, files that come out the same are left alone
+ *   stats     pages, links and tags of the workspace
+ *
+ * A pool of workers reads the files and checks their headers, checks and
+ * stats also parse the markdown there. None of that touches GTK. Pages and
+ * their buffers are GTK objects and stay in the calling thread, which
+ * reformats the files once the workers are done, each in a page of its own
+ * with placeholders for the pages it links to. What the files have in
+ * common, like the links between them, is worked out there too.
+ */
+
+typedef struct {
+  gchar *filename;
+  gchar *full_path;
+  /* The rest is filled in by a worker */
+  gchar *error;
+  /* Read by a worker, reformatted in the calling thread */
+  gchar *content;
+  /* From editor_page_header_problem, NULL when the file loads */
+  const gchar *problem;
+  gchar *heading;
+  /* Interned, as on pages */
+  GPtrArray *tags;
+  /* Headings of the linked pages */
+  GPtrArray *links;
+  gboolean rewritten;
+} BatchFile;
+
+static void
+batch_file_free(BatchFile *file)
+{
+  g_free(file->filename);
+  g_free(file->full_path);
+  g_free(file->error);
+  g_free(file->content);
+  g_free(file->heading);
+  g_ptr_array_unref(file->tags);
+  g_ptr_array_unref(file->links);
+  g_free(file);
+}
+
+static gint
+filename_cmp(gconstpointer a, gconstpointer b)
+{
+  const BatchFile *fa = *((BatchFile **) a);
+  const BatchFile *fb = *((BatchFile **) b);
+
+  return g_strcmp0(fa->filename, fb->filename);
+}
+
+/* The notes of the workspace, by file name so reports come out the same from
+ * run to run */
+static GPtrArray *
+list_files(const gchar *root_path, GError **error)
+{
+  const gchar *filename;
+  GPtrArray *files;
+  GDir *dir;
+
+  dir = g_dir_open(root_path, 0, error);
+  if (dir == NULL) {
+    return NULL;
+  }
+
+  files = g_ptr_array_new_with_free_func((GDestroyNotify) batch_file_free);
+
+  while ((filename = g_dir_read_name(dir))) {
+    BatchFile *file;
+
+    if (!g_str_has_suffix(filename, ".md")) {
+      continue;
+    }
+
+    file = g_malloc0(sizeof(*file));
+    file->filename = g_strdup(filename);
+    file->full_path = g_build_filename(root_path, filename, NULL);
+    file->tags = g_ptr_array_new_with_free_func(
+      (GDestroyNotify) g_ref_string_release);
+    file->links = g_ptr_array_new_with_free_func(g_free);
+    g_ptr_array_add(files, file);
+  }
+
+  g_dir_close(dir);
+
+  g_ptr_array_sort(files, filename_cmp);
+
+  return files;
+}
+
+static void
+read_links(BatchFile *file, const gchar *content)
+{
+  MarkdownDoc *md;
+
+  file->heading = editor_page_read_header(content, file->tags);
+
+  md = markdown_parse(markdown_skip_front_matter(content), -1);
+  for (guint i = 0; i < md->spans->len; i++) {
+    MarkdownSpan *span = &g_array_index(md->spans, MarkdownSpan, i);
+
+    if (span->type == MARKDOWN_SPAN_LINK) {
+      g_ptr_array_add(file->links, g_strdup(span->target));
+    }
+  }
+
+  markdown_doc_free(md);
+}
+
+static EditorPage *
+fetch_page(const gchar *heading, gpointer user_data)
+{
+  return g_hash_table_lookup((GHashTable *) user_data, heading);
+}
+
+static void
+page_created(EditorPage *page, GHashTable *pages)
+{
+  g_hash_table_insert(pages, page->heading, page);
+}
+
+/* Main thread only, the page and its buffer are GTK objects */
+static void
+reformat(BatchFile *file, gchar *content)
+{
+  GError *lerr = NULL;
+  GHashTable *pages;
+  EditorPage *page;
+  GString *md;
+
+  /* The page and the placeholders of the pages it links to, keyed by their
+   * interned headings */
+  pages = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                g_object_unref);
+
+  page = editor_page_load(content, fetch_page, pages, G_CALLBACK(page_created),
+                          pages);
+  editor_page_fix_content(page);
+  file->heading = g_strdup(page->heading);
+
+  md = editor_page_to_md(page);
+  if (g_strcmp0(md->str, content) != 0) {
+    if (g_file_set_contents(file->full_path, md->str, md->len, &lerr)) {
+      file->rewritten = TRUE;
+    } else {
+      file->error = g_strdup(lerr->message);
+      g_clear_error(&lerr);
+    }
+  }
+
+  g_string_free(md, TRUE);
+  g_hash_table_unref(pages);
+}
+
+/* Runs in a worker */
+static void
+process_file(BatchFile *file, gpointer user_data)
+{
+  BatchMode mode = GPOINTER_TO_INT(user_data);
+  GError *lerr = NULL;
+  gchar *content;
+
+  if (!g_file_get_contents(file->full_path, &content, NULL, &lerr)) {
+    file->error = g_strdup(lerr->message);
+    g_clear_error(&lerr);
+    return;
+  }
+
+  file->problem = editor_page_header_problem(content);
+  if (file->problem != NULL) {
+    g_free(content);
+  } else if (mode == BATCH_REFORMAT) {
+    file->content = content;
+  } else {
+    read_links(file, content);
+    g_free(content);
+  }
+}
+
+static guint
+report_check(GPtrArray *files)
+{
+  GHashTable *headings;
+  guint n_problems = 0;
+
+  /* Heading -> the first file with it, the editor can only show one */
+  headings = g_hash_table_new(g_str_hash, g_str_equal);
+  for (guint i = 0; i < files->len; i++) {
+    BatchFile *file = files->pdata[i];
+
+    if (file->heading != NULL &&
+        !g_hash_table_contains(headings, file->heading)) {
+      g_hash_table_insert(headings, file->heading, file);
+    }
+  }
+
+  for (guint i = 0; i < files->len; i++) {
+    BatchFile *file = files->pdata[i];
+    BatchFile *first;
+
+    if (file->error != NULL || file->problem != NULL) {
+      g_print("%s: %s\n", file->filename,
+              file->error != NULL ? file->error : file->problem);
+      n_problems++;
+      continue;
+    }
+
+    first = g_hash_table_lookup(headings, file->heading);
+    if (first != file) {
+      g_print("%s: Same title as %s\n", file->filename, first->filename);
+      n_problems++;
+    }
+
+    for (guint j = 0; j < file->links->len; j++) {
+      if (!g_hash_table_contains(headings, file->links->pdata[j])) {
+        g_print("%s: Link to \"%s\" has no file\n", file->filename,
+                (gchar *) file->links->pdata[j]);
+        n_problems++;
+      }
+    }
+  }
+
+  g_hash_table_unref(headings);
+
+  return n_problems;
+}
+
+static guint
+report_reformat(GPtrArray *files, guint *n_rewritten)
+{
+  guint n_problems = 0;
+
+  for (guint i = 0; i < files->len; i++) {
+    BatchFile *file = files->pdata[i];
+
+    if (file->error != NULL || file->problem != NULL) {
+      g_print("%s: %s\n", file->filename,
+              file->error != NULL ? file->error : file->problem);
+      n_problems++;
+    } else if (file->rewritten) {
+      g_print("%s: Reformatted\n", file->filename);
+      (*n_rewritten)++;
+    }
+  }
+
+  return n_problems;
+}
+
+static guint
+report_stats(GPtrArray *files)
+{
+  LinkGraph *graph = link_graph_new();
+  GHashTable *tags;
+  GPtrArray *names;
+  guint n_problems = 0;
+  guint n_pages = 0;
+
+  /* Tags are interned, one pointer per name */
+  tags = g_hash_table_new(NULL, NULL);
+
+  for (guint i = 0; i < files->len; i++) {
+    BatchFile *file = files->pdata[i];
+
+    if (file->heading == NULL) {
+      n_problems++;
+      continue;
+    }
+
+    n_pages++;
+    link_graph_add_page(graph, file->heading);
+    for (guint j = 0; j < file->links->len; j++) {
+      link_graph_add_link(graph, file->heading, file->links->pdata[j]);
+    }
+    for (guint j = 0; j < file->tags->len; j++) {
+      g_hash_table_add(tags, file->tags->pdata[j]);
+    }
+  }
+
+  g_print("%-12s %u\n", "Files", files->len);
+  g_print("%-12s %u\n", "Pages", n_pages);
+  g_print("%-12s %u\n", "Links", link_graph_n_links(graph));
+  g_print("%-12s %u\n", "Tags", g_hash_table_size(tags));
+
+  names = link_graph_orphans(graph);
+  g_print("%-12s %u\n", "Orphans", names->len);
+  g_ptr_array_unref(names);
+
+  names = link_graph_dangling(graph);
+  g_print("%-12s %u\n", "Dangling", names->len);
+  g_ptr_array_unref(names);
+
+  names = link_graph_clusters(graph);
+  g_print("%-12s %u\n", "Clusters", names->len);
+  g_ptr_array_unref(names);
+
+  g_hash_table_unref(tags);
+  link_graph_free(graph);
+
+  return n_problems;
+}
+
+/* Exit status for the command line: 0 when all is well, 1 when a file has a
+ * problem and 2 when the workspace can not be read at all */
+gint
+batch_run(BatchMode mode, const gchar *root_path)
+{
+  GError *lerr = NULL;
+  GThreadPool *pool;
+  GPtrArray *files;
+  GTimer *timer;
+  gdouble elapsed;
+  guint n_problems = 0;
+  guint n_rewritten = 0;
+
+  g_return_val_if_fail(root_path != NULL, 2);
+
+  timer = g_timer_new();
+
+  files = list_files(root_path, &lerr);
+  if (files == NULL) {
+    g_printerr("Could not read %s: %s\n", root_path, lerr->message);
+    g_clear_error(&lerr);
+    g_timer_destroy(timer);
+    return 2;
+  }
+
+  pool = g_thread_pool_new((GFunc) process_file, GINT_TO_POINTER(mode),
+                           (gint) g_get_num_processors(), FALSE, NULL);
+  for (guint i = 0; i < files->len; i++) {
+    g_thread_pool_push(pool, files->pdata[i], NULL);
+  }
+  /* Returns once every file is done */
+  g_thread_pool_free(pool, FALSE, TRUE);
+
+  if (mode == BATCH_REFORMAT) {
+    for (guint i = 0; i < files->len; i++) {
+      BatchFile *file = files->pdata[i];
+
+      if (file->content != NULL) {
+        reformat(file, file->content);
+        g_clear_pointer(&file->content, g_free);
+      }
+    }
+  }
+
+  elapsed = g_timer_elapsed(timer, NULL);
+
+  switch (mode) {
+  case BATCH_CHECK:
+    n_problems = report_check(files);
+    g_printerr("%u files, %u problems, %.0f ms\n", files->len, n_problems,
+               elapsed * 1000);
+    break;
+  case BATCH_REFORMAT:
+    n_problems = report_reformat(files, &n_rewritten);
+    g_printerr("%u files, %u reformatted, %u problems, %.0f ms\n", files->len,
+               n_rewritten, n_problems, elapsed * 1000);
+    break;
+  case BATCH_STATS:
+    n_problems = report_stats(files);
+    g_printerr("%u files, %u not loaded, %.0f ms\n", files->len, n_problems,
+               elapsed * 1000);
+    break;
+  }
+
+  g_ptr_array_unref(files);
+  g_timer_destroy(timer);
+
+  return n_problems > 0 ? 1 : 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+  BATCH_CHECK,
+  BATCH_REFORMAT,
+  BATCH_STATS,
+} BatchMode;
+
+gint batch_run(BatchMode mode, const gchar *root_path);
+
+G_END_DECLS
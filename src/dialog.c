@@ -5,6 +5,7 @@
 
 #include "dialog.h"
 
+/* The dialog is dropped once it answers, with the user data set on it */
 static void
 file_chooser_cb(GtkNativeDialog *source_object, int response)
 {
@@ -13,12 +14,19 @@ file_chooser_cb(GtkNativeDialog *source_object, int response)
   GFile *file = NULL;
 
   if (response != GTK_RESPONSE_ACCEPT) {
+    g_object_unref(source_object);
     return;
   }
 
   cb = g_object_get_data(G_OBJECT(source_object), "calback");
   user_data = g_object_get_data(G_OBJECT(source_object), "calback_userdata");
-  file = gtk_file_chooser_get_current_folder(GTK_FILE_CHOOSER(source_object));
+  if (gtk_file_chooser_get_action(GTK_FILE_CHOOSER(source_object)) ==
+      GTK_FILE_CHOOSER_ACTION_SAVE) {
+    file = gtk_file_chooser_get_file(GTK_FILE_CHOOSER(source_object));
+  } else {
+    file = gtk_file_chooser_get_current_folder(
+      GTK_FILE_CHOOSER(source_object));
+  }
 
   if (file == NULL) {
     g_warning("Error opening file");
@@ -27,6 +35,8 @@ file_chooser_cb(GtkNativeDialog *source_object, int response)
 
     g_clear_object(&file);
   }
+
+  g_object_unref(source_object);
 }
 
 void
@@ -47,4 +57,28 @@ dialog_folder_select(GtkWindow *parent,
 
   g_signal_connect(native, "response", G_CALLBACK(file_chooser_cb), NULL);
   gtk_native_dialog_show(GTK_NATIVE_DIALOG(native));
-}
\ No newline at end of file
+}
+
+void
+dialog_file_save(GtkWindow *parent,
+                 const gchar *title,
+                 const gchar *yes,
+                 const gchar *suggested_name,
+                 dialog_cb cb,
+                 gpointer user_data,
+                 GDestroyNotify destroy)
+{
+  GtkFileChooserNative *native;
+  GtkFileChooserAction action = GTK_FILE_CHOOSER_ACTION_SAVE;
+
+  native = gtk_file_chooser_native_new(title, parent, action, yes, "_Cancel");
+  gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(native), suggested_name);
+
+  /* Lives as long as the dialog, the window it came from may not */
+  g_object_set_data(G_OBJECT(native), "calback", cb);
+  g_object_set_data_full(G_OBJECT(native), "calback_userdata", user_data,
+                         destroy);
+
+  g_signal_connect(native, "response", G_CALLBACK(file_chooser_cb), NULL);
+  gtk_native_dialog_show(GTK_NATIVE_DIALOG(native));
+}
@@ -13,4 +13,12 @@ void dialog_folder_select(GtkWindow *parent,
                              dialog_cb cb,
                              gpointer user_data);
 
+void dialog_file_save(GtkWindow *parent,
+                      const gchar *title,
+                      const gchar *yes,
+                      const gchar *suggested_name,
+                      dialog_cb cb,
+                      gpointer user_data,
+                      GDestroyNotify destroy);
+
 G_END_DECLS
\ No newline at end of file
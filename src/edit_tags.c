@@ -3,146 +3,217 @@
 
 #include "edit_tags.h"
 #include "editor_page.h"
+#include "notes_tag.h"
 #include "notes_tag_list.h"
 
+/* One window for all pages, made the first time tags are edited and shown
+ * again for whichever page is current */
+typedef struct {
+  GtkWidget *window;
+  GtkWidget *title;
+  /* Tags on the page, one row each */
+  GtkWidget *tags;
+  GtkWidget *drop_down;
+  GtkWidget *entry;
+  /* Lets through the tags of the list the page does not have */
+  GtkFilter *filter;
+  NotesTagList *tags_list;
+  EditorPage *page;
+} EditTags;
+
+static void fill_tags(EditTags *self);
+
+static void
+edit_tags_free(EditTags *self)
+{
+  gtk_window_destroy(GTK_WINDOW(self->window));
+  g_clear_object(&self->filter);
+  g_clear_object(&self->page);
+  g_free(self);
+}
+
+/* The tags of the page changed, what can be added changes with them */
+static void
+tags_changed(EditTags *self)
+{
+  fill_tags(self);
+  gtk_filter_changed(self->filter, GTK_FILTER_CHANGE_DIFFERENT);
+}
+
 static void
 removed_clicked(GObject *button, gchar *tag_name)
 {
-  EditorPage *page;
-  GtkWidget *label;
-  guint index;
+  EditTags *self = g_object_get_data(button, "edit_tags");
 
-  page = g_object_get_data(button, "page");
-  label = g_object_get_data(button, "label");
+  if (notes_tag_list_remove_tag(self->tags_list, self->page, tag_name)) {
+    tags_changed(self);
+  }
+}
+
+static void
+add_tag(EditTags *self, const gchar *tag)
+{
+  if (tag == NULL || tag[0] == '\0') {
+    return;
+  }
 
-  if (g_ptr_array_find_with_equal_func(page->tags, tag_name, g_str_equal,
-                                       &index)) {
-    g_ptr_array_remove_index(page->tags, index);
-    gtk_widget_hide(GTK_WIDGET(button));
-    gtk_widget_hide(GTK_WIDGET(label));
+  if (notes_tag_list_add_tag(self->tags_list, self->page, tag)) {
+    tags_changed(self);
   }
 }
 
 static void
-add_tag_to_grid(GtkGrid *grid, const gchar *tag, guint row, EditorPage *page)
+add_selected_clicked(G_GNUC_UNUSED GtkButton *button, EditTags *self)
 {
-  GtkWidget *l = gtk_label_new(tag);
-  GtkWidget *b = gtk_button_new_from_icon_name("edit-delete");
-
-  gtk_grid_attach(grid, l, 0, row, 5, 1);
-  gtk_grid_attach(grid, b, 6, row, 1, 1);
-  g_object_set_data(G_OBJECT(b), "page", page);
-  g_object_set_data(G_OBJECT(b), "label", l);
-  g_signal_connect_data(G_OBJECT(b), "clicked", G_CALLBACK(removed_clicked),
-                        g_strdup(tag), (GClosureNotify) g_free, 0);
+  NotesTag *tag = gtk_drop_down_get_selected_item(
+    GTK_DROP_DOWN(self->drop_down));
+
+  if (tag != NULL) {
+    add_tag(self, notes_tag_name(tag));
+  }
 }
 
+/* The button or enter in the entry */
 static void
-add_clicked(GObject *button, GtkGrid *grid)
+add_new_clicked(G_GNUC_UNUSED GtkWidget *widget, EditTags *self)
 {
-  EditorPage *page;
-  GtkDropDown *drop_down = NULL;
-  GtkEntry *entry = NULL;
-  GtkEntryBuffer *buffer = NULL;
-  const gchar *tag = NULL;
-  NotesTagList *tags_list;
+  GtkEntryBuffer *buffer = gtk_entry_get_buffer(GTK_ENTRY(self->entry));
 
-  page = g_object_get_data(button, "page");
-  tags_list = g_object_get_data(button, "tags_list");
-  drop_down = g_object_get_data(button, "drop_down");
-  entry = g_object_get_data(button, "entry");
-
-  if (entry != NULL) {
-    buffer = gtk_entry_get_buffer(entry);
-    tag = gtk_entry_buffer_get_text(buffer);
-  } else if (drop_down != NULL) {
-    tag = gtk_string_object_get_string(
-      GTK_STRING_OBJECT(gtk_drop_down_get_selected_item(drop_down)));
+  add_tag(self, gtk_entry_buffer_get_text(buffer));
+  gtk_entry_buffer_set_text(buffer, "", 0);
+}
+
+static void
+fill_tags(EditTags *self)
+{
+  GtkWidget *child;
+
+  while ((child = gtk_widget_get_first_child(self->tags)) != NULL) {
+    gtk_list_box_remove(GTK_LIST_BOX(self->tags), child);
   }
 
-  if (tag != NULL) {
-    g_ptr_array_add(page->tags, g_strdup(tag));
-    add_tag_to_grid(grid, tag, page->tags->len, page);
-    notes_tag_list_add(tags_list, page);
+  for (guint i = 0; i < self->page->tags->len; i++) {
+    const gchar *tag = self->page->tags->pdata[i];
+    GtkWidget *row = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+    GtkWidget *l = gtk_label_new(tag);
+    GtkWidget *b = gtk_button_new_from_icon_name("edit-delete");
+
+    gtk_label_set_xalign(GTK_LABEL(l), 0.0);
+    gtk_widget_set_hexpand(l, TRUE);
+    gtk_box_append(GTK_BOX(row), l);
+    gtk_box_append(GTK_BOX(row), b);
+
+    g_object_set_data(G_OBJECT(b), "edit_tags", self);
+    g_signal_connect_data(G_OBJECT(b), "clicked", G_CALLBACK(removed_clicked),
+                          g_ref_string_acquire((gchar *) tag),
+                          (GClosureNotify) g_ref_string_release, 0);
+
+    gtk_list_box_append(GTK_LIST_BOX(self->tags), row);
   }
 }
 
-void
-edit_tags_show(EditorPage *page, NotesTagList *tags_list)
+static gboolean
+not_on_page(gpointer item, gpointer user_data)
 {
-  GtkWidget *title;
-  GtkWidget *window;
+  EditTags *self = user_data;
+
+  /* Both are interned */
+  return self->page != NULL &&
+         !g_ptr_array_find(self->page->tags, notes_tag_name(item), NULL);
+}
+
+static gchar *
+tag_name(NotesTag *tag)
+{
+  return g_strdup(notes_tag_name(tag));
+}
+
+static EditTags *
+edit_tags_new(NotesTagList *tags_list)
+{
+  EditTags *self = g_malloc0(sizeof(*self));
+  GtkFilterListModel *available;
   GtkWidget *header;
   GtkWidget *scroll;
   GtkWidget *box;
-  GtkWidget *tag_grid;
-  GtkWidget *add;
-  GtkWidget *drop_down;
   GtkWidget *add_grid;
+  GtkWidget *add;
   GtkWidget *new_tag;
-  GtkWidget *write_new_tag;
-  gchar *heading;
-  gchar **tags_opts;
-  GtkStringList *available_tags;
-  guint lines;
 
-  heading = g_strdup_printf("Tags for %s", page->heading);
-  window = adw_window_new();
-  title = adw_window_title_new(heading, NULL);
-  header = adw_header_bar_new();
+  self->tags_list = tags_list;
 
-  box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
-  tag_grid = gtk_grid_new();
-  add_grid = gtk_grid_new();
-
-  gtk_grid_set_column_spacing(GTK_GRID(tag_grid), 5);
-  gtk_grid_set_column_spacing(GTK_GRID(add_grid), 5);
-
-  for (lines = 0; lines < page->tags->len; lines++) {
-    add_tag_to_grid(GTK_GRID(tag_grid), page->tags->pdata[lines], lines, page);
-  }
+  self->window = adw_window_new();
+  gtk_window_set_hide_on_close(GTK_WINDOW(self->window), TRUE);
+  gtk_window_set_default_size(GTK_WINDOW(self->window), 800, 800);
 
-  tags_opts = notes_tag_list_get_tags_not_on_page(tags_list, page);
-  available_tags = gtk_string_list_new(NULL);
-
-  for (guint i = 0; tags_opts[i] != NULL; i++) {
-    gtk_string_list_append(available_tags, tags_opts[i]);
-  }
-
-  drop_down = gtk_drop_down_new(G_LIST_MODEL(available_tags), NULL);
+  self->title = adw_window_title_new("", NULL);
+  header = adw_header_bar_new();
+  adw_header_bar_set_title_widget(ADW_HEADER_BAR(header), self->title);
+
+  self->tags = gtk_list_box_new();
+  gtk_list_box_set_selection_mode(GTK_LIST_BOX(self->tags),
+                                  GTK_SELECTION_NONE);
+
+  /* Follows the tag list as tags come and go */
+  self->filter = GTK_FILTER(gtk_custom_filter_new(not_on_page, self, NULL));
+  available = gtk_filter_list_model_new(
+    G_LIST_MODEL(g_object_ref(notes_tag_list_get_model(tags_list))),
+    g_object_ref(self->filter));
+  self->drop_down = gtk_drop_down_new(
+    G_LIST_MODEL(available),
+    gtk_cclosure_expression_new(G_TYPE_STRING, NULL, 0, NULL,
+                                G_CALLBACK(tag_name), NULL, NULL));
 
   add = gtk_button_new_with_label("Add selected");
-  g_object_set_data(G_OBJECT(add), "drop_down", drop_down);
-  g_object_set_data(G_OBJECT(add), "page", page);
-  g_object_set_data(G_OBJECT(add), "tags_list", tags_list);
-  g_signal_connect(add, "clicked", G_CALLBACK(add_clicked), tag_grid);
-
-  gtk_grid_attach(GTK_GRID(add_grid), drop_down, 0, 0, 1, 1);
-  gtk_grid_attach(GTK_GRID(add_grid), add, 1, 0, 1, 1);
+  g_signal_connect(add, "clicked", G_CALLBACK(add_selected_clicked), self);
 
+  self->entry = gtk_entry_new();
   new_tag = gtk_button_new_with_label("Add new tag");
-  write_new_tag = gtk_entry_new();
-  g_object_set_data(G_OBJECT(new_tag), "entry", write_new_tag);
-  g_object_set_data(G_OBJECT(new_tag), "page", page);
-  g_object_set_data(G_OBJECT(new_tag), "tags_list", tags_list);
-  g_signal_connect(new_tag, "clicked", G_CALLBACK(add_clicked), tag_grid);
+  g_signal_connect(new_tag, "clicked", G_CALLBACK(add_new_clicked), self);
+  g_signal_connect(self->entry, "activate", G_CALLBACK(add_new_clicked),
+                   self);
 
-  gtk_grid_attach(GTK_GRID(add_grid), write_new_tag, 0, 1, 1, 1);
+  add_grid = gtk_grid_new();
+  gtk_grid_set_column_spacing(GTK_GRID(add_grid), 5);
+  gtk_grid_attach(GTK_GRID(add_grid), self->drop_down, 0, 0, 1, 1);
+  gtk_grid_attach(GTK_GRID(add_grid), add, 1, 0, 1, 1);
+  gtk_grid_attach(GTK_GRID(add_grid), self->entry, 0, 1, 1, 1);
   gtk_grid_attach(GTK_GRID(add_grid), new_tag, 1, 1, 1, 1);
 
+  box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+  gtk_box_append(GTK_BOX(box), header);
+  gtk_box_append(GTK_BOX(box), self->tags);
+  gtk_box_append(GTK_BOX(box), add_grid);
+
   scroll = gtk_scrolled_window_new();
   gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scroll), box);
-  adw_window_set_content(ADW_WINDOW(window), scroll);
-  gtk_window_set_default_size(GTK_WINDOW(window), 800, 800);
-  adw_header_bar_set_title_widget(ADW_HEADER_BAR(header), title);
+  adw_window_set_content(ADW_WINDOW(self->window), scroll);
 
-  gtk_box_append(GTK_BOX(box), header);
+  return self;
+}
 
-  gtk_box_append(GTK_BOX(box), tag_grid);
-  gtk_box_append(GTK_BOX(box), add_grid);
+void
+edit_tags_show(EditorPage *page, NotesTagList *tags_list)
+{
+  EditTags *self;
+  gchar *heading;
+
+  g_return_if_fail(page != NULL);
+  g_return_if_fail(tags_list != NULL);
 
-  g_object_set_data(G_OBJECT(window), "tags_list", tags_list);
-  gtk_window_present(GTK_WINDOW(window));
+  self = g_object_get_data(G_OBJECT(tags_list), "edit_tags");
+  if (self == NULL) {
+    self = edit_tags_new(tags_list);
+    g_object_set_data_full(G_OBJECT(tags_list), "edit_tags", self,
+                           (GDestroyNotify) edit_tags_free);
+  }
+
+  g_set_object(&self->page, page);
+
+  heading = g_strdup_printf("Tags for %s", page->heading);
+  adw_window_title_set_title(ADW_WINDOW_TITLE(self->title), heading);
   g_free(heading);
-  g_strfreev(tags_opts);
+
+  tags_changed(self);
+  gtk_window_present(GTK_WINDOW(self->window));
 }
@@ -4,8 +4,13 @@
 #include <gtk/gtk.h>
 #include <yaml.h>
 
+#include "fuzzy.h"
+#include "markdown.h"
 #include "utils.h"
 
+/* Pastes at least this large are parsed in a worker thread */
+#define PASTE_WORKER_LEN (64 * 1024)
+
 G_DEFINE_TYPE(EditorPage, editor_page, G_TYPE_OBJECT)
 
 typedef enum {
@@ -21,6 +26,8 @@ static GParamSpec *obj_properties[N_PROPERTIES] = {
 enum editor_page_signals {
   EDITOR_PAGE_SWITCH = 0,
   EDITOR_PAGE_NEW_ANCHOR,
+  EDITOR_PAGE_EDITED,
+  EDITOR_PAGE_BACKLINKS_CHANGED,
   EDITOR_PAGE_LAST
 };
 
@@ -34,6 +41,19 @@ struct add_link_ctx {
   EditorPage *page;
 };
 
+/* Pasted markdown waiting to be styled */
+struct paste_ctx {
+  GtkTextMark *start_mark;
+  GtkTextMark *stop_mark;
+  gchar *text;
+  /* Characters of text, the range has to hold exactly those */
+  gint n_chars;
+  /* page->changes at paste-done, a worker result only applies while it holds */
+  guint changes;
+  /* Parsing left the text as it was, only styles are added */
+  gboolean same_text;
+};
+
 enum yaml_items {
   YAML_EVENT_NONE = 0,
   YAML_EVENT_TITLE,
@@ -46,13 +66,15 @@ static const char *available_styles[] = {
   "Heading 1",        "Heading 2", "Heading 3", NULL
 };
 
-/* Parse the YAML header in the files */
-static void
+/* Parse the YAML header in the files. FALSE if the YAML broke before the
+ * end of the front matter, the body after it is not YAML and may break it */
+static gboolean
 parse_header(const gchar *input, gchar **title, gchar **draft, GPtrArray *tags)
 {
   yaml_parser_t parser = { 0 };
   yaml_event_t event = { 0 };
   enum yaml_items current = YAML_EVENT_NONE;
+  gboolean header_read = FALSE;
 
   yaml_parser_initialize(&parser);
   yaml_parser_set_input_string(&parser, (const guchar *) input, strlen(input));
@@ -62,6 +84,9 @@ parse_header(const gchar *input, gchar **title, gchar **draft, GPtrArray *tags)
       yaml_event_delete(&event);
       break;
     }
+    if (event.type == YAML_DOCUMENT_END_EVENT) {
+      header_read = TRUE;
+    }
 
     if (event.type == YAML_SCALAR_EVENT) {
       switch (current) {
@@ -83,7 +108,8 @@ parse_header(const gchar *input, gchar **title, gchar **draft, GPtrArray *tags)
         current = YAML_EVENT_NONE;
         break;
       case YAML_EVENT_TAG:
-        g_ptr_array_add(tags, g_strdup((gchar *) event.data.scalar.value));
+        g_ptr_array_add(tags, g_ref_string_new_intern(
+                                (gchar *) event.data.scalar.value));
         break;
       }
     } else if (event.type == YAML_SEQUENCE_END_EVENT) {
@@ -94,6 +120,8 @@ parse_header(const gchar *input, gchar **title, gchar **draft, GPtrArray *tags)
   }
 
   yaml_parser_delete(&parser);
+
+  return header_read;
 }
 
 static gboolean
@@ -151,17 +179,88 @@ validate_name_only(const gchar *name)
   return TRUE;
 }
 
+static EditorPage *
+fetch_or_create(EditorPage *page, const gchar *name)
+{
+  EditorPage *other = NULL;
+
+  if (page->fetch_page != NULL) {
+    other = page->fetch_page(name, page->fetch_page_user_data);
+  }
+
+  if (!other) {
+    other = editor_page_new(name, NULL, page->fetch_page,
+                            page->fetch_page_user_data, page->created_cb,
+                            page->user_data);
+  }
+
+  return other;
+}
+
+static void
+link_pages(EditorPage *source, EditorPage *target)
+{
+  guint count;
+
+  count = GPOINTER_TO_UINT(g_hash_table_lookup(target->backlinks, source));
+  g_hash_table_insert(target->backlinks, source, GUINT_TO_POINTER(count + 1));
+
+  g_signal_emit(target, editor_signals[EDITOR_PAGE_BACKLINKS_CHANGED], 0);
+}
+
+static void
+unlink_pages(EditorPage *source, EditorPage *target)
+{
+  guint count;
+
+  count = GPOINTER_TO_UINT(g_hash_table_lookup(target->backlinks, source));
+  if (count <= 1) {
+    g_hash_table_remove(target->backlinks, source);
+  } else {
+    g_hash_table_insert(target->backlinks, source,
+                        GUINT_TO_POINTER(count - 1));
+  }
+
+  g_signal_emit(target, editor_signals[EDITOR_PAGE_BACKLINKS_CHANGED], 0);
+}
+
+/* No widgets are created here, whoever shows the page adds a button for the
+ * anchor. That keeps pages usable without a display. */
+static GtkTextChildAnchor *
+insert_anchor(EditorPage *page, GtkTextIter *iter, EditorPage *other)
+{
+  GtkTextChildAnchor *anchor;
+
+  anchor = gtk_text_buffer_create_child_anchor(page->content, iter);
+
+  /* Kept alive by the link, its backlinks are still there to unlink when
+   * this page goes, whichever of the two is released first */
+  g_object_set_data_full(G_OBJECT(anchor), "target", g_object_ref(other),
+                         g_object_unref);
+
+  g_ptr_array_add(page->anchors, g_object_ref(anchor));
+
+  /* The links of an evicted page were never unlinked. Restoring gets the
+   * pages they were evicted with, not a lookup by name, so the counts kept
+   * meanwhile belong to the very pages the anchors go back to. */
+  if (!page->restoring) {
+    link_pages(page, other);
+  }
+
+  /* EMIT new anchor */
+  g_signal_emit(page, editor_signals[EDITOR_PAGE_NEW_ANCHOR], 0, anchor);
+
+  return anchor;
+}
+
 static gboolean
 add_link_anchor(gpointer user_data)
 {
   struct add_link_ctx *ctx = (struct add_link_ctx *) user_data;
-  EditorPage *other = NULL;
   GtkTextBuffer *buffer;
   GtkTextIter start, end;
   // GtkWidget *label;
   gchar *name;
-  GtkTextChildAnchor *anchor;
-  GtkWidget *button;
 
   buffer = ctx->page->content;
   /*
@@ -180,35 +279,209 @@ add_link_anchor(gpointer user_data)
   gtk_text_iter_forward_char(&end);
   gtk_text_buffer_delete(buffer, &start, &end);
 
-  anchor = gtk_text_buffer_create_child_anchor(buffer, &start);
+  insert_anchor(ctx->page, &start, fetch_or_create(ctx->page, name));
+
+  g_free(name);
+  g_free(ctx);
 
-  if (ctx->page->fetch_page != NULL) {
-    other = ctx->page->fetch_page(name, ctx->page->fetch_page_user_data);
+  return FALSE;
+}
+
+static void
+paste_ctx_free(gpointer data)
+{
+  struct paste_ctx *ctx = (struct paste_ctx *) data;
+  GtkTextBuffer *buffer;
+
+  if (ctx == NULL) {
+    return;
   }
 
-  if (!other) {
-    other = editor_page_new(name, NULL, ctx->page->fetch_page,
-                            ctx->page->fetch_page_user_data,
-                            ctx->page->created_cb, ctx->page->user_data);
+  buffer = gtk_text_mark_get_buffer(ctx->start_mark);
+  if (buffer != NULL) {
+    gtk_text_buffer_delete_mark(buffer, ctx->start_mark);
+    gtk_text_buffer_delete_mark(buffer, ctx->stop_mark);
   }
 
-  g_object_set_data(G_OBJECT(anchor), "target", other);
+  g_object_unref(ctx->start_mark);
+  g_object_unref(ctx->stop_mark);
+  g_free(ctx->text);
+  g_free(ctx);
+}
 
-  g_ptr_array_add(ctx->page->anchors, g_object_ref(anchor));
+static void
+remember_paste(EditorPage *page,
+               const GtkTextIter *location,
+               const gchar *text,
+               gint len)
+{
+  struct paste_ctx *ctx;
 
-  // gtk_text_view_add_child_at_anchor(textarea, widget, anchor);
-  /* EMIT new anchor */
-  button = editor_page_in_content_button(other);
-  g_object_set_data(G_OBJECT(button), "anchor", anchor);
-  g_object_set_data(G_OBJECT(button), "target", ctx->page);
+  if (page->programmatic) {
+    return;
+  }
 
-  g_signal_emit(ctx->page, editor_signals[EDITOR_PAGE_NEW_ANCHOR], 0, anchor,
-                button);
+  /* Only worth the round trip through the parser if there is markup */
+  if (memchr(text, '#', len) == NULL && memchr(text, '*', len) == NULL &&
+      memchr(text, '`', len) == NULL && memchr(text, '[', len) == NULL) {
+    return;
+  }
 
-  g_free(name);
-  g_free(ctx);
+  g_clear_pointer(&page->paste, paste_ctx_free);
 
-  return FALSE;
+  ctx = g_malloc0(sizeof(*ctx));
+  ctx->text = g_strndup(text, len);
+  ctx->n_chars = g_utf8_strlen(text, len);
+  /* Left gravity stays before the inserted text, right gravity follows it */
+  ctx->start_mark = g_object_ref(
+    gtk_text_buffer_create_mark(page->content, NULL, location, TRUE));
+  ctx->stop_mark = g_object_ref(
+    gtk_text_buffer_create_mark(page->content, NULL, location, FALSE));
+
+  page->paste = ctx;
+}
+
+/* Replace the raw pasted text with the parsed text, its styles and links in
+ * a single user action */
+static void
+apply_paste(EditorPage *page, struct paste_ctx *ctx, MarkdownDoc *doc)
+{
+  GtkTextBuffer *buffer = page->content;
+  GtkTextIter start;
+  GtkTextIter stop;
+  gint offset;
+
+  if (!editor_page_is_resident(page) ||
+      gtk_text_mark_get_buffer(ctx->start_mark) != buffer) {
+    /* The buffer was released, it keeps the pasted text as is */
+    return;
+  }
+
+  gtk_text_buffer_get_iter_at_mark(buffer, &start, ctx->start_mark);
+  gtk_text_buffer_get_iter_at_mark(buffer, &stop, ctx->stop_mark);
+
+  offset = gtk_text_iter_get_offset(&start);
+
+  if (page->changes != ctx->changes ||
+      gtk_text_iter_get_offset(&stop) - offset != ctx->n_chars) {
+    g_debug("Pasted text was edited before it could be styled");
+    return;
+  }
+
+  page->programmatic = TRUE;
+  gtk_text_buffer_begin_user_action(buffer);
+
+  /* Only styles to add, the text is left alone */
+  if (!ctx->same_text) {
+    gtk_text_buffer_delete(buffer, &start, &stop);
+    gtk_text_buffer_insert(buffer, &start, doc->text->str, doc->text->len);
+  }
+
+  for (guint i = 0; i < doc->spans->len; i++) {
+    MarkdownSpan *span = &g_array_index(doc->spans, MarkdownSpan, i);
+
+    if (span->type == MARKDOWN_SPAN_LINK) {
+      continue;
+    }
+
+    gtk_text_buffer_get_iter_at_offset(buffer, &start, offset + span->start);
+    gtk_text_buffer_get_iter_at_offset(buffer, &stop, offset + span->end);
+    gtk_text_buffer_apply_tag_by_name(buffer,
+                                      markdown_span_tag_name(span->type),
+                                      &start, &stop);
+  }
+
+  /* Backwards, so the offsets of the remaining links stay valid */
+  for (guint i = doc->spans->len; i > 0; i--) {
+    MarkdownSpan *span = &g_array_index(doc->spans, MarkdownSpan, i - 1);
+
+    if (span->type != MARKDOWN_SPAN_LINK) {
+      continue;
+    }
+
+    gtk_text_buffer_get_iter_at_offset(buffer, &start, offset + span->start);
+    insert_anchor(page, &start, fetch_or_create(page, span->target));
+  }
+
+  gtk_text_buffer_end_user_action(buffer);
+  page->programmatic = FALSE;
+
+  g_signal_emit(page, editor_signals[EDITOR_PAGE_EDITED], 0);
+}
+
+static void
+parse_paste_thread(GTask *task,
+                   G_GNUC_UNUSED gpointer source_object,
+                   gpointer task_data,
+                   G_GNUC_UNUSED GCancellable *cancellable)
+{
+  struct paste_ctx *ctx = (struct paste_ctx *) task_data;
+  MarkdownDoc *doc = markdown_parse(ctx->text, -1);
+
+  /* Read once the task is done, in the main thread */
+  ctx->same_text = g_strcmp0(doc->text->str, ctx->text) == 0;
+  g_task_return_pointer(task, doc, (GDestroyNotify) markdown_doc_free);
+}
+
+static void
+paste_parsed(GObject *source_object,
+             GAsyncResult *res,
+             G_GNUC_UNUSED gpointer user_data)
+{
+  EditorPage *page = EDITOR_PAGE(source_object);
+  struct paste_ctx *ctx;
+  MarkdownDoc *doc;
+
+  ctx = g_task_get_task_data(G_TASK(res));
+  doc = g_task_propagate_pointer(G_TASK(res), NULL);
+
+  if (doc != NULL) {
+    apply_paste(page, ctx, doc);
+    markdown_doc_free(doc);
+  }
+}
+
+static void
+paste_done(GtkTextBuffer *buffer,
+           G_GNUC_UNUSED GdkClipboard *clipboard,
+           gpointer user_data)
+{
+  EditorPage *page = EDITOR_PAGE(user_data);
+  struct paste_ctx *ctx;
+  GtkTextIter start;
+  GtkTextIter stop;
+  GTask *task;
+
+  ctx = g_steal_pointer(&page->paste);
+
+  if (ctx == NULL) {
+    return;
+  }
+
+  /* Any other edit since the insert dropped the paste, this is a check */
+  gtk_text_buffer_get_iter_at_mark(buffer, &start, ctx->start_mark);
+  gtk_text_buffer_get_iter_at_mark(buffer, &stop, ctx->stop_mark);
+  if (gtk_text_iter_get_offset(&stop) - gtk_text_iter_get_offset(&start) !=
+      ctx->n_chars) {
+    paste_ctx_free(ctx);
+    return;
+  }
+  ctx->changes = page->changes;
+
+  if (strlen(ctx->text) < PASTE_WORKER_LEN) {
+    MarkdownDoc *doc = markdown_parse(ctx->text, -1);
+
+    ctx->same_text = g_strcmp0(doc->text->str, ctx->text) == 0;
+    apply_paste(page, ctx, doc);
+    markdown_doc_free(doc);
+    paste_ctx_free(ctx);
+    return;
+  }
+
+  task = g_task_new(page, NULL, paste_parsed, NULL);
+  g_task_set_task_data(task, ctx, paste_ctx_free);
+  g_task_run_in_thread(task, parse_paste_thread);
+  g_object_unref(task);
 }
 
 static void
@@ -221,6 +494,16 @@ insert_text(GtkTextBuffer *self,
   static gchar last = ' ';
   EditorPage *page = EDITOR_PAGE(user_data);
 
+  /* A paste is the insert right before paste-done. Drag and drop or input
+   * methods insert without one, what comes after is not part of them. */
+  g_clear_pointer(&page->paste, paste_ctx_free);
+
+  if (len > 1) {
+    /* Styled once the paste is done, see paste_done() */
+    remember_paste(page, location, text, len);
+    return;
+  }
+
   if (len != 1) {
     return;
   }
@@ -270,8 +553,6 @@ insert_text(GtkTextBuffer *self,
 static GtkTextMark *
 fix_last_anchor(EditorPage *page, GtkTextMark *start_mark)
 {
-  GtkTextChildAnchor *anchor;
-  EditorPage *other = NULL;
   GtkTextBuffer *buffer;
   GtkTextIter start;
   GtkTextIter match_begin_start;
@@ -280,7 +561,6 @@ fix_last_anchor(EditorPage *page, GtkTextMark *start_mark)
   GtkTextIter match_stop_end;
   gchar *name;
   GtkTextMark *return_mark = NULL;
-  GtkWidget *button;
 
   buffer = page->content;
 
@@ -322,29 +602,7 @@ fix_last_anchor(EditorPage *page, GtkTextMark *start_mark)
   gtk_text_buffer_delete(buffer, &match_begin_start, &match_stop_end);
 
   gtk_text_buffer_get_iter_at_mark(buffer, &start, return_mark);
-  anchor = gtk_text_buffer_create_child_anchor(buffer, &start);
-
-  if (page->fetch_page != NULL) {
-    other = page->fetch_page(name, page->fetch_page_user_data);
-  }
-
-  if (!other) {
-    other = editor_page_new(name, NULL, page->fetch_page,
-                            page->fetch_page_user_data, page->created_cb,
-                            page->user_data);
-  }
-
-  g_object_set_data(G_OBJECT(anchor), "target", other);
-
-  g_ptr_array_add(page->anchors, g_object_ref(anchor));
-
-  // gtk_text_view_add_child_at_anchor(textarea, widget, anchor);
-  /* EMIT new anchor */
-  button = editor_page_in_content_button(other);
-  g_object_set_data(G_OBJECT(button), "anchor", anchor);
-  g_object_set_data(G_OBJECT(button), "target", page);
-
-  g_signal_emit(page, editor_signals[EDITOR_PAGE_NEW_ANCHOR], 0, anchor, button);
+  insert_anchor(page, &start, fetch_or_create(page, name));
 
 out:
   g_free(name);
@@ -362,8 +620,6 @@ fix_anchors(EditorPage *page)
   const gchar *name;
 
   GtkTextMark *return_mark = NULL;
-  GtkTextChildAnchor *anchor;
-  EditorPage *other = NULL;
 
   gtk_text_buffer_get_start_iter(page->content, &start_bound);
 
@@ -384,31 +640,7 @@ fix_anchors(EditorPage *page)
     gtk_text_buffer_delete(page->content, &start_res, &stop_res);
 
     gtk_text_buffer_get_iter_at_mark(page->content, &start_bound, return_mark);
-    anchor = gtk_text_buffer_create_child_anchor(page->content, &start_bound);
-
-    if (page->fetch_page != NULL) {
-      other = page->fetch_page(name, page->fetch_page_user_data);
-    }
-
-    if (!other) {
-      other = editor_page_new(name, NULL, page->fetch_page,
-                              page->fetch_page_user_data, page->created_cb,
-                              page->user_data);
-    }
-
-    g_object_set_data(G_OBJECT(anchor), "target", other);
-
-    g_ptr_array_add(page->anchors, g_object_ref(anchor));
-
-    // gtk_text_view_add_child_at_anchor(textarea, widget, anchor);
-    /* EMIT new anchor */
-    GtkWidget *button;
-    button = editor_page_in_content_button(other);
-    g_object_set_data(G_OBJECT(button), "anchor", anchor);
-    g_object_set_data(G_OBJECT(button), "target", page);
-
-    g_signal_emit(page, editor_signals[EDITOR_PAGE_NEW_ANCHOR], 0, anchor,
-                  button);
+    insert_anchor(page, &start_bound, fetch_or_create(page, name));
   }
 
   if (1) {
@@ -464,6 +696,97 @@ fix_tags(EditorPage *page)
     */
 }
 
+static void
+drop_anchor_buttons(gpointer data, G_GNUC_UNUSED gpointer user_data)
+{
+  GtkTextChildAnchor *anchor = GTK_TEXT_CHILD_ANCHOR(data);
+  EditorPage *target;
+
+  target = g_object_get_data(G_OBJECT(anchor), "target");
+
+  for (guint i = target->buttons->len; i > 0; i--) {
+    GObject *button = target->buttons->pdata[i - 1];
+
+    if (g_object_get_data(button, "anchor") == anchor) {
+      g_ptr_array_remove_index_fast(target->buttons, i - 1);
+      g_object_unref(button);
+    }
+  }
+
+  g_object_unref(anchor);
+}
+
+static gboolean
+is_anchor_char(gunichar c, G_GNUC_UNUSED gpointer user_data)
+{
+  return c == 0xFFFC;
+}
+
+/* Runs before the text is gone, so the anchors can still be found */
+static void
+delete_range(G_GNUC_UNUSED GtkTextBuffer *buffer,
+             GtkTextIter *start,
+             GtkTextIter *end,
+             EditorPage *page)
+{
+  GtkTextIter iter = *start;
+
+  /* Whatever was inserted last is no longer what is there */
+  g_clear_pointer(&page->paste, paste_ctx_free);
+
+  if (page->anchors->len == 0 || gtk_text_iter_equal(start, end)) {
+    return;
+  }
+
+  do {
+    GtkTextChildAnchor *anchor = gtk_text_iter_get_child_anchor(&iter);
+
+    if (anchor != NULL && g_ptr_array_remove(page->anchors, anchor)) {
+      unlink_pages(page, g_object_get_data(G_OBJECT(anchor), "target"));
+      drop_anchor_buttons(anchor, NULL);
+    }
+  } while (gtk_text_iter_forward_find_char(&iter, is_anchor_char, NULL, end));
+}
+
+static void
+content_changed(G_GNUC_UNUSED GtkTextBuffer *buffer, gpointer user_data)
+{
+  EditorPage *page = EDITOR_PAGE(user_data);
+
+  page->changes++;
+
+  if (!page->programmatic) {
+    g_signal_emit(page, editor_signals[EDITOR_PAGE_EDITED], 0);
+  }
+}
+
+static void
+create_content(EditorPage *self)
+{
+  /* Not sharing tags (for now at least) */
+  self->content = gtk_text_buffer_new(NULL);
+  gtk_text_buffer_set_max_undo_levels(self->content,
+                                      EDITOR_PAGE_MAX_UNDO_LEVELS);
+
+  self->bold = gtk_text_buffer_create_tag(self->content, "bold", "weight", 800,
+                                          NULL);
+
+  self->code = gtk_text_buffer_create_tag(self->content, "code", "family",
+                                          "Monospace", NULL);
+  self->headings[0] = gtk_text_buffer_create_tag(self->content, "h1", "weight",
+                                                 800, "size-points", 20.0, NULL);
+  self->headings[1] = gtk_text_buffer_create_tag(self->content, "h2", "weight",
+                                                 800, "size-points", 16.0, NULL);
+  self->headings[2] = gtk_text_buffer_create_tag(self->content, "h3", "weight",
+                                                 800, "size-points", 12.0, NULL);
+
+  g_signal_connect(self->content, "insert-text", G_CALLBACK(insert_text), self);
+  g_signal_connect(self->content, "paste-done", G_CALLBACK(paste_done), self);
+  g_signal_connect(self->content, "changed", G_CALLBACK(content_changed), self);
+  g_signal_connect(self->content, "delete-range", G_CALLBACK(delete_range),
+                   self);
+}
+
 static void
 foreach_button_name(gpointer data, gpointer user_data)
 {
@@ -494,9 +817,26 @@ editor_page_finalize(GObject *obj)
 
   /*free stuff */
 
-  g_free(self->heading);
+  g_clear_pointer(&self->heading, g_ref_string_release);
+  g_free(self->sort_key);
+  g_free(self->fuzzy_key);
+
+  /* The links from here are gone with the page */
+  for (guint i = 0; i < self->anchors->len; i++) {
+    unlink_pages(self, g_object_get_data(self->anchors->pdata[i], "target"));
+  }
+  g_clear_pointer(&self->anchors, g_ptr_array_unref);
+  if (self->stored_links != NULL) {
+    for (guint i = 0; i < self->stored_links->len; i++) {
+      unlink_pages(self, self->stored_links->pdata[i]);
+    }
+    g_clear_pointer(&self->stored_links, g_ptr_array_unref);
+  }
+  g_clear_pointer(&self->backlinks, g_hash_table_unref);
 
+  g_clear_pointer(&self->paste, paste_ctx_free);
   g_clear_object(&self->content);
+  g_clear_pointer(&self->stored, g_bytes_unref);
 
   /* Always chain up to the parent finalize function to complete object
    * destruction. */
@@ -536,10 +876,21 @@ set_property(GObject *object,
   case PROP_HEADING:
     gchar *old_name = self->heading;
 
-    self->heading = g_value_dup_string(value);
+    /* Pages with the same heading share it, and it compares by pointer */
+    self->heading = g_value_get_string(value) != NULL ?
+                      g_ref_string_new_intern(g_value_get_string(value)) :
+                      NULL;
+
+    /* Only made again when the heading changes, sorting just compares */
+    g_free(self->sort_key);
+    self->sort_key = self->heading != NULL ? utils_sort_key(self->heading) :
+                                             NULL;
+    g_free(self->fuzzy_key);
+    self->fuzzy_key = self->heading != NULL ? fuzzy_fold(self->heading) :
+                                              NULL;
 
     update_name(self, old_name);
-    g_free(old_name);
+    g_clear_pointer(&old_name, g_ref_string_release);
     break;
   case PROP_CONTENT:
     g_clear_object(&self->content);
@@ -584,14 +935,29 @@ editor_page_class_init(EditorPageClass *klass)
                                                      NULL, NULL, NULL, NULL,
                                                      G_TYPE_NONE, 0, NULL);
 
-  GType params[] = { G_TYPE_OBJECT, G_TYPE_OBJECT };
+  GType params[] = { G_TYPE_OBJECT };
   editor_signals[EDITOR_PAGE_NEW_ANCHOR] = g_signal_newv("new-anchor",
                                                          G_TYPE_FROM_CLASS(klass),
                                                          G_SIGNAL_RUN_LAST |
                                                            G_SIGNAL_NO_RECURSE |
                                                            G_SIGNAL_NO_HOOKS,
                                                          NULL, NULL, NULL, NULL,
-                                                         G_TYPE_NONE, 2, params);
+                                                         G_TYPE_NONE, 1, params);
+
+  /* The user changed the text, not emitted for loading and fixups */
+  editor_signals[EDITOR_PAGE_EDITED] = g_signal_newv("edited",
+                                                     G_TYPE_FROM_CLASS(klass),
+                                                     G_SIGNAL_RUN_LAST |
+                                                       G_SIGNAL_NO_RECURSE |
+                                                       G_SIGNAL_NO_HOOKS,
+                                                     NULL, NULL, NULL, NULL,
+                                                     G_TYPE_NONE, 0, NULL);
+
+  /* Links to this page were added or deleted */
+  editor_signals[EDITOR_PAGE_BACKLINKS_CHANGED] =
+    g_signal_newv("backlinks-changed", G_TYPE_FROM_CLASS(klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  NULL, NULL, NULL, NULL, G_TYPE_NONE, 0, NULL);
 }
 
 static void
@@ -600,34 +966,32 @@ editor_page_init(EditorPage *self)
   /* initialize all public and private members to reasonable default values.
    * They are all automatically initialized to 0 to begin with. */
 
-  /* Not sharing tags (for now at least) */
-  self->content = gtk_text_buffer_new(NULL);
-  self->anchors = g_ptr_array_new();
+  self->anchors = g_ptr_array_new_with_free_func(g_object_unref);
   self->buttons = g_ptr_array_new();
+  self->backlinks = g_hash_table_new(g_direct_hash, g_direct_equal);
   self->color.red = .7;
   self->color.green = .7;
   self->color.blue = 1.0;
   self->color.alpha = 1.0;
   self->draft = g_strdup("true");
+  frecency_init(&self->frecency);
 
-  self->bold = gtk_text_buffer_create_tag(self->content, "bold", "weight", 800,
-                                          NULL);
-
-  self->code = gtk_text_buffer_create_tag(self->content, "code", "family",
-                                          "Monospace", NULL);
-  self->headings[0] = gtk_text_buffer_create_tag(self->content, "h1", "weight",
-                                                 800, "size-points", 20.0, NULL);
-  self->headings[1] = gtk_text_buffer_create_tag(self->content, "h2", "weight",
-                                                 800, "size-points", 16.0, NULL);
-  self->headings[2] = gtk_text_buffer_create_tag(self->content, "h3", "weight",
-                                                 800, "size-points", 12.0, NULL);
+  create_content(self);
 }
 
 static void
 change_page(G_GNUC_UNUSED GObject *button, EditorPage *self)
 {
+  editor_page_switch_to(self);
+}
+
+/* Asks whoever shows pages to show this one */
+void
+editor_page_switch_to(EditorPage *self)
+{
+  g_return_if_fail(self != NULL);
+
   g_signal_emit(self, editor_signals[EDITOR_PAGE_SWITCH], 0, self);
-  // EMIT change page
 }
 
 EditorPage *
@@ -638,37 +1002,29 @@ editor_page_new(const gchar *heading,
                 GCallback created_cb,
                 gpointer user_data)
 {
-  static guint css_num = 0;
   EditorPage *self;
 
   if (tags == NULL) {
-    tags = g_ptr_array_new_with_free_func(g_free);
+    tags = g_ptr_array_new_with_free_func(
+      (GDestroyNotify) g_ref_string_release);
   }
 
   if (tags->len == 0) {
-    g_ptr_array_add(tags, g_strdup("Not tagged"));
+    g_ptr_array_add(tags, g_ref_string_new_intern(EDITOR_PAGE_NOT_TAGGED));
   }
 
-  g_message("Creating GObject");
   self = g_object_new(EDITOR_TYPE_PAGE, "heading", heading, NULL);
-  g_message("After creating GObject");
 
-  css_num++;
-  self->css_name = g_strdup_printf("page%u", css_num);
   self->tags = tags;
   self->fetch_page = fetch_page;
   self->fetch_page_user_data = fetch_page_user_data;
 
-  g_signal_connect(self->content, "insert-text", G_CALLBACK(insert_text), self);
-
   self->created_cb = created_cb;
   self->user_data = user_data;
   if (self->created_cb != NULL) {
     ((create_cb) *self->created_cb)(self, self->user_data);
   }
 
-  g_message("New page done");
-
   return self;
 }
 
@@ -681,28 +1037,6 @@ editor_page_in_content_button(EditorPage *self)
   gtk_button_set_has_frame(GTK_BUTTON(button), FALSE);
   g_signal_connect(button, "clicked", G_CALLBACK(change_page), self);
   gtk_widget_add_css_class(button, "in-text-button");
-  gtk_widget_add_css_class(button, self->css_name);
-
-  g_ptr_array_add(self->buttons, g_object_ref(button));
-  return button;
-}
-
-GtkWidget *
-editor_page_in_list_button(EditorPage *self)
-{
-  GtkWidget *button;
-  GtkWidget *label;
-
-  button = gtk_button_new_with_label(self->heading);
-  label = gtk_button_get_child(GTK_BUTTON(button));
-
-  gtk_button_set_has_frame(GTK_BUTTON(button), FALSE);
-
-  gtk_label_set_xalign(GTK_LABEL(label), 0.0);
-
-  g_signal_connect(button, "clicked", G_CALLBACK(change_page), self);
-  gtk_widget_add_css_class(button, "in-list-button");
-  gtk_widget_add_css_class(button, self->css_name);
 
   g_ptr_array_add(self->buttons, g_object_ref(button));
   return button;
@@ -757,10 +1091,21 @@ editor_page_update_style(EditorPage *self, enum style style_id)
   gtk_text_buffer_apply_tag_by_name(self->content, name, &start, &end);
 }
 
-GString *
-editor_page_to_md(EditorPage *self)
+static void
+append_link(GString *res, EditorPage *target)
+{
+  gchar *file = editor_page_name_to_filename(target->heading);
+
+  g_string_append_printf(res, "[%s]({{< ref \"%s\" >}} \"%s\")",
+                         target->heading, file, target->heading);
+  g_free(file);
+}
+
+/* With links set, each link is written as a U+FFFC and its page added to
+ * links, so the link survives the page being renamed */
+static void
+body_to_md(EditorPage *self, GString *res, GPtrArray *links)
 {
-  GString *res = g_string_new("");
   GtkTextIter iter;
   gunichar c;
   gunichar prev;
@@ -768,15 +1113,6 @@ editor_page_to_md(EditorPage *self)
   gboolean code = FALSE;
   gboolean bold = FALSE;
 
-  /* write header */
-  g_string_append_printf(res, "---\ntitle: \"%s\"\ndraft: %s\ntags:\n",
-                         self->heading, self->draft);
-
-  for (guint i = 0; i < self->tags->len; i++) {
-    g_string_append_printf(res, "  - %s\n", (gchar *) self->tags->pdata[i]);
-  }
-  g_string_append(res, "---\n");
-
   /* translate styled doc to md format
    header -> #[#[#]] Text
    anchor --> [Title]({{< ref "filename.md" >}} "Title")
@@ -795,7 +1131,6 @@ editor_page_to_md(EditorPage *self)
         gtk_text_iter_ends_tag(&iter, self->code)) {
       if (prev != 0x0A) {
         g_string_append(res, "\n");
-        g_message("Unichar: %d / %c", prev, c);
       }
       g_string_append(res, "````\n");
       code = !code;
@@ -815,10 +1150,13 @@ editor_page_to_md(EditorPage *self)
       anchor = gtk_text_iter_get_child_anchor(&iter);
       if (anchor != NULL) {
         EditorPage *target = g_object_get_data(G_OBJECT(anchor), "target");
-        gchar *file = editor_page_name_to_filename(target->heading);
-        g_string_append_printf(res, "[%s]({{< ref \"%s\" >}} \"%s\")",
-                               target->heading, file, target->heading);
-        g_free(file);
+
+        if (links != NULL) {
+          g_string_append_unichar(res, c);
+          g_ptr_array_add(links, g_object_ref(target));
+        } else {
+          append_link(res, target);
+        }
       }
     } else {
       g_string_append_unichar(res, c);
@@ -835,6 +1173,52 @@ editor_page_to_md(EditorPage *self)
   if (bold) {
     g_string_append(res, "**");
   }
+}
+
+/* The body of an evicted page, links named after their pages as they are
+ * called now */
+static void
+stored_to_md(EditorPage *self, GString *res)
+{
+  gchar *body = utils_decompress(self->stored);
+  guint n = 0;
+
+  if (body == NULL) {
+    return;
+  }
+
+  for (const gchar *p = body; *p != '\0'; p = g_utf8_next_char(p)) {
+    gunichar c = g_utf8_get_char(p);
+
+    if (c == 0xFFFC && n < self->stored_links->len) {
+      append_link(res, self->stored_links->pdata[n++]);
+    } else {
+      g_string_append_unichar(res, c);
+    }
+  }
+
+  g_free(body);
+}
+
+GString *
+editor_page_to_md(EditorPage *self)
+{
+  GString *res = g_string_new("");
+
+  /* write header */
+  g_string_append_printf(res, "---\ntitle: \"%s\"\ndraft: %s\ntags:\n",
+                         self->heading, self->draft);
+
+  for (guint i = 0; i < self->tags->len; i++) {
+    g_string_append_printf(res, "  - %s\n", (gchar *) self->tags->pdata[i]);
+  }
+  g_string_append(res, "---\n");
+
+  if (self->stored != NULL) {
+    stored_to_md(self, res);
+  } else {
+    body_to_md(self, res, NULL);
+  }
 
   return res;
 }
@@ -856,7 +1240,7 @@ editor_page_load(gchar *content,
     return NULL;
   }
 
-  tags = g_ptr_array_new_with_free_func(g_free);
+  tags = g_ptr_array_new_with_free_func((GDestroyNotify) g_ref_string_release);
 
   parse_header(content, &name, &draft, tags);
 
@@ -882,7 +1266,16 @@ editor_page_load(gchar *content,
   c->len = strlen(c->str);
 
   g_string_append(c, "\n");
+
+  /* A page released while placeholder content was shown */
+  editor_page_restore(page);
+
+  /* Loading is not something the user should be able to undo */
+  page->programmatic = TRUE;
+  gtk_text_buffer_begin_irreversible_action(page->content);
   gtk_text_buffer_set_text(page->content, c->str, -1);
+  gtk_text_buffer_end_irreversible_action(page->content);
+  page->programmatic = FALSE;
 
   return page;
 }
@@ -908,9 +1301,186 @@ editor_page_name_to_filename(const gchar *name)
 void
 editor_page_fix_content(EditorPage *page)
 {
+  if (!editor_page_is_resident(page)) {
+    /* Fixed up when the buffer is restored */
+    return;
+  }
+
+  page->programmatic = TRUE;
+  gtk_text_buffer_begin_irreversible_action(page->content);
+
   fix_anchors(page);
 
   fix_tags(page);
+
+  gtk_text_buffer_end_irreversible_action(page->content);
+  page->programmatic = FALSE;
+
+  gtk_text_buffer_set_modified(page->content, FALSE);
+}
+
+gboolean
+editor_page_is_resident(EditorPage *self)
+{
+  g_return_val_if_fail(self != NULL, FALSE);
+
+  return self->stored == NULL;
+}
+
+/* The text as the buffer shows it, links left out. An evicted page parses
+ * its stored body instead of restoring the buffer. */
+gchar *
+editor_page_get_text(EditorPage *self)
+{
+  GtkTextIter start;
+  GtkTextIter end;
+  MarkdownDoc *md;
+  GString *res;
+  gchar *body;
+
+  g_return_val_if_fail(self != NULL, NULL);
+
+  if (editor_page_is_resident(self)) {
+    gtk_text_buffer_get_bounds(self->content, &start, &end);
+    return gtk_text_buffer_get_text(self->content, &start, &end, FALSE);
+  }
+
+  body = utils_decompress(self->stored);
+  if (body == NULL) {
+    return g_strdup("");
+  }
+
+  md = markdown_parse(body, -1);
+  res = g_string_sized_new(md->text->len);
+  for (const gchar *p = md->text->str; *p != '\0'; p = g_utf8_next_char(p)) {
+    gunichar c = g_utf8_get_char(p);
+
+    if (c != 0xFFFC) {
+      g_string_append_unichar(res, c);
+    }
+  }
+
+  markdown_doc_free(md);
+  g_free(body);
+
+  return g_string_free(res, FALSE);
+}
+
+/* Rough estimate of what a buffer costs, the text itself plus the B-tree
+ * line and segment overhead */
+#define RESIDENT_BYTES_PER_CHAR 4
+#define RESIDENT_BYTES_PER_LINE 96
+
+gsize
+editor_page_resident_size(EditorPage *self)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  if (!editor_page_is_resident(self)) {
+    return 0;
+  }
+
+  return gtk_text_buffer_get_char_count(self->content) *
+           RESIDENT_BYTES_PER_CHAR +
+         gtk_text_buffer_get_line_count(self->content) *
+           RESIDENT_BYTES_PER_LINE;
+}
+
+/* Release the buffer of a clean page, keeping a compressed copy of the body
+ * that editor_page_restore() parses back */
+gboolean
+editor_page_evict(EditorPage *self)
+{
+  GPtrArray *links;
+  GString *body;
+
+  g_return_val_if_fail(self != NULL, FALSE);
+
+  if (!editor_page_is_resident(self) ||
+      gtk_text_buffer_get_modified(self->content)) {
+    return FALSE;
+  }
+
+  /* The links keep their pages, their backlinks stay counted */
+  links = g_ptr_array_new_with_free_func(g_object_unref);
+  body = g_string_new("");
+  body_to_md(self, body, links);
+  self->stored = utils_compress(body->str, body->len);
+  g_string_free(body, TRUE);
+
+  if (self->stored == NULL) {
+    g_ptr_array_unref(links);
+    return FALSE;
+  }
+  self->stored_links = links;
+
+  g_ptr_array_foreach(self->anchors, drop_anchor_buttons, NULL);
+  g_ptr_array_set_size(self->anchors, 0);
+  g_clear_pointer(&self->paste, paste_ctx_free);
+
+  g_clear_object(&self->content);
+  self->bold = NULL;
+  self->code = NULL;
+  memset(self->headings, 0, sizeof(self->headings));
+
+  return TRUE;
+}
+
+/* Each U+FFFC of a restored body becomes a link to the page it stood for */
+static void
+restore_anchors(EditorPage *self)
+{
+  GtkTextIter iter;
+  guint n = 0;
+
+  gtk_text_buffer_get_start_iter(self->content, &iter);
+
+  while (n < self->stored_links->len &&
+         (is_anchor_char(gtk_text_iter_get_char(&iter), NULL) ||
+          gtk_text_iter_forward_find_char(&iter, is_anchor_char, NULL,
+                                          NULL))) {
+    GtkTextIter end = iter;
+    gint offset = gtk_text_iter_get_offset(&iter);
+
+    gtk_text_iter_forward_char(&end);
+    gtk_text_buffer_delete(self->content, &iter, &end);
+    insert_anchor(self, &iter, self->stored_links->pdata[n++]);
+
+    gtk_text_buffer_get_iter_at_offset(self->content, &iter, offset + 1);
+  }
+}
+
+void
+editor_page_restore(EditorPage *self)
+{
+  gchar *body;
+
+  g_return_if_fail(self != NULL);
+
+  if (editor_page_is_resident(self)) {
+    return;
+  }
+
+  body = utils_decompress(self->stored);
+  g_clear_pointer(&self->stored, g_bytes_unref);
+
+  create_content(self);
+  self->programmatic = TRUE;
+  self->restoring = TRUE;
+  gtk_text_buffer_begin_irreversible_action(self->content);
+  gtk_text_buffer_set_text(self->content, body != NULL ? body : "", -1);
+  g_free(body);
+
+  /* Links are not looked up by name, the pages may have been renamed */
+  restore_anchors(self);
+  fix_tags(self);
+
+  gtk_text_buffer_end_irreversible_action(self->content);
+  self->restoring = FALSE;
+  self->programmatic = FALSE;
+  gtk_text_buffer_set_modified(self->content, FALSE);
+
+  g_clear_pointer(&self->stored_links, g_ptr_array_unref);
 }
 
 const gchar *const *
@@ -922,32 +1492,116 @@ editor_page_get_styles(void)
 void
 editor_page_add_anchor(EditorPage *self, EditorPage *other)
 {
-  GtkWidget *button;
-  GtkTextChildAnchor *anchor;
   GtkTextIter iter;
   GtkTextMark *insert;
 
   g_return_if_fail(self != NULL);
 
-  insert = gtk_text_buffer_get_insert(self->content);
-  gtk_text_buffer_get_iter_at_mark(self->content, &iter, insert);
-  anchor = gtk_text_buffer_create_child_anchor(self->content, &iter);
-
   if (!other) {
     other = editor_page_new("New page", NULL, self->fetch_page,
                             self->fetch_page_user_data, self->created_cb,
                             self->user_data);
   }
 
-  g_object_set_data(G_OBJECT(anchor), "target", other);
+  insert = gtk_text_buffer_get_insert(self->content);
+  gtk_text_buffer_get_iter_at_mark(self->content, &iter, insert);
+  insert_anchor(self, &iter, other);
+}
 
-  g_ptr_array_add(self->anchors, g_object_ref(anchor));
+/* EditorPage -> number of links from it to this page, owned by the page */
+GHashTable *
+editor_page_get_backlinks(EditorPage *self)
+{
+  g_return_val_if_fail(self != NULL, NULL);
 
-  // gtk_text_view_add_child_at_anchor(textarea, widget, anchor);
-  /* EMIT new anchor */
-  button = editor_page_in_content_button(other);
-  g_object_set_data(G_OBJECT(button), "anchor", anchor);
-  g_object_set_data(G_OBJECT(button), "target", self);
+  return self->backlinks;
+}
+
+/* Order of pages in lists, by the sort keys of the headings. Headings that
+ * only differ in case or accents are ordered by their bytes. */
+gint
+editor_page_cmp(const EditorPage *a, const EditorPage *b)
+{
+  gint res = g_strcmp0(a->sort_key, b->sort_key);
+
+  if (res != 0) {
+    return res;
+  }
+
+  return g_strcmp0(a->heading, b->heading);
+}
+
+/* draft: true in the front matter, new pages are drafts */
+gboolean
+editor_page_is_draft(EditorPage *self)
+{
+  g_return_val_if_fail(self != NULL, FALSE);
+
+  return g_strcmp0(self->draft, "true") == 0;
+}
+
+/* Heading of a file and, if tags is not NULL, its tags, without creating a
+ * page. Safe to call from any thread. */
+gchar *
+editor_page_read_header(const gchar *content, GPtrArray *tags)
+{
+  GPtrArray *ignored = NULL;
+  gchar *title = NULL;
+  gchar *draft = NULL;
+
+  g_return_val_if_fail(content != NULL, NULL);
 
-  g_signal_emit(self, editor_signals[EDITOR_PAGE_NEW_ANCHOR], 0, anchor, button);
-}
\ No newline at end of file
+  if (!g_str_has_prefix(content, "---")) {
+    return NULL;
+  }
+
+  if (tags == NULL) {
+    tags = ignored = g_ptr_array_new_with_free_func(
+      (GDestroyNotify) g_ref_string_release);
+  }
+
+  parse_header(content, &title, &draft, tags);
+
+  g_free(draft);
+  if (ignored != NULL) {
+    g_ptr_array_unref(ignored);
+  }
+
+  return title;
+}
+
+/* What keeps a file from being loaded as a page, NULL if nothing does. Safe
+ * to call from any thread. */
+const gchar *
+editor_page_header_problem(const gchar *content)
+{
+  GPtrArray *tags;
+  gchar *title = NULL;
+  gchar *draft = NULL;
+  const gchar *res = NULL;
+
+  g_return_val_if_fail(content != NULL, NULL);
+
+  if (!g_str_has_prefix(content, "---")) {
+    return "No front matter";
+  }
+
+  /* Where editor_page_load looks for the end of it */
+  if (strlen(content) < 4 || g_strstr_len(content + 4, -1, "---") == NULL) {
+    return "Front matter is not closed";
+  }
+
+  tags = g_ptr_array_new_with_free_func((GDestroyNotify) g_ref_string_release);
+
+  if (!parse_header(content, &title, &draft, tags)) {
+    res = "Front matter is not valid YAML";
+  } else if (title == NULL || title[0] == '\0') {
+    res = "Front matter has no title";
+  }
+
+  g_free(title);
+  g_free(draft);
+  g_ptr_array_unref(tags);
+
+  return res;
+}
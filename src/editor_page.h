@@ -3,6 +3,8 @@
 #include <glib-object.h>
 #include <gtk/gtk.h>
 
+#include "frecency.h"
+
 
 G_BEGIN_DECLS
 #define PATTERN_H1        "\n# ?\n"
@@ -16,6 +18,12 @@ G_BEGIN_DECLS
 #define TRIM_PATTERN_CODE "xxxxx?xxxxx"
 #define TRIM_PATTERN_BOLD "xx?xx"
 
+/* Tag of the pages that have no other */
+#define EDITOR_PAGE_NOT_TAGGED "Not tagged"
+
+/* Undo steps kept per page, the oldest are dropped first */
+#define EDITOR_PAGE_MAX_UNDO_LEVELS 100
+
 
 enum style {
   STYLE_NO_CHOICE = 0,
@@ -32,18 +40,33 @@ G_DECLARE_FINAL_TYPE(EditorPage, editor_page, EDITOR, PAGE, GObject)
 
 typedef EditorPage *(*fetch_page_fn)(const gchar *heading, gpointer user_data);
 
+struct paste_ctx;
+
 /** Public variables. Move to .c file to make private */
 struct _EditorPage {
   GObject parent;
 
+  /* A GRefString from g_ref_string_new_intern */
   gchar *heading;
+  /* utils_sort_key of the heading, pages are listed in its order */
+  gchar *sort_key;
+  /* fuzzy_fold of the heading, what the quick switcher matches against */
+  gchar *fuzzy_key;
   GtkTextBuffer *content;
+  /* Compressed body while the buffer is released, NULL when resident. Links
+   * are a U+FFFC each, standing for the next page in stored_links. */
+  GBytes *stored;
+  GPtrArray *stored_links;
   GPtrArray *anchors;
   GPtrArray *buttons;
+  /* Interned as well, one copy of a tag name for all the pages */
   GPtrArray *tags;
   gchar *draft;
+  /* How often and how recently the page was opened or linked */
+  Frecency frecency;
+  /* Pinned place in page lists, higher first and 0 for regular pages */
+  gint sort_rank;
 
-  gchar *css_name;
   GdkRGBA color;
 
   GCallback created_cb;
@@ -55,6 +78,19 @@ struct _EditorPage {
   GtkTextTag *bold;
   GtkTextTag *code;
   GtkTextTag *headings[3];
+
+  /* Last multi character insert, styled when the paste is done */
+  struct paste_ctx *paste;
+  /* Bumped on every change of the text */
+  guint changes;
+  /* Set while the page itself inserts text, as opposed to the user */
+  gboolean programmatic;
+  /* Set while an evicted buffer is parsed back, its links are counted */
+  gboolean restoring;
+
+  /* EditorPage linking here -> number of links, kept up to date as anchors
+   * are created and deleted */
+  GHashTable *backlinks;
 };
 
 /*
@@ -73,8 +109,6 @@ EditorPage *editor_page_new(const gchar *heading,
 
 GtkWidget *editor_page_in_content_button(EditorPage *self);
 
-GtkWidget *editor_page_in_list_button(EditorPage *self);
-
 GString *editor_page_to_md(EditorPage *self);
 
 EditorPage *editor_page_load(gchar *content,
@@ -84,8 +118,30 @@ EditorPage *editor_page_load(gchar *content,
                              gpointer user_data);
 void editor_page_fix_content(EditorPage *page);
 
+gboolean editor_page_is_resident(EditorPage *self);
+
+gchar *editor_page_get_text(EditorPage *self);
+
+gsize editor_page_resident_size(EditorPage *self);
+
+gboolean editor_page_evict(EditorPage *self);
+
+void editor_page_restore(EditorPage *self);
+
 void editor_page_add_anchor(EditorPage *self, EditorPage *other);
 
+void editor_page_switch_to(EditorPage *self);
+
+GHashTable *editor_page_get_backlinks(EditorPage *self);
+
+gboolean editor_page_is_draft(EditorPage *self);
+
+gint editor_page_cmp(const EditorPage *a, const EditorPage *b);
+
+gchar *editor_page_read_header(const gchar *content, GPtrArray *tags);
+
+const gchar *editor_page_header_problem(const gchar *content);
+
 void editor_page_update_style(EditorPage *self, enum style style_id);
 
 gchar *editor_page_name_to_filename(const gchar *name);
@@ -0,0 +1,460 @@
+#include <glib-object.h>
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <string.h>
+
+#include "find_bar.h"
+#include "text_search.h"
+
+/* Find and replace in the page shown in a text view. The buffer is copied
+ * out once per search and scanned with text_search_find_all(), only the
+ * hits are turned back into iterators. */
+
+#define MATCH_TAG       "find-match"
+#define REFRESH_DELAY_MS 250
+
+struct match {
+  gint start;
+  gint end;
+};
+
+struct _NotesFindBar {
+  GtkBox parent;
+  GtkTextView *view;
+  GtkTextBuffer *buffer;
+  GtkWidget *find;
+  GtkWidget *replace;
+  GtkWidget *match_case;
+  GtkWidget *count;
+  /* struct match, character offsets in the buffer */
+  GArray *matches;
+  guint refresh_source;
+};
+
+G_DEFINE_TYPE(NotesFindBar, notes_find_bar, GTK_TYPE_BOX)
+
+static GtkTextTag *
+match_tag(GtkTextBuffer *buffer)
+{
+  GtkTextTagTable *table = gtk_text_buffer_get_tag_table(buffer);
+  GtkTextTag *tag;
+
+  tag = gtk_text_tag_table_lookup(table, MATCH_TAG);
+  if (tag == NULL) {
+    tag = gtk_text_buffer_create_tag(buffer, MATCH_TAG, "background",
+                                     "#f8e45c", NULL);
+  }
+
+  return tag;
+}
+
+static void
+clear_highlight(NotesFindBar *self)
+{
+  GtkTextIter start;
+  GtkTextIter end;
+
+  g_array_set_size(self->matches, 0);
+
+  if (self->buffer == NULL ||
+      gtk_text_tag_table_lookup(gtk_text_buffer_get_tag_table(self->buffer),
+                                MATCH_TAG) == NULL) {
+    return;
+  }
+
+  gtk_text_buffer_get_bounds(self->buffer, &start, &end);
+  gtk_text_buffer_remove_tag_by_name(self->buffer, MATCH_TAG, &start, &end);
+}
+
+static void
+refresh(NotesFindBar *self)
+{
+  GtkTextIter start;
+  GtkTextIter end;
+  GtkTextTag *tag;
+  const gchar *needle;
+  GArray *hits;
+  gchar *text;
+  gchar *count;
+  glong needle_chars;
+  glong chars = 0;
+  gsize bytes = 0;
+
+  clear_highlight(self);
+
+  needle = gtk_editable_get_text(GTK_EDITABLE(self->find));
+  if (self->buffer == NULL || needle[0] == '\0' ||
+      !gtk_widget_get_visible(GTK_WIDGET(self))) {
+    gtk_label_set_text(GTK_LABEL(self->count), "");
+    return;
+  }
+
+  /* Hidden characters included, so anchors keep their offset */
+  gtk_text_buffer_get_bounds(self->buffer, &start, &end);
+  text = gtk_text_buffer_get_slice(self->buffer, &start, &end, TRUE);
+
+  hits = text_search_find_all(
+    text, strlen(text), needle,
+    gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(self->match_case)));
+
+  tag = match_tag(self->buffer);
+  needle_chars = g_utf8_strlen(needle, -1);
+
+  for (guint i = 0; i < hits->len; i++) {
+    gsize hit = g_array_index(hits, gsize, i);
+    struct match match;
+
+    /* Hits are in order, so counting from the last one is enough */
+    chars += g_utf8_strlen(text + bytes, hit - bytes);
+    bytes = hit;
+
+    match.start = chars;
+    match.end = chars + needle_chars;
+    g_array_append_val(self->matches, match);
+
+    gtk_text_buffer_get_iter_at_offset(self->buffer, &start, match.start);
+    gtk_text_buffer_get_iter_at_offset(self->buffer, &end, match.end);
+    gtk_text_buffer_apply_tag(self->buffer, tag, &start, &end);
+  }
+
+  count = g_strdup_printf("%u matches", hits->len);
+  gtk_label_set_text(GTK_LABEL(self->count), count);
+
+  g_free(count);
+  g_array_unref(hits);
+  g_free(text);
+}
+
+static gboolean
+refresh_cb(gpointer user_data)
+{
+  NotesFindBar *self = NOTES_FIND_BAR(user_data);
+
+  self->refresh_source = 0;
+  refresh(self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+buffer_changed(G_GNUC_UNUSED GtkTextBuffer *buffer, NotesFindBar *self)
+{
+  if (!gtk_widget_get_visible(GTK_WIDGET(self))) {
+    return;
+  }
+
+  /* Not on every key press, a big page takes a moment to scan */
+  if (self->refresh_source != 0) {
+    g_source_remove(self->refresh_source);
+  }
+  self->refresh_source = g_timeout_add(REFRESH_DELAY_MS, refresh_cb, self);
+}
+
+static void
+set_buffer(NotesFindBar *self, GtkTextBuffer *buffer)
+{
+  clear_highlight(self);
+
+  if (self->buffer != NULL) {
+    g_signal_handlers_disconnect_by_func(self->buffer, buffer_changed, self);
+    g_clear_object(&self->buffer);
+  }
+
+  if (buffer != NULL) {
+    self->buffer = g_object_ref(buffer);
+    g_signal_connect(buffer, "changed", G_CALLBACK(buffer_changed), self);
+  }
+
+  refresh(self);
+}
+
+static void
+view_buffer_changed(GtkTextView *view,
+                    G_GNUC_UNUSED GParamSpec *pspec,
+                    NotesFindBar *self)
+{
+  set_buffer(self, gtk_text_view_get_buffer(view));
+}
+
+static void
+select_match(NotesFindBar *self, struct match *match)
+{
+  GtkTextIter start;
+  GtkTextIter end;
+
+  gtk_text_buffer_get_iter_at_offset(self->buffer, &start, match->start);
+  gtk_text_buffer_get_iter_at_offset(self->buffer, &end, match->end);
+  gtk_text_buffer_select_range(self->buffer, &start, &end);
+  gtk_text_view_scroll_to_iter(self->view, &start, 0.1, FALSE, 0, 0);
+}
+
+/* First match after the cursor, or last before it */
+static void
+step(NotesFindBar *self, gboolean forward)
+{
+  GtkTextIter cursor;
+  GtkTextIter bound;
+  gint from;
+
+  if (self->matches->len == 0) {
+    return;
+  }
+
+  gtk_text_buffer_get_selection_bounds(self->buffer, &cursor, &bound);
+
+  if (forward) {
+    from = gtk_text_iter_get_offset(&bound);
+    for (guint i = 0; i < self->matches->len; i++) {
+      struct match *match = &g_array_index(self->matches, struct match, i);
+
+      if (match->start >= from) {
+        select_match(self, match);
+        return;
+      }
+    }
+    select_match(self, &g_array_index(self->matches, struct match, 0));
+  } else {
+    from = gtk_text_iter_get_offset(&cursor);
+    for (guint i = self->matches->len; i > 0; i--) {
+      struct match *match = &g_array_index(self->matches, struct match, i - 1);
+
+      if (match->end <= from) {
+        select_match(self, match);
+        return;
+      }
+    }
+    select_match(self, &g_array_index(self->matches, struct match,
+                                      self->matches->len - 1));
+  }
+}
+
+static void
+next_clicked(G_GNUC_UNUSED GtkWidget *widget, NotesFindBar *self)
+{
+  step(self, TRUE);
+}
+
+static void
+previous_clicked(G_GNUC_UNUSED GtkWidget *widget, NotesFindBar *self)
+{
+  step(self, FALSE);
+}
+
+static void
+replace_range(GtkTextBuffer *buffer, struct match *match, const gchar *with)
+{
+  GtkTextIter start;
+  GtkTextIter end;
+
+  gtk_text_buffer_get_iter_at_offset(buffer, &start, match->start);
+  gtk_text_buffer_get_iter_at_offset(buffer, &end, match->end);
+  gtk_text_buffer_delete_interactive(buffer, &start, &end, TRUE);
+  gtk_text_buffer_insert_interactive(buffer, &start, with, -1, TRUE);
+}
+
+static void
+replace_clicked(G_GNUC_UNUSED GtkButton *button, NotesFindBar *self)
+{
+  GtkTextIter start;
+  GtkTextIter end;
+
+  if (self->buffer == NULL ||
+      !gtk_text_buffer_get_selection_bounds(self->buffer, &start, &end)) {
+    step(self, TRUE);
+    return;
+  }
+
+  /* Only replace what the bar selected */
+  for (guint i = 0; i < self->matches->len; i++) {
+    struct match *match = &g_array_index(self->matches, struct match, i);
+
+    if (match->start == gtk_text_iter_get_offset(&start) &&
+        match->end == gtk_text_iter_get_offset(&end)) {
+      gtk_text_buffer_begin_user_action(self->buffer);
+      replace_range(self->buffer, match,
+                    gtk_editable_get_text(GTK_EDITABLE(self->replace)));
+      gtk_text_buffer_end_user_action(self->buffer);
+      refresh(self);
+      break;
+    }
+  }
+
+  step(self, TRUE);
+}
+
+static void
+replace_all_clicked(G_GNUC_UNUSED GtkButton *button, NotesFindBar *self)
+{
+  const gchar *with;
+
+  if (self->buffer == NULL || self->matches->len == 0) {
+    return;
+  }
+
+  with = gtk_editable_get_text(GTK_EDITABLE(self->replace));
+
+  /* One undo step, last to first so the offsets before stay valid */
+  gtk_text_buffer_begin_user_action(self->buffer);
+  for (guint i = self->matches->len; i > 0; i--) {
+    replace_range(self->buffer,
+                  &g_array_index(self->matches, struct match, i - 1), with);
+  }
+  gtk_text_buffer_end_user_action(self->buffer);
+
+  refresh(self);
+}
+
+static void
+close_clicked(G_GNUC_UNUSED GtkWidget *widget, NotesFindBar *self)
+{
+  gtk_widget_set_visible(GTK_WIDGET(self), FALSE);
+  clear_highlight(self);
+  gtk_widget_grab_focus(GTK_WIDGET(self->view));
+}
+
+static void
+find_changed(G_GNUC_UNUSED GtkWidget *widget, NotesFindBar *self)
+{
+  refresh(self);
+}
+
+static void
+notes_find_bar_dispose(GObject *obj)
+{
+  NotesFindBar *self = NOTES_FIND_BAR(obj);
+
+  g_assert(self);
+
+  g_clear_handle_id(&self->refresh_source, g_source_remove);
+
+  if (self->view != NULL) {
+    g_signal_handlers_disconnect_by_func(self->view, view_buffer_changed,
+                                         self);
+    self->view = NULL;
+  }
+
+  if (self->buffer != NULL) {
+    g_signal_handlers_disconnect_by_func(self->buffer, buffer_changed, self);
+    g_clear_object(&self->buffer);
+  }
+
+  G_OBJECT_CLASS(notes_find_bar_parent_class)->dispose(obj);
+}
+
+static void
+notes_find_bar_finalize(GObject *obj)
+{
+  NotesFindBar *self = NOTES_FIND_BAR(obj);
+
+  g_assert(self);
+
+  g_clear_pointer(&self->matches, g_array_unref);
+
+  /* Always chain up to the parent finalize function to complete object
+   * destruction. */
+  G_OBJECT_CLASS(notes_find_bar_parent_class)->finalize(obj);
+}
+
+static void
+notes_find_bar_class_init(NotesFindBarClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+  object_class->dispose = notes_find_bar_dispose;
+  object_class->finalize = notes_find_bar_finalize;
+}
+
+static void
+notes_find_bar_init(NotesFindBar *self)
+{
+  GtkWidget *previous;
+  GtkWidget *next;
+  GtkWidget *replace;
+  GtkWidget *replace_all;
+  GtkWidget *close;
+
+  self->matches = g_array_new(FALSE, FALSE, sizeof(struct match));
+
+  self->find = gtk_search_entry_new();
+  self->replace = gtk_entry_new();
+  gtk_entry_set_placeholder_text(GTK_ENTRY(self->replace), "Replace with");
+  self->match_case = gtk_toggle_button_new_with_label("Aa");
+  gtk_widget_set_tooltip_text(self->match_case, "Match case");
+  self->count = gtk_label_new("");
+
+  previous = gtk_button_new_from_icon_name("go-up-symbolic");
+  next = gtk_button_new_from_icon_name("go-down-symbolic");
+  replace = gtk_button_new_with_label("Replace");
+  replace_all = gtk_button_new_with_label("Replace all");
+  close = gtk_button_new_from_icon_name("window-close-symbolic");
+
+  gtk_box_append(GTK_BOX(self), self->find);
+  gtk_box_append(GTK_BOX(self), previous);
+  gtk_box_append(GTK_BOX(self), next);
+  gtk_box_append(GTK_BOX(self), self->match_case);
+  gtk_box_append(GTK_BOX(self), self->count);
+  gtk_box_append(GTK_BOX(self), self->replace);
+  gtk_box_append(GTK_BOX(self), replace);
+  gtk_box_append(GTK_BOX(self), replace_all);
+  gtk_box_append(GTK_BOX(self), close);
+
+  g_signal_connect(self->find, "search-changed", G_CALLBACK(find_changed),
+                   self);
+  g_signal_connect(self->find, "activate", G_CALLBACK(next_clicked), self);
+  g_signal_connect(self->find, "next-match", G_CALLBACK(next_clicked), self);
+  g_signal_connect(self->find, "previous-match", G_CALLBACK(previous_clicked),
+                   self);
+  g_signal_connect(self->find, "stop-search", G_CALLBACK(close_clicked), self);
+  g_signal_connect(self->match_case, "toggled", G_CALLBACK(find_changed),
+                   self);
+  g_signal_connect(previous, "clicked", G_CALLBACK(previous_clicked), self);
+  g_signal_connect(next, "clicked", G_CALLBACK(next_clicked), self);
+  g_signal_connect(replace, "clicked", G_CALLBACK(replace_clicked), self);
+  g_signal_connect(replace_all, "clicked", G_CALLBACK(replace_all_clicked),
+                   self);
+  g_signal_connect(close, "clicked", G_CALLBACK(close_clicked), self);
+
+  gtk_widget_set_visible(GTK_WIDGET(self), FALSE);
+}
+
+NotesFindBar *
+notes_find_bar_new(GtkTextView *view)
+{
+  NotesFindBar *self = g_object_new(NOTES_TYPE_FIND_BAR, "orientation",
+                                    GTK_ORIENTATION_HORIZONTAL, "spacing", 5,
+                                    NULL);
+
+  self->view = view;
+  g_signal_connect(view, "notify::buffer", G_CALLBACK(view_buffer_changed),
+                   self);
+
+  return self;
+}
+
+/* Shows the bar, searching for the selection if there is a short one */
+void
+notes_find_bar_show(NotesFindBar *self)
+{
+  GtkTextIter start;
+  GtkTextIter end;
+
+  g_return_if_fail(self != NULL);
+
+  gtk_widget_set_visible(GTK_WIDGET(self), TRUE);
+
+  if (self->buffer != gtk_text_view_get_buffer(self->view)) {
+    set_buffer(self, gtk_text_view_get_buffer(self->view));
+  }
+
+  if (self->buffer != NULL &&
+      gtk_text_buffer_get_selection_bounds(self->buffer, &start, &end) &&
+      gtk_text_iter_get_line(&start) == gtk_text_iter_get_line(&end)) {
+    gchar *selected = gtk_text_iter_get_text(&start, &end);
+
+    gtk_editable_set_text(GTK_EDITABLE(self->find), selected);
+    g_free(selected);
+  }
+
+  refresh(self);
+  gtk_widget_grab_focus(self->find);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glib-object.h>
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Type declaration.
+ */
+
+#define NOTES_TYPE_FIND_BAR notes_find_bar_get_type()
+G_DECLARE_FINAL_TYPE(NotesFindBar, notes_find_bar, NOTES, FIND_BAR, GtkBox)
+
+/*
+ * Method definitions.
+ */
+NotesFindBar *notes_find_bar_new(GtkTextView *view);
+
+void notes_find_bar_show(NotesFindBar *self);
+
+G_END_DECLS
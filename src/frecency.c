@@ -0,0 +1,164 @@
+#include <glib.h>
+#include <math.h>
+#include <string.h>
+
+#include "frecency.h"
+
+/* How often and how recently a page was used, as one number. Every visit
+ * adds its weight, and weights lose half their value every HALF_LIFE_DAYS.
+ * Instead of decaying all scores as time passes, visits count for more the
+ * later they happen:
+ *
+ *   score = ln(sum of weight * e^(rate * days since the epoch))
+ *
+ * which orders pages the same as the decayed sum does at any moment, never
+ * changes for pages that are not visited and stays in range as a log. So a
+ * visit only moves one page in a list sorted by score. */
+
+#define HALF_LIFE_DAYS 14.0
+#define OPEN_WEIGHT    1.0
+/* Linking to a page says more about it than passing by */
+#define LINK_WEIGHT 2.0
+
+#define USEC_PER_DAY (G_USEC_PER_SEC * G_GINT64_CONSTANT(86400))
+
+void
+frecency_init(Frecency *self)
+{
+  g_return_if_fail(self != NULL);
+
+  self->score = FRECENCY_NEVER;
+  self->opens = 0;
+  self->links = 0;
+}
+
+/* ln(e^a + e^b) without leaving the log domain */
+static gdouble
+log_add(gdouble a, gdouble b)
+{
+  gdouble hi = MAX(a, b);
+  gdouble lo = MIN(a, b);
+
+  if (lo == FRECENCY_NEVER) {
+    return hi;
+  }
+
+  return hi + log1p(exp(lo - hi));
+}
+
+static void
+visit(Frecency *self, gdouble weight, gint64 now)
+{
+  gdouble days = (gdouble) now / USEC_PER_DAY;
+
+  self->score = log_add(self->score,
+                        log(weight) + days * G_LN2 / HALF_LIFE_DAYS);
+}
+
+/* now is in microseconds since the epoch, as g_get_real_time() gives it */
+void
+frecency_opened(Frecency *self, gint64 now)
+{
+  g_return_if_fail(self != NULL);
+
+  visit(self, OPEN_WEIGHT, now);
+  self->opens++;
+}
+
+void
+frecency_linked(Frecency *self, gint64 now)
+{
+  g_return_if_fail(self != NULL);
+
+  visit(self, LINK_WEIGHT, now);
+  self->links++;
+}
+
+/* Most used first */
+gint
+frecency_cmp(const Frecency *a, const Frecency *b)
+{
+  return (a->score < b->score) - (a->score > b->score);
+}
+
+static void
+frecency_free(Frecency *self)
+{
+  g_free(self);
+}
+
+/* heading -> Frecency of the pages in the file, one per line as
+ *
+ *   score <tab> opens <tab> links <tab> heading */
+GHashTable *
+frecency_read(const gchar *path, GError **error)
+{
+  GHashTable *res;
+  gchar *content;
+  gchar **lines;
+
+  g_return_val_if_fail(path != NULL, NULL);
+
+  if (!g_file_get_contents(path, &content, NULL, error)) {
+    return NULL;
+  }
+
+  res = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                              (GDestroyNotify) frecency_free);
+  lines = g_strsplit(content, "\n", -1);
+
+  for (guint i = 0; lines[i] != NULL; i++) {
+    gchar **fields = g_strsplit(lines[i], "\t", 4);
+    Frecency *record;
+
+    /* Skips the empty last line and anything else that is off */
+    if (g_strv_length(fields) == 4 && fields[3][0] != '\0') {
+      record = g_malloc0(sizeof(*record));
+      record->score = g_ascii_strtod(fields[0], NULL);
+      record->opens = g_ascii_strtoull(fields[1], NULL, 10);
+      record->links = g_ascii_strtoull(fields[2], NULL, 10);
+      g_hash_table_insert(res, g_strdup(fields[3]), record);
+    }
+
+    g_strfreev(fields);
+  }
+
+  g_strfreev(lines);
+  g_free(content);
+
+  return res;
+}
+
+/* Takes heading -> Frecency, pages never used are left out */
+gboolean
+frecency_write(const gchar *path, GHashTable *records, GError **error)
+{
+  gchar score[G_ASCII_DTOSTR_BUF_SIZE];
+  GHashTableIter iter;
+  const gchar *heading;
+  Frecency *record;
+  GString *out;
+  gboolean res;
+
+  g_return_val_if_fail(path != NULL, FALSE);
+  g_return_val_if_fail(records != NULL, FALSE);
+
+  out = g_string_new("");
+
+  g_hash_table_iter_init(&iter, records);
+  while (g_hash_table_iter_next(&iter, (gpointer *) &heading,
+                                (gpointer *) &record)) {
+    if (record->score == FRECENCY_NEVER || strchr(heading, '\n') != NULL) {
+      continue;
+    }
+
+    g_string_append_printf(out, "%s\t%u\t%u\t%s\n",
+                           g_ascii_dtostr(score, sizeof(score), record->score),
+                           record->opens, record->links, heading);
+  }
+
+  res = g_file_set_contents(path, out->str, out->len, error);
+  g_string_free(out, TRUE);
+
+  return res;
+}
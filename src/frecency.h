@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Name of the file the scores are kept in, in the workspace folder */
+#define FRECENCY_FILE ".notes-editor.frecency"
+
+/* Score of a page that was never opened or linked */
+#define FRECENCY_NEVER (-G_MAXDOUBLE)
+
+typedef struct {
+  /* Log of the decayed sum of all visits, see frecency.c */
+  gdouble score;
+  guint opens;
+  guint links;
+} Frecency;
+
+void frecency_init(Frecency *self);
+
+void frecency_opened(Frecency *self, gint64 now);
+
+void frecency_linked(Frecency *self, gint64 now);
+
+gint frecency_cmp(const Frecency *a, const Frecency *b);
+
+GHashTable *frecency_read(const gchar *path, GError **error);
+
+gboolean frecency_write(const gchar *path, GHashTable *records, GError **error);
+
+G_END_DECLS
@@ -0,0 +1,82 @@
+#include <glib.h>
+
+#include "fuzzy.h"
+
+/* Subsequence matching for the quick switcher. Both the keys and the
+ * pattern are folded to lowercase ASCII once, so scoring a key is a single
+ * forward walk over plain bytes. */
+
+#define BONUS_FIRST       8
+#define BONUS_WORD_START  6
+#define BONUS_CONSECUTIVE 5
+#define MAX_GAP_PENALTY   3
+
+/* Lowercase ASCII with accents dropped, "Émile" -> "emile" */
+gchar *
+fuzzy_fold(const gchar *text)
+{
+  gchar *ascii;
+  gchar *res;
+
+  g_return_val_if_fail(text != NULL, NULL);
+
+  ascii = g_str_to_ascii(text, "C");
+  res = g_ascii_strdown(ascii, -1);
+  g_free(ascii);
+
+  return res;
+}
+
+/* Higher is better. Letters at the start of words and runs of letters
+ * count more, gaps and long keys count against. Spaces in the pattern
+ * only separate words and match nothing themselves. */
+gint
+fuzzy_score(const gchar *key, const gchar *pattern)
+{
+  const gchar *k = key;
+  gint prev = -1;
+  gint score = 0;
+
+  g_return_val_if_fail(key != NULL, FUZZY_NO_MATCH);
+  g_return_val_if_fail(pattern != NULL, FUZZY_NO_MATCH);
+
+  for (const gchar *p = pattern; *p != '\0'; p++) {
+    gint pos;
+
+    if (*p == ' ') {
+      continue;
+    }
+
+    while (*k != '\0' && *k != *p) {
+      k++;
+    }
+    if (*k == '\0') {
+      return FUZZY_NO_MATCH;
+    }
+
+    pos = k - key;
+    score++;
+
+    if (pos == 0) {
+      score += BONUS_FIRST;
+    } else if (!g_ascii_isalnum(key[pos - 1])) {
+      score += BONUS_WORD_START;
+    }
+
+    if (prev >= 0 && pos == prev + 1) {
+      score += BONUS_CONSECUTIVE;
+    } else if (prev >= 0) {
+      score -= MIN(pos - prev - 1, MAX_GAP_PENALTY);
+    }
+
+    prev = pos;
+    k++;
+  }
+
+  /* Between equal matches the shorter heading is closer */
+  while (*k != '\0') {
+    k++;
+  }
+
+  return score * 16 - MIN((gint) (k - key), 15);
+}
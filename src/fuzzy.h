@@ -0,0 +1,14 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Returned by fuzzy_score() when the pattern is not a subsequence */
+#define FUZZY_NO_MATCH G_MININT
+
+gchar *fuzzy_fold(const gchar *text);
+
+gint fuzzy_score(const gchar *key, const gchar *pattern);
+
+G_END_DECLS
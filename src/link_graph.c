@@ -0,0 +1,385 @@
+#include <glib.h>
+#include <string.h>
+
+#include "link_graph.h"
+
+/* The links between pages as a directed graph, built from names alone so
+ * no page or buffer has to exist for it. Every name gets a dense id, the
+ * edges are collected as pairs and turned into a compressed adjacency list
+ * (offsets into one target array) the first time they are walked. */
+
+struct edge {
+  guint from;
+  guint to;
+};
+
+struct _LinkGraph {
+  /* name -> id + 1, names are owned by the array below */
+  GHashTable *ids;
+  GPtrArray *names;
+  /* guint8 per id, set for names that have a page of their own */
+  GArray *exists;
+  GArray *edges;
+
+  /* Built on demand, cleared whenever a link is added */
+  gboolean compact;
+  GArray *offsets;
+  GArray *targets;
+};
+
+LinkGraph *
+link_graph_new(void)
+{
+  LinkGraph *self = g_malloc0(sizeof(*self));
+
+  self->ids = g_hash_table_new(g_str_hash, g_str_equal);
+  self->names = g_ptr_array_new_with_free_func(g_free);
+  self->exists = g_array_new(FALSE, TRUE, sizeof(guint8));
+  self->edges = g_array_new(FALSE, FALSE, sizeof(struct edge));
+  self->offsets = g_array_new(FALSE, TRUE, sizeof(guint));
+  self->targets = g_array_new(FALSE, FALSE, sizeof(guint));
+
+  return self;
+}
+
+void
+link_graph_free(LinkGraph *self)
+{
+  if (self == NULL) {
+    return;
+  }
+
+  g_hash_table_unref(self->ids);
+  g_ptr_array_unref(self->names);
+  g_array_unref(self->exists);
+  g_array_unref(self->edges);
+  g_array_unref(self->offsets);
+  g_array_unref(self->targets);
+  g_free(self);
+}
+
+static guint
+node_id(LinkGraph *self, const gchar *name)
+{
+  gpointer id;
+  gchar *key;
+
+  id = g_hash_table_lookup(self->ids, name);
+  if (id != NULL) {
+    return GPOINTER_TO_UINT(id) - 1;
+  }
+
+  key = g_strdup(name);
+  g_ptr_array_add(self->names, key);
+  g_array_set_size(self->exists, self->names->len);
+  g_hash_table_insert(self->ids, key, GUINT_TO_POINTER(self->names->len));
+
+  return self->names->len - 1;
+}
+
+/* A page that exists, as opposed to a name that is only linked to */
+void
+link_graph_add_page(LinkGraph *self, const gchar *name)
+{
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(name != NULL);
+
+  g_array_index(self->exists, guint8, node_id(self, name)) = TRUE;
+}
+
+void
+link_graph_add_link(LinkGraph *self, const gchar *from, const gchar *to)
+{
+  struct edge edge;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(from != NULL);
+  g_return_if_fail(to != NULL);
+
+  edge.from = node_id(self, from);
+  edge.to = node_id(self, to);
+
+  g_array_append_val(self->edges, edge);
+  self->compact = FALSE;
+}
+
+guint
+link_graph_n_pages(LinkGraph *self)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  return self->names->len;
+}
+
+guint
+link_graph_n_links(LinkGraph *self)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  return self->edges->len;
+}
+
+/* Counting sort of the edges by source, duplicates are kept */
+static void
+compact(LinkGraph *self)
+{
+  guint n = self->names->len;
+  guint *fill;
+
+  if (self->compact) {
+    return;
+  }
+
+  g_array_set_size(self->offsets, n + 1);
+  memset(self->offsets->data, 0, (n + 1) * sizeof(guint));
+  g_array_set_size(self->targets, self->edges->len);
+
+  for (guint i = 0; i < self->edges->len; i++) {
+    g_array_index(self->offsets, guint,
+                  g_array_index(self->edges, struct edge, i).from + 1)++;
+  }
+
+  for (guint i = 0; i < n; i++) {
+    g_array_index(self->offsets, guint, i + 1) +=
+      g_array_index(self->offsets, guint, i);
+  }
+
+  fill = g_memdup2(self->offsets->data, n * sizeof(guint));
+  for (guint i = 0; i < self->edges->len; i++) {
+    struct edge *edge = &g_array_index(self->edges, struct edge, i);
+
+    g_array_index(self->targets, guint, fill[edge->from]++) = edge->to;
+  }
+  g_free(fill);
+
+  self->compact = TRUE;
+}
+
+static gint
+name_cmp(gconstpointer a, gconstpointer b)
+{
+  return g_strcmp0(*((const gchar **) a), *((const gchar **) b));
+}
+
+/* Pages no other page links to, sorted by name. The names are owned by the
+ * graph. */
+GPtrArray *
+link_graph_orphans(LinkGraph *self)
+{
+  GPtrArray *res = g_ptr_array_new();
+  guint8 *linked;
+
+  g_return_val_if_fail(self != NULL, res);
+
+  linked = g_malloc0(self->names->len);
+  for (guint i = 0; i < self->edges->len; i++) {
+    struct edge *edge = &g_array_index(self->edges, struct edge, i);
+
+    if (edge->from != edge->to) {
+      linked[edge->to] = TRUE;
+    }
+  }
+
+  for (guint i = 0; i < self->names->len; i++) {
+    if (g_array_index(self->exists, guint8, i) && !linked[i]) {
+      g_ptr_array_add(res, self->names->pdata[i]);
+    }
+  }
+
+  g_free(linked);
+  g_ptr_array_sort(res, name_cmp);
+  return res;
+}
+
+/* Names that are linked to but have no page, sorted by name. The names are
+ * owned by the graph. */
+GPtrArray *
+link_graph_dangling(LinkGraph *self)
+{
+  GPtrArray *res = g_ptr_array_new();
+
+  g_return_val_if_fail(self != NULL, res);
+
+  for (guint i = 0; i < self->names->len; i++) {
+    if (!g_array_index(self->exists, guint8, i)) {
+      g_ptr_array_add(res, self->names->pdata[i]);
+    }
+  }
+
+  g_ptr_array_sort(res, name_cmp);
+  return res;
+}
+
+#define UNVISITED G_MAXUINT
+
+struct frame {
+  guint node;
+  guint next;
+};
+
+/* Groups of two or more pages that can all reach each other, as a
+ * GPtrArray of GPtrArray of names owned by the graph. Tarjan's algorithm
+ * with an explicit stack, link chains are long enough to overflow the real
+ * one. */
+GPtrArray *
+link_graph_clusters(LinkGraph *self)
+{
+  GPtrArray *res = g_ptr_array_new_with_free_func(
+    (GDestroyNotify) g_ptr_array_unref);
+  GArray *calls;
+  GArray *stack;
+  guint *index;
+  guint *low;
+  guint8 *on_stack;
+  guint n;
+  guint counter = 0;
+
+  g_return_val_if_fail(self != NULL, res);
+
+  compact(self);
+
+  n = self->names->len;
+  index = g_malloc(n * sizeof(guint));
+  low = g_malloc(n * sizeof(guint));
+  on_stack = g_malloc0(n);
+  calls = g_array_new(FALSE, FALSE, sizeof(struct frame));
+  stack = g_array_new(FALSE, FALSE, sizeof(guint));
+
+  for (guint i = 0; i < n; i++) {
+    index[i] = UNVISITED;
+  }
+
+  for (guint root = 0; root < n; root++) {
+    struct frame start = { root, 0 };
+
+    if (index[root] != UNVISITED) {
+      continue;
+    }
+
+    start.next = g_array_index(self->offsets, guint, root);
+    g_array_append_val(calls, start);
+    index[root] = low[root] = counter++;
+    g_array_append_val(stack, root);
+    on_stack[root] = TRUE;
+
+    while (calls->len > 0) {
+      struct frame *top = &g_array_index(calls, struct frame, calls->len - 1);
+      guint v = top->node;
+      guint end = g_array_index(self->offsets, guint, v + 1);
+
+      if (top->next < end) {
+        guint w = g_array_index(self->targets, guint, top->next++);
+
+        if (index[w] == UNVISITED) {
+          struct frame call = { w, g_array_index(self->offsets, guint, w) };
+
+          index[w] = low[w] = counter++;
+          g_array_append_val(stack, w);
+          on_stack[w] = TRUE;
+          /* Invalidates top */
+          g_array_append_val(calls, call);
+        } else if (on_stack[w]) {
+          low[v] = MIN(low[v], index[w]);
+        }
+        continue;
+      }
+
+      /* Done with v, return to the caller */
+      g_array_set_size(calls, calls->len - 1);
+      if (calls->len > 0) {
+        guint caller = g_array_index(calls, struct frame, calls->len - 1).node;
+
+        low[caller] = MIN(low[caller], low[v]);
+      }
+
+      if (low[v] == index[v]) {
+        GPtrArray *cluster = g_ptr_array_new();
+        guint w;
+
+        do {
+          w = g_array_index(stack, guint, stack->len - 1);
+          g_array_set_size(stack, stack->len - 1);
+          on_stack[w] = FALSE;
+          g_ptr_array_add(cluster, self->names->pdata[w]);
+        } while (w != v);
+
+        if (cluster->len > 1) {
+          g_ptr_array_sort(cluster, name_cmp);
+          g_ptr_array_add(res, cluster);
+        } else {
+          g_ptr_array_unref(cluster);
+        }
+      }
+    }
+  }
+
+  g_array_unref(stack);
+  g_array_unref(calls);
+  g_free(on_stack);
+  g_free(low);
+  g_free(index);
+
+  return res;
+}
+
+static void
+append_dot_id(GString *dot, const gchar *name)
+{
+  g_string_append_c(dot, '"');
+  for (const gchar *c = name; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      g_string_append_c(dot, '\\');
+    }
+    g_string_append_c(dot, *c);
+  }
+  g_string_append_c(dot, '"');
+}
+
+/* Graphviz source, pages without a page of their own are dashed. Repeated
+ * links between the same pages become one edge. */
+GString *
+link_graph_to_dot(LinkGraph *self)
+{
+  GString *dot = g_string_new("digraph notes {\n");
+  guint *seen;
+
+  g_return_val_if_fail(self != NULL, dot);
+
+  compact(self);
+
+  for (guint i = 0; i < self->names->len; i++) {
+    g_string_append(dot, "  ");
+    append_dot_id(dot, self->names->pdata[i]);
+    if (!g_array_index(self->exists, guint8, i)) {
+      g_string_append(dot, " [style=dashed]");
+    }
+    g_string_append(dot, ";\n");
+  }
+
+  /* seen[to] == from + 1 when the edge was already written */
+  seen = g_malloc0(self->names->len * sizeof(guint));
+
+  for (guint from = 0; from < self->names->len; from++) {
+    guint end = g_array_index(self->offsets, guint, from + 1);
+
+    for (guint e = g_array_index(self->offsets, guint, from); e < end; e++) {
+      guint to = g_array_index(self->targets, guint, e);
+
+      if (seen[to] == from + 1) {
+        continue;
+      }
+      seen[to] = from + 1;
+
+      g_string_append(dot, "  ");
+      append_dot_id(dot, self->names->pdata[from]);
+      g_string_append(dot, " -> ");
+      append_dot_id(dot, self->names->pdata[to]);
+      g_string_append(dot, ";\n");
+    }
+  }
+
+  g_free(seen);
+  g_string_append(dot, "}\n");
+
+  return dot;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _LinkGraph LinkGraph;
+
+LinkGraph *link_graph_new(void);
+
+void link_graph_free(LinkGraph *self);
+
+void link_graph_add_page(LinkGraph *self, const gchar *name);
+
+void link_graph_add_link(LinkGraph *self, const gchar *from, const gchar *to);
+
+guint link_graph_n_pages(LinkGraph *self);
+
+guint link_graph_n_links(LinkGraph *self);
+
+GPtrArray *link_graph_orphans(LinkGraph *self);
+
+GPtrArray *link_graph_dangling(LinkGraph *self);
+
+GPtrArray *link_graph_clusters(LinkGraph *self);
+
+GString *link_graph_to_dot(LinkGraph *self);
+
+G_END_DECLS
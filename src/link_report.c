@@ -0,0 +1,248 @@
+#include <adwaita.h>
+#include <glib.h>
+#include <string.h>
+
+#include "dialog.h"
+#include "editor_page.h"
+#include "link_graph.h"
+#include "link_report.h"
+#include "markdown.h"
+
+/* Orphans, placeholders and clusters of the workspace on disk. The files
+ * are read and parsed in a worker, no page or buffer is involved, so pages
+ * that only exist as placeholders in the editor show up as dangling. */
+
+struct link_report {
+  GtkWindow *parent;
+  gchar *root_path;
+  LinkGraph *graph;
+  gdouble seconds;
+};
+
+static void
+link_report_free(struct link_report *report)
+{
+  g_clear_object(&report->parent);
+  g_free(report->root_path);
+  link_graph_free(report->graph);
+  g_free(report);
+}
+
+static void
+add_file(LinkGraph *graph, const gchar *content)
+{
+  MarkdownDoc *md;
+  gchar *heading;
+
+  heading = editor_page_read_header(content, NULL);
+  if (heading == NULL) {
+    return;
+  }
+
+  link_graph_add_page(graph, heading);
+
+  md = markdown_parse(markdown_skip_front_matter(content), -1);
+  for (guint i = 0; i < md->spans->len; i++) {
+    MarkdownSpan *span = &g_array_index(md->spans, MarkdownSpan, i);
+
+    if (span->type == MARKDOWN_SPAN_LINK) {
+      link_graph_add_link(graph, heading, span->target);
+    }
+  }
+
+  markdown_doc_free(md);
+  g_free(heading);
+}
+
+static void
+build_thread(GTask *task,
+             G_GNUC_UNUSED gpointer source_object,
+             gpointer task_data,
+             G_GNUC_UNUSED GCancellable *cancellable)
+{
+  struct link_report *report = task_data;
+  GError *lerr = NULL;
+  const gchar *filename;
+  GTimer *timer;
+  GDir *dir;
+
+  dir = g_dir_open(report->root_path, 0, &lerr);
+  if (dir == NULL) {
+    g_task_return_error(task, lerr);
+    return;
+  }
+
+  timer = g_timer_new();
+
+  while ((filename = g_dir_read_name(dir))) {
+    gchar *full_path;
+    gchar *content;
+
+    if (!g_str_has_suffix(filename, ".md")) {
+      continue;
+    }
+
+    full_path = g_build_filename(report->root_path, filename, NULL);
+    if (g_file_get_contents(full_path, &content, NULL, NULL)) {
+      add_file(report->graph, content);
+      g_free(content);
+    }
+    g_free(full_path);
+  }
+
+  report->seconds = g_timer_elapsed(timer, NULL);
+  g_timer_destroy(timer);
+  g_dir_close(dir);
+
+  g_task_return_boolean(task, TRUE);
+}
+
+static void
+append_names(GString *text, const gchar *title, GPtrArray *names)
+{
+  g_string_append_printf(text, "%s (%u)\n", title, names->len);
+  for (guint i = 0; i < names->len; i++) {
+    g_string_append_printf(text, "  %s\n", (gchar *) names->pdata[i]);
+  }
+  g_string_append(text, "\n");
+}
+
+static gchar *
+report_text(struct link_report *report)
+{
+  GString *text = g_string_new("");
+  GPtrArray *names;
+  GPtrArray *clusters;
+
+  g_string_append_printf(text, "%u pages and %u links, read in %.0f ms\n\n",
+                         link_graph_n_pages(report->graph),
+                         link_graph_n_links(report->graph),
+                         report->seconds * 1000);
+
+  names = link_graph_orphans(report->graph);
+  append_names(text, "Not linked from any page", names);
+  g_ptr_array_unref(names);
+
+  names = link_graph_dangling(report->graph);
+  append_names(text, "Linked to but without a file", names);
+  g_ptr_array_unref(names);
+
+  clusters = link_graph_clusters(report->graph);
+  g_string_append_printf(text, "Pages linking to each other (%u groups)\n",
+                         clusters->len);
+  for (guint i = 0; i < clusters->len; i++) {
+    GPtrArray *cluster = clusters->pdata[i];
+
+    g_string_append(text, " ");
+    for (guint j = 0; j < cluster->len; j++) {
+      g_string_append_printf(text, " %s%s", (gchar *) cluster->pdata[j],
+                             j + 1 < cluster->len ? "," : "");
+    }
+    g_string_append(text, "\n");
+  }
+  g_ptr_array_unref(clusters);
+
+  return g_string_free(text, FALSE);
+}
+
+static void
+dot_file_selected(GFile *file, gpointer user_data)
+{
+  const gchar *dot = user_data;
+  GError *lerr = NULL;
+
+  if (!g_file_replace_contents(file, dot, strlen(dot), NULL, FALSE,
+                               G_FILE_CREATE_REPLACE_DESTINATION, NULL, NULL,
+                               &lerr)) {
+    g_warning("Could not write the graph: %s", lerr->message);
+    g_clear_error(&lerr);
+  }
+}
+
+/* The dialog gets a DOT string of its own, the report and its graph are
+ * gone when the window is closed before a file is picked */
+static void
+export_clicked(GtkButton *button, struct link_report *report)
+{
+  GString *dot = link_graph_to_dot(report->graph);
+
+  dialog_file_save(GTK_WINDOW(gtk_widget_get_root(GTK_WIDGET(button))),
+                   "Export link graph", "_Save", "links.dot",
+                   dot_file_selected, g_string_free(dot, FALSE), g_free);
+}
+
+static void
+graph_built(G_GNUC_UNUSED GObject *source_object,
+            GAsyncResult *res,
+            gpointer user_data)
+{
+  struct link_report *report = user_data;
+  GError *lerr = NULL;
+  GtkWidget *window;
+  GtkWidget *header;
+  GtkWidget *box;
+  GtkWidget *scroll;
+  GtkWidget *view;
+  GtkWidget *export;
+  gchar *text;
+
+  if (!g_task_propagate_boolean(G_TASK(res), &lerr)) {
+    g_warning("Could not read the workspace: %s", lerr->message);
+    g_clear_error(&lerr);
+    link_report_free(report);
+    return;
+  }
+
+  window = adw_window_new();
+  gtk_window_set_transient_for(GTK_WINDOW(window), report->parent);
+  gtk_window_set_default_size(GTK_WINDOW(window), 600, 600);
+  /* The export button needs the graph as long as the window is open */
+  g_object_set_data_full(G_OBJECT(window), "report", report,
+                         (GDestroyNotify) link_report_free);
+
+  header = adw_header_bar_new();
+  adw_header_bar_set_title_widget(ADW_HEADER_BAR(header),
+                                  adw_window_title_new("Links", NULL));
+
+  export = gtk_button_new_with_label("Export DOT");
+  g_signal_connect(export, "clicked", G_CALLBACK(export_clicked), report);
+  adw_header_bar_pack_end(ADW_HEADER_BAR(header), export);
+
+  text = report_text(report);
+  view = gtk_text_view_new();
+  gtk_text_view_set_editable(GTK_TEXT_VIEW(view), FALSE);
+  gtk_text_view_set_left_margin(GTK_TEXT_VIEW(view), 20);
+  gtk_text_buffer_set_text(gtk_text_view_get_buffer(GTK_TEXT_VIEW(view)), text,
+                           -1);
+  g_free(text);
+
+  scroll = gtk_scrolled_window_new();
+  gtk_widget_set_vexpand(scroll, TRUE);
+  gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scroll), view);
+
+  box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+  gtk_box_append(GTK_BOX(box), header);
+  gtk_box_append(GTK_BOX(box), scroll);
+  adw_window_set_content(ADW_WINDOW(window), box);
+
+  gtk_window_present(GTK_WINDOW(window));
+}
+
+void
+link_report_show(GtkWindow *parent, const gchar *root_path)
+{
+  struct link_report *report;
+  GTask *task;
+
+  g_return_if_fail(root_path != NULL);
+
+  report = g_malloc0(sizeof(*report));
+  report->parent = parent != NULL ? g_object_ref(parent) : NULL;
+  report->root_path = g_strdup(root_path);
+  report->graph = link_graph_new();
+
+  task = g_task_new(NULL, NULL, graph_built, report);
+  g_task_set_task_data(task, report, NULL);
+  g_task_run_in_thread(task, build_thread);
+  g_object_unref(task);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <glib-object.h>
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+void link_report_show(GtkWindow *parent, const gchar *root_path);
+
+G_END_DECLS
@@ -4,11 +4,22 @@
 #include <glib/gstdio.h>
 #include <gtk/gtk.h>
 
+#include "batch.h"
 #include "dialog.h"
 #include "edit_tags.h"
 #include "editor_page.h"
+#include "backlinks_panel.h"
+#include "find_bar.h"
+#include "link_report.h"
+#include "markdown.h"
 #include "notes_page_list.h"
 #include "notes_tag_list.h"
+#include "page_cache.h"
+#include "quick_switcher.h"
+#include "search_bar.h"
+#include "search_cache.h"
+#include "search_index.h"
+#include "trigram_index.h"
 #include "sidebar.h"
 
 /*
@@ -27,6 +38,26 @@ static GtkWindow *app_window;
 static gchar *workspace_path = NULL;
 #define WS_NAME_FILE   ".notes-editor"
 #define APPLICATION_ID "com.github.jsol.notes-editor"
+/* Memory allowed for text buffers before inactive pages are released,
+ * overridden in MiB by NOTES_EDITOR_BUFFER_BUDGET */
+#define BUFFER_BUDGET_ENV     "NOTES_EDITOR_BUFFER_BUDGET"
+#define BUFFER_BUDGET_DEFAULT (64 * 1024 * 1024)
+/* Undo steps shared by all pages, the least recently viewed lose theirs
+ * first */
+#define UNDO_BUDGET_LEVELS 1000
+/* Quiet time after an edit before the page is indexed again */
+#define REINDEX_DELAY_MS 500
+/* Quiet time after typing in the page header before the page is renamed */
+#define RENAME_DELAY_MS 400
+
+static EditorPage *reindex_pending = NULL;
+static guint reindex_source = 0;
+/* Pages handed to index workers that have not come back yet */
+static guint index_jobs = 0;
+/* Heading typed for a page, applied once typing stops */
+static EditorPage *rename_pending = NULL;
+static gchar *rename_heading = NULL;
+static guint rename_source = 0;
 
 static const gchar *
 get_current_ws(void)
@@ -80,21 +111,56 @@ save_current_ws(const gchar *path)
   g_free(save_file);
 }
 
+static GtkWidget *
+anchor_button(GtkTextChildAnchor *anchor)
+{
+  GtkWidget *button;
+  EditorPage *target;
+
+  target = g_object_get_data(G_OBJECT(anchor), "target");
+
+  button = editor_page_in_content_button(target);
+  g_object_set_data(G_OBJECT(button), "anchor", anchor);
+
+  return button;
+}
+
 static void
 anchors_foreach(gpointer data, gpointer user_data)
 {
   GtkTextView *view = GTK_TEXT_VIEW(user_data);
   GtkTextChildAnchor *anchor = GTK_TEXT_CHILD_ANCHOR(data);
-  EditorPage *target;
 
   if (gtk_text_child_anchor_get_deleted(anchor)) {
     return;
   }
 
-  target = g_object_get_data(G_OBJECT(anchor), "target");
+  gtk_text_view_add_child_at_anchor(view, anchor_button(anchor), anchor);
+}
+
+/* Renaming relabels every button of the page and moves it in the page
+ * list, so it is done once for a heading and not for every character */
+static gboolean
+rename_cb(G_GNUC_UNUSED gpointer user_data)
+{
+  rename_source = 0;
+
+  if (rename_pending != NULL) {
+    g_object_set(rename_pending, "heading", rename_heading, NULL);
+  }
 
-  gtk_text_view_add_child_at_anchor(view, editor_page_in_content_button(target),
-                                    anchor);
+  g_clear_object(&rename_pending);
+  g_clear_pointer(&rename_heading, g_free);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+flush_rename(void)
+{
+  if (rename_source != 0) {
+    g_source_remove(rename_source);
+    rename_cb(NULL);
+  }
 }
 
 static void
@@ -102,30 +168,52 @@ header_changed(GtkEditable *self, gpointer user_data)
 {
   EditorPage *page = EDITOR_PAGE(user_data);
 
-  g_object_set(page, "heading", gtk_editable_get_text(self), NULL);
+  if (rename_pending != page) {
+    flush_rename();
+    rename_pending = g_object_ref(page);
+  }
+
+  if (rename_source != 0) {
+    g_source_remove(rename_source);
+  }
+
+  g_free(rename_heading);
+  rename_heading = g_strdup(gtk_editable_get_text(self));
+  rename_source = g_timeout_add(RENAME_DELAY_MS, rename_cb, NULL);
 }
 
+/* Done editing the header, by focus-out or enter */
 static void
-update_css()
+header_editing(GObject *self,
+               G_GNUC_UNUSED GParamSpec *spec,
+               G_GNUC_UNUSED gpointer user_data)
+{
+  if (!gtk_editable_label_get_editing(GTK_EDITABLE_LABEL(self))) {
+    flush_rename();
+  }
+}
+
+/* One provider for the application, styles do not depend on the pages so
+ * it is loaded once and opening a workspace does not touch it */
+static void
+install_css(GObject *app)
 {
-  GdkDisplay *display;
   GtkCssProvider *provider;
-  GString *style = g_string_new(
-    ".in-text-button {padding: 0px; margin: 0px;  "
-    "margin-bottom: -8px;} .in-list-button "
-    "{padding: 0px; margin: 0px;  margin-left: 15px; margin-bottom: -8px;"
-    " font-weight: normal;}");
+  const gchar *style = ".in-text-button {padding: 0px; margin: 0px;  "
+                       "margin-bottom: -8px;}";
 
-  display = gdk_display_get_default();
+  if (g_object_get_data(app, "css_provider") != NULL) {
+    return;
+  }
 
   provider = gtk_css_provider_new();
-  gtk_css_provider_load_from_data(provider, style->str, strlen(style->str));
+  gtk_css_provider_load_from_data(provider, style, strlen(style));
 
-  gtk_style_context_add_provider_for_display(display,
+  gtk_style_context_add_provider_for_display(gdk_display_get_default(),
                                              GTK_STYLE_PROVIDER(provider),
                                              GTK_STYLE_PROVIDER_PRIORITY_USER);
 
-  g_string_free(style, TRUE);
+  g_object_set_data_full(app, "css_provider", provider, g_object_unref);
 }
 
 /*
@@ -149,6 +237,8 @@ set_page(EditorPage *page, GtkApplication *app)
   EditorPage *current_page;
   GtkWidget *remove_button;
   NotesPageList *pages_list;
+  NotesBacklinksPanel *backlinks;
+  PageCache *cache;
 
   current_page = g_object_get_data(G_OBJECT(app), "current_page");
 
@@ -160,6 +250,14 @@ set_page(EditorPage *page, GtkApplication *app)
   textarea = g_object_get_data(G_OBJECT(app), "textarea");
   remove_button = g_object_get_data(G_OBJECT(app), "remove_button");
   pages_list = g_object_get_data(G_OBJECT(app), "pages_list");
+  cache = g_object_get_data(G_OBJECT(app), "page_cache");
+  backlinks = g_object_get_data(G_OBJECT(app), "backlinks_panel");
+
+  /* Brings back the buffer if it was released */
+  page_cache_touch(cache, page);
+
+  /* The header is about to show another page */
+  flush_rename();
 
   g_signal_handlers_disconnect_matched(content_header, G_SIGNAL_MATCH_FUNC, 0,
                                        0, NULL, header_changed, NULL);
@@ -172,6 +270,8 @@ set_page(EditorPage *page, GtkApplication *app)
 
   g_ptr_array_foreach(page->anchors, anchors_foreach, textarea);
 
+  notes_backlinks_panel_set_page(backlinks, page);
+
   g_signal_connect(content_header, "changed", G_CALLBACK(header_changed), page);
   g_signal_connect(remove_button, "clicked", G_CALLBACK(remove_page), page);
 
@@ -181,10 +281,7 @@ set_page(EditorPage *page, GtkApplication *app)
 }
 
 static void
-single_anchor(EditorPage *page,
-              GtkTextChildAnchor *anchor,
-              GtkWidget *button,
-              GObject *app)
+single_anchor(EditorPage *page, GtkTextChildAnchor *anchor, GObject *app)
 {
   GtkTextView *textarea;
   EditorPage *current_page;
@@ -198,7 +295,7 @@ single_anchor(EditorPage *page,
 
   textarea = g_object_get_data(app, "textarea");
 
-  gtk_text_view_add_child_at_anchor(textarea, button, anchor);
+  gtk_text_view_add_child_at_anchor(textarea, anchor_button(anchor), anchor);
 }
 
 static void
@@ -229,6 +326,246 @@ set_tags(G_GNUC_UNUSED GObject *button, GObject *app)
   edit_tags_show(current_page, tags_list);
 }
 
+/* What the indexes get for a page, also what the trigram index checks its
+ * candidates against */
+static gchar *
+page_search_text(EditorPage *page, G_GNUC_UNUSED gpointer user_data)
+{
+  gchar *text;
+  gchar *res;
+
+  text = editor_page_get_text(page);
+  res = g_strconcat(page->heading, "\n", text, NULL);
+  g_free(text);
+
+  return res;
+}
+
+static gboolean
+reindex_cb(gpointer user_data)
+{
+  GObject *app = G_OBJECT(user_data);
+  SearchIndex *index;
+  TrigramIndex *trigrams;
+  gchar *text;
+
+  reindex_source = 0;
+
+  if (reindex_pending == NULL || !editor_page_is_resident(reindex_pending)) {
+    g_clear_object(&reindex_pending);
+    return G_SOURCE_REMOVE;
+  }
+
+  index = g_object_get_data(app, "search_index");
+  trigrams = g_object_get_data(app, "trigram_index");
+
+  /* Only the edited page, and its buffer is already in memory */
+  text = page_search_text(reindex_pending, NULL);
+  search_index_set_page(index, reindex_pending, search_doc_new(text, -1));
+  trigram_index_set_page(trigrams, reindex_pending, trigram_doc_new(text, -1));
+  g_free(text);
+
+  g_clear_object(&reindex_pending);
+  return G_SOURCE_REMOVE;
+}
+
+/* The cache of the workspace at root, a new one if root is another folder */
+static SearchCache *
+get_search_cache(GObject *app, const gchar *root)
+{
+  SearchCache *cache = g_object_get_data(app, "search_cache");
+
+  if (cache == NULL || g_strcmp0(search_cache_get_root(cache), root) != 0) {
+    cache = search_cache_new(root);
+    g_object_set_data_full(app, "search_cache", cache,
+                           (GDestroyNotify) search_cache_free);
+  }
+
+  return cache;
+}
+
+static void
+write_search_cache(GObject *app)
+{
+  GError *lerr = NULL;
+  SearchCache *cache = g_object_get_data(app, "search_cache");
+
+  if (cache == NULL) {
+    return;
+  }
+
+  if (!search_cache_write(cache, g_object_get_data(app, "search_index"),
+                          g_object_get_data(app, "trigram_index"), &lerr)) {
+    g_warning("Could not save the search index: %s", lerr->message);
+    g_clear_error(&lerr);
+  }
+}
+
+static void
+page_edited(EditorPage *page, GObject *app)
+{
+  SearchCache *cache = g_object_get_data(app, "search_cache");
+
+  /* The index is about to differ from the file */
+  if (cache != NULL) {
+    search_cache_unstamp(cache, page);
+  }
+
+  page_cache_resize(g_object_get_data(app, "page_cache"), page);
+
+  if (reindex_pending != page && reindex_source != 0) {
+    /* Another page is waiting, index it before starting over */
+    g_source_remove(reindex_source);
+    reindex_cb(app);
+  }
+
+  if (reindex_source != 0) {
+    g_source_remove(reindex_source);
+  }
+
+  if (reindex_pending != page) {
+    g_clear_object(&reindex_pending);
+    reindex_pending = g_object_ref(page);
+  }
+
+  reindex_source = g_timeout_add(REINDEX_DELAY_MS, reindex_cb, app);
+}
+
+struct index_job {
+  gchar *text;
+  /* Words restored from the search cache, trigrams only */
+  gboolean cached_words;
+};
+
+static void
+index_job_free(struct index_job *job)
+{
+  g_free(job->text);
+  g_free(job);
+}
+
+struct indexed_page {
+  SearchDoc *words;
+  TrigramDoc *trigrams;
+};
+
+static void
+indexed_page_free(struct indexed_page *indexed)
+{
+  search_doc_free(indexed->words);
+  trigram_doc_free(indexed->trigrams);
+  g_free(indexed);
+}
+
+static void
+index_thread(GTask *task,
+             G_GNUC_UNUSED gpointer source_object,
+             gpointer task_data,
+             G_GNUC_UNUSED GCancellable *cancellable)
+{
+  struct index_job *job = (struct index_job *) task_data;
+  struct indexed_page *indexed = g_malloc0(sizeof(*indexed));
+  MarkdownDoc *md;
+
+  /* Index what ends up in the buffer, not the markup */
+  md = markdown_parse(job->text, -1);
+  if (!job->cached_words) {
+    indexed->words = search_doc_new(md->text->str, md->text->len);
+  }
+  indexed->trigrams = trigram_doc_new(md->text->str, md->text->len);
+  markdown_doc_free(md);
+
+  g_task_return_pointer(task, indexed, (GDestroyNotify) indexed_page_free);
+}
+
+static void
+page_indexed(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  EditorPage *page = EDITOR_PAGE(source_object);
+  struct indexed_page *indexed;
+  SearchIndex *index;
+  TrigramIndex *trigrams;
+
+  index = g_object_get_data(G_OBJECT(user_data), "search_index");
+  trigrams = g_object_get_data(G_OBJECT(user_data), "trigram_index");
+  indexed = g_task_propagate_pointer(G_TASK(res), NULL);
+
+  if (indexed != NULL) {
+    /* Edited while the worker was busy, that is newer */
+    if (indexed->words != NULL && !search_index_has_page(index, page)) {
+      search_index_set_page(index, page, g_steal_pointer(&indexed->words));
+    }
+    if (!trigram_index_has_page(trigrams, page)) {
+      trigram_index_set_page(trigrams, page,
+                             g_steal_pointer(&indexed->trigrams));
+    }
+
+    indexed_page_free(indexed);
+  }
+
+  /* Keep what was indexed for the next launch */
+  if (--index_jobs == 0) {
+    write_search_cache(G_OBJECT(user_data));
+  }
+}
+
+static void
+index_in_background(EditorPage *page,
+                    const gchar *content,
+                    gboolean cached_words,
+                    GObject *app)
+{
+  struct index_job *job = g_malloc0(sizeof(*job));
+  GTask *task;
+
+  job->text = g_strconcat(page->heading, "\n",
+                          markdown_skip_front_matter(content), NULL);
+  job->cached_words = cached_words;
+
+  task = g_task_new(page, NULL, page_indexed, app);
+  g_task_set_task_data(task, job, (GDestroyNotify) index_job_free);
+  g_task_run_in_thread(task, index_thread);
+  g_object_unref(task);
+
+  index_jobs++;
+}
+
+/* Files unchanged since the last launch come from the cache as they are,
+ * without being parsed again. Only new and changed files go to a worker. */
+static void
+index_page(EditorPage *page,
+           const gchar *filename,
+           const gchar *full_path,
+           const gchar *content,
+           SearchCache *cache,
+           GObject *app)
+{
+  SearchStamp stamp;
+  SearchDoc *doc = NULL;
+  TrigramDoc *trigrams;
+
+  if (!search_stamp_read(full_path, &stamp)) {
+    index_in_background(page, content, FALSE, app);
+    return;
+  }
+
+  doc = search_cache_lookup(cache, filename, &stamp);
+  if (doc != NULL) {
+    search_index_set_page(g_object_get_data(app, "search_index"), page, doc);
+  }
+
+  trigrams = search_cache_lookup_trigrams(cache, filename, &stamp);
+  if (doc != NULL && trigrams != NULL) {
+    trigram_index_set_page(g_object_get_data(app, "trigram_index"), page,
+                           trigrams);
+  } else {
+    trigram_doc_free(trigrams);
+    index_in_background(page, content, doc != NULL, app);
+  }
+
+  search_cache_stamp(cache, page, filename, &stamp);
+}
+
 static EditorPage *
 fetch_page(const gchar *name, gpointer user_data)
 {
@@ -242,17 +579,22 @@ page_created(EditorPage *page, GObject *app)
 {
   NotesTagList *tags_list;
   NotesPageList *pages_list;
+  PageCache *cache;
 
   tags_list = g_object_get_data(app, "tags_list");
   pages_list = g_object_get_data(app, "pages_list");
+  cache = g_object_get_data(app, "page_cache");
 
   notes_tag_list_add(tags_list, page);
   notes_page_list_add(pages_list, page);
+  page_cache_add(cache, page);
 
   g_signal_connect(page, "switch-page", G_CALLBACK(set_page), app);
 
   g_signal_connect(page, "new-anchor", G_CALLBACK(single_anchor), app);
 
+  g_signal_connect(page, "edited", G_CALLBACK(page_edited), app);
+
   g_print("Page created: %s\n", page->heading);
 }
 
@@ -271,7 +613,9 @@ prepare_folder(const gchar *base_path)
 static void
 save_page_fn(EditorPage *page, gpointer user_data)
 {
-  gchar *root = (gchar *) user_data;
+  SearchCache *cache = (SearchCache *) user_data;
+  const gchar *root = search_cache_get_root(cache);
+  SearchStamp stamp;
   gchar *file;
   gchar *full_path;
   GString *content;
@@ -287,6 +631,14 @@ save_page_fn(EditorPage *page, gpointer user_data)
   if (!g_file_set_contents(full_path, content->str, content->len, &lerr)) {
     g_warning("Could not save %s: %s", full_path, lerr->message);
     g_clear_error(&lerr);
+  } else {
+    if (editor_page_is_resident(page)) {
+      gtk_text_buffer_set_modified(page->content, FALSE);
+    }
+    /* Its index was brought up to date before saving */
+    if (search_stamp_read(full_path, &stamp)) {
+      search_cache_stamp(cache, page, file, &stamp);
+    }
   }
 
   g_free(file);
@@ -312,16 +664,32 @@ save(GtkApplication *app, const gchar *base_path)
     return;
   }
 
+  /* Files are named after the headings */
+  flush_rename();
+
+  /* The saved files have to match what is in the index */
+  if (reindex_source != 0) {
+    g_source_remove(reindex_source);
+    reindex_cb(app);
+  }
+
   pages_list = g_object_get_data(G_OBJECT(app), "pages_list");
-  notes_page_list_for_each(pages_list, save_page_fn, (gpointer) root);
+  notes_page_list_for_each(pages_list, save_page_fn,
+                           get_search_cache(G_OBJECT(app), root));
+
+  if (index_jobs == 0) {
+    write_search_cache(G_OBJECT(app));
+  }
 }
 
 static void
-pages_load_iter(EditorPage *page, G_GNUC_UNUSED gpointer user_data)
+pages_load_iter(EditorPage *page, gpointer user_data)
 {
   g_assert(page);
 
   editor_page_fix_content(page);
+  /* Pages are added to the cache before they have any text */
+  page_cache_resize(user_data, page);
 }
 
 static void
@@ -334,9 +702,13 @@ load_repo(NotesPageList *pages_list, GtkApplication *app)
   GFile *sync_script;
   const gchar *root_path;
   gchar *content = NULL;
+  SearchCache *cache;
+  NotesTagList *tags_list;
 
   g_assert(pages_list);
 
+  tags_list = g_object_get_data(G_OBJECT(app), "tags_list");
+
   root_path = get_current_ws();
 
   g_message("Loading name: %s", root_path);
@@ -350,6 +722,12 @@ load_repo(NotesPageList *pages_list, GtkApplication *app)
     return;
   }
 
+  cache = get_search_cache(G_OBJECT(app), root_path);
+
+  /* The lists are shown once, with all the pages in */
+  notes_page_list_begin_update(pages_list);
+  notes_tag_list_begin_update(tags_list);
+
   while ((filename = g_dir_read_name(dir))) {
     printf("%s\n", filename);
 
@@ -375,6 +753,13 @@ load_repo(NotesPageList *pages_list, GtkApplication *app)
     page = editor_page_load(content, fetch_page, pages_list,
                             G_CALLBACK(page_created), app);
 
+    if (page != NULL) {
+      /* The front matter is read after the page was created */
+      tag_index_set_page_draft(notes_tag_list_get_index(tags_list), page,
+                               editor_page_is_draft(page));
+      index_page(page, filename, full_path, content, cache, G_OBJECT(app));
+    }
+
     if (!page_set) {
       set_page(page, app);
       page_set = TRUE;
@@ -385,9 +770,14 @@ load_repo(NotesPageList *pages_list, GtkApplication *app)
 
   g_dir_close(dir);
 
-  notes_page_list_for_each(pages_list, pages_load_iter, NULL);
+  notes_tag_list_end_update(tags_list);
+  notes_page_list_end_update(pages_list);
+
+  notes_page_list_load_frecency(pages_list, root_path);
+  notes_page_list_for_each(pages_list, pages_load_iter,
+                           g_object_get_data(G_OBJECT(app), "page_cache"));
 
-  update_css();
+  page_cache_trim(g_object_get_data(G_OBJECT(app), "page_cache"));
 }
 
 static void
@@ -478,6 +868,49 @@ sync_menu_cb(GSimpleAction *simple_action, GVariant *parameter, gpointer *data)
   g_subprocess_wait_check_async(sync_process, NULL, sync_done_cb, app);
 }
 
+static void
+memory_menu_cb(GSimpleAction *simple_action,
+               GVariant *parameter,
+               gpointer *data)
+{
+  GtkApplication *app = GTK_APPLICATION(data);
+  PageCache *cache;
+  AdwToastOverlay *toast_overlay;
+  gchar *resident;
+  gchar *budget;
+  gchar *msg;
+
+  cache = g_object_get_data(G_OBJECT(app), "page_cache");
+  toast_overlay = g_object_get_data(G_OBJECT(app), "toast_overlay");
+
+  resident = g_format_size(page_cache_resident_bytes(cache));
+  budget = g_format_size(page_cache_budget(cache));
+  msg = g_strdup_printf("Text buffers: %s of %s (%u of %u pages loaded)",
+                        resident, budget, page_cache_resident_pages(cache),
+                        page_cache_n_pages(cache));
+
+  g_message("%s", msg);
+  adw_toast_overlay_add_toast(toast_overlay, adw_toast_new(msg));
+
+  g_free(resident);
+  g_free(budget);
+  g_free(msg);
+}
+
+static void
+links_menu_cb(G_GNUC_UNUSED GSimpleAction *simple_action,
+              G_GNUC_UNUSED GVariant *parameter,
+              G_GNUC_UNUSED gpointer *data)
+{
+  const gchar *root_path = get_current_ws();
+
+  if (root_path == NULL) {
+    return;
+  }
+
+  link_report_show(app_window, root_path);
+}
+
 static void
 new_menu_cb(GSimpleAction *simple_action, GVariant *parameter, gpointer *data)
 {
@@ -517,7 +950,43 @@ event_key_released(G_GNUC_UNUSED GtkEventController *self,
   } else if (keyval == 98 && (state & GDK_CONTROL_MASK)) {
     /* ctrl + b*/
     set_heading(NULL, NULL, G_OBJECT(app));
+  } else if (keyval == 102 && (state & GDK_CONTROL_MASK)) {
+    /* ctrl + f */
+    notes_find_bar_show(g_object_get_data(G_OBJECT(app), "find_bar"));
+  } else if (keyval == 112 && (state & GDK_CONTROL_MASK)) {
+    /* ctrl + p */
+    quick_switcher_show(gtk_application_get_active_window(app),
+                        g_object_get_data(G_OBJECT(app), "pages_list"));
+  }
+}
+
+static void
+open_search_result(G_GNUC_UNUSED NotesSearchBar *bar,
+                   EditorPage *page,
+                   const gchar *match,
+                   GtkApplication *app)
+{
+  GtkTextView *textarea;
+  GtkTextIter start;
+  GtkTextIter match_start;
+  GtkTextIter match_end;
+
+  set_page(page, app);
+
+  textarea = g_object_get_data(G_OBJECT(app), "textarea");
+
+  gtk_text_buffer_get_start_iter(page->content, &start);
+
+  if (match != NULL && match[0] != '\0' &&
+      gtk_text_iter_forward_search(&start, match,
+                                   GTK_TEXT_SEARCH_CASE_INSENSITIVE |
+                                     GTK_TEXT_SEARCH_TEXT_ONLY,
+                                   &match_start, &match_end, NULL)) {
+    gtk_text_buffer_select_range(page->content, &match_start, &match_end);
+    gtk_text_view_scroll_to_iter(textarea, &match_start, 0.1, FALSE, 0, 0);
   }
+
+  gtk_widget_grab_focus(GTK_WIDGET(textarea));
 }
 
 static void
@@ -543,6 +1012,14 @@ build_menu(GtkWidget *header, GtkApplication *app)
   g_menu_append_item(menubar, menu_item_menu);
   g_object_unref(menu_item_menu);
 
+  menu_item_menu = g_menu_item_new("Memory", "app.memory");
+  g_menu_append_item(menubar, menu_item_menu);
+  g_object_unref(menu_item_menu);
+
+  menu_item_menu = g_menu_item_new("Links", "app.links");
+  g_menu_append_item(menubar, menu_item_menu);
+  g_object_unref(menu_item_menu);
+
   GSimpleAction *act_open = g_simple_action_new("open", NULL);
   g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(act_open));
   g_signal_connect(act_open, "activate", G_CALLBACK(open_menu_cb), app);
@@ -555,6 +1032,14 @@ build_menu(GtkWidget *header, GtkApplication *app)
   g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(act_sync));
   g_signal_connect(act_sync, "activate", G_CALLBACK(sync_menu_cb), app);
 
+  GSimpleAction *act_memory = g_simple_action_new("memory", NULL);
+  g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(act_memory));
+  g_signal_connect(act_memory, "activate", G_CALLBACK(memory_menu_cb), app);
+
+  GSimpleAction *act_links = g_simple_action_new("links", NULL);
+  g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(act_links));
+  g_signal_connect(act_links, "activate", G_CALLBACK(links_menu_cb), app);
+
   GSimpleAction *act_new = g_simple_action_new("new", NULL);
   g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(act_new));
   g_signal_connect(act_new, "activate", G_CALLBACK(new_menu_cb), app);
@@ -581,6 +1066,27 @@ set_icon(void)
   }
 }
 
+static gsize
+get_buffer_budget(void)
+{
+  const gchar *env;
+  guint64 mib;
+
+  env = g_getenv(BUFFER_BUDGET_ENV);
+
+  if (env == NULL) {
+    return BUFFER_BUDGET_DEFAULT;
+  }
+
+  mib = g_ascii_strtoull(env, NULL, 10);
+  if (mib == 0) {
+    g_warning("Invalid %s: %s", BUFFER_BUDGET_ENV, env);
+    return BUFFER_BUDGET_DEFAULT;
+  }
+
+  return mib * 1024 * 1024;
+}
+
 static void
 activate(GtkApplication *app, gpointer user_data)
 {
@@ -600,9 +1106,21 @@ activate(GtkApplication *app, gpointer user_data)
   GtkWidget *tags_list;
   GtkWidget *toast_overlay;
   NotesPageList *pages_list;
+  NotesSearchBar *search_bar;
+  NotesBacklinksPanel *backlinks;
+  NotesFindBar *find_bar;
+  SearchIndex *search_index;
+  TrigramIndex *trigram_index;
 
   set_icon();
 
+  search_index = search_index_new();
+  g_object_set_data_full(G_OBJECT(app), "search_index", search_index,
+                         (GDestroyNotify) search_index_free);
+  trigram_index = trigram_index_new(page_search_text, NULL);
+  g_object_set_data_full(G_OBJECT(app), "trigram_index", trigram_index,
+                         (GDestroyNotify) trigram_index_free);
+
   textarea = gtk_text_view_new();
 
   scroll = gtk_scrolled_window_new();
@@ -612,6 +1130,8 @@ activate(GtkApplication *app, gpointer user_data)
   content_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
   content_header = gtk_editable_label_new("");
   gtk_widget_add_css_class(content_header, "title-1");
+  g_signal_connect(content_header, "notify::editing",
+                   G_CALLBACK(header_editing), NULL);
   gtk_widget_set_margin_start(content_box, 20);
 
   gtk_widget_set_halign(GTK_WIDGET(pages_list), GTK_ALIGN_END);
@@ -639,9 +1159,15 @@ activate(GtkApplication *app, gpointer user_data)
   gtk_box_append(GTK_BOX(content_header_box), remove_button);
 
   gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scroll), textarea);
+  find_bar = notes_find_bar_new(GTK_TEXT_VIEW(textarea));
+
   gtk_box_append(GTK_BOX(content_box), content_header_box);
+  gtk_box_append(GTK_BOX(content_box), GTK_WIDGET(find_bar));
   gtk_box_append(GTK_BOX(content_box), scroll);
 
+  backlinks = notes_backlinks_panel_new();
+  gtk_box_append(GTK_BOX(content_box), GTK_WIDGET(backlinks));
+
   gtk_text_view_set_left_margin(GTK_TEXT_VIEW(textarea), 20);
   gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW(textarea), GTK_WRAP_WORD);
 
@@ -651,6 +1177,13 @@ activate(GtkApplication *app, gpointer user_data)
   adw_header_bar_set_title_widget(ADW_HEADER_BAR(header), title);
   build_menu(header, app);
 
+  search_bar = notes_search_bar_new(search_index, trigram_index,
+                                    notes_tag_list_get_index(
+                                      NOTES_TAG_LIST(tags_list)));
+  adw_header_bar_pack_start(ADW_HEADER_BAR(header), GTK_WIDGET(search_bar));
+  g_signal_connect(search_bar, "open-result", G_CALLBACK(open_search_result),
+                   app);
+
   box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
 
   gtk_box_append(GTK_BOX(box), header);
@@ -662,8 +1195,16 @@ activate(GtkApplication *app, gpointer user_data)
   g_object_set_data(G_OBJECT(app), "tags_list", tags_list);
   g_object_set_data(G_OBJECT(app), "pages_list", pages_list);
   g_object_set_data(G_OBJECT(app), "remove_button", remove_button);
+  g_object_set_data(G_OBJECT(app), "backlinks_panel", backlinks);
+  g_object_set_data(G_OBJECT(app), "find_bar", find_bar);
+  g_object_set_data_full(G_OBJECT(app), "page_cache",
+                         page_cache_new(get_buffer_budget(),
+                                        UNDO_BUDGET_LEVELS),
+                         (GDestroyNotify) page_cache_free);
   g_object_set_data(G_OBJECT(textarea), "app", app);
 
+  install_css(G_OBJECT(app));
+
   // page = editor_page_new("Overview", g_hash_table_new(g_str_hash,
   // g_str_equal),
   //                      G_CALLBACK(page_created), app);
@@ -718,17 +1259,78 @@ open(GApplication *self,
   g_application_activate(self);
 }
 
+/* Options that run over the workspace and exit, no window is opened */
+static const GOptionEntry batch_entries[] = {
+  { "check", 0, 0, G_OPTION_ARG_NONE, NULL,
+    "Report files that can not be loaded and links to missing pages", NULL },
+  { "reformat", 0, 0, G_OPTION_ARG_NONE, NULL,
+    "Load every file and save it again in the editor's format", NULL },
+  { "stats", 0, 0, G_OPTION_ARG_NONE, NULL,
+    "Count the pages, links and tags", NULL },
+  { "workspace", 'w', 0, G_OPTION_ARG_FILENAME, NULL,
+    "Workspace for the options above, the last one opened by default",
+    "DIR" },
+  { NULL }
+};
+
+/* Runs before GTK is started, so the batch options work without a display */
+static gint
+handle_local_options(G_GNUC_UNUSED GApplication *app,
+                     GVariantDict *options,
+                     G_GNUC_UNUSED gpointer user_data)
+{
+  const gchar *root = NULL;
+  BatchMode mode = BATCH_CHECK;
+  guint n_modes = 0;
+
+  if (g_variant_dict_contains(options, "check")) {
+    mode = BATCH_CHECK;
+    n_modes++;
+  }
+  if (g_variant_dict_contains(options, "reformat")) {
+    mode = BATCH_REFORMAT;
+    n_modes++;
+  }
+  if (g_variant_dict_contains(options, "stats")) {
+    mode = BATCH_STATS;
+    n_modes++;
+  }
+
+  if (n_modes == 0) {
+    /* On to the editor */
+    return -1;
+  }
+  if (n_modes > 1) {
+    g_printerr("Only one of --check, --reformat and --stats at a time\n");
+    return 2;
+  }
+
+  if (!g_variant_dict_lookup(options, "workspace", "^&ay", &root)) {
+    root = get_current_ws();
+  }
+  if (root == NULL) {
+    g_printerr("No workspace, give one with --workspace\n");
+    return 2;
+  }
+
+  return batch_run(mode, root);
+}
+
 int
 main(int argc, char *argv[])
 {
   AdwApplication *app;
+  gint status;
 
   app = adw_application_new(APPLICATION_ID, G_APPLICATION_HANDLES_OPEN);
+  g_application_add_main_option_entries(G_APPLICATION(app), batch_entries);
+  g_signal_connect(app, "handle-local-options",
+                   G_CALLBACK(handle_local_options), NULL);
   g_signal_connect(app, "activate", G_CALLBACK(activate), NULL);
   g_signal_connect(app, "open", G_CALLBACK(open), NULL);
-  g_application_run(G_APPLICATION(app), argc, argv);
+  status = g_application_run(G_APPLICATION(app), argc, argv);
 
   g_object_unref(app);
 
-  return 0;
+  return status;
 }
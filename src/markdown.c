@@ -0,0 +1,312 @@
+#include <glib.h>
+
+#include "markdown.h"
+
+#define CODE_FENCE "````"
+#define REF_START  "({{< ref \""
+#define REF_MIDDLE "\" >}} \""
+#define REF_END    "\")"
+
+struct parse_ctx {
+  MarkdownDoc *doc;
+  /* Characters in doc->text so far */
+  gint chars;
+};
+
+static void
+clear_span(gpointer data)
+{
+  MarkdownSpan *span = (MarkdownSpan *) data;
+
+  g_free(span->target);
+}
+
+static void
+add_span(struct parse_ctx *ctx,
+         enum markdown_span_type type,
+         gint start,
+         gint end,
+         gchar *target)
+{
+  MarkdownSpan span = { 0 };
+
+  span.type = type;
+  span.start = start;
+  span.end = end;
+  span.target = target;
+
+  g_array_append_val(ctx->doc->spans, span);
+}
+
+static void
+append(struct parse_ctx *ctx, const gchar *text, gsize len)
+{
+  g_string_append_len(ctx->doc->text, text, len);
+  ctx->chars += g_utf8_strlen(text, len);
+}
+
+static gboolean
+valid_name(const gchar *name, gsize len)
+{
+  const gchar *iter = name;
+
+  if (len == 0) {
+    return FALSE;
+  }
+
+  while (iter < name + len) {
+    gunichar c = g_utf8_get_char(iter);
+
+    if (!g_unichar_isprint(c)) {
+      return FALSE;
+    }
+
+    if (g_unichar_isspace(c) && iter[0] != ' ') {
+      return FALSE;
+    }
+
+    iter = g_utf8_next_char(iter);
+  }
+
+  return TRUE;
+}
+
+/* [[Heading]] */
+static const gchar *
+parse_wiki_link(struct parse_ctx *ctx, const gchar *iter, const gchar *end)
+{
+  const gchar *name = iter + 2;
+  const gchar *stop;
+
+  stop = g_strstr_len(name, end - name, "]]");
+  if (stop == NULL || !valid_name(name, stop - name)) {
+    return NULL;
+  }
+
+  add_span(ctx, MARKDOWN_SPAN_LINK, ctx->chars, ctx->chars,
+           g_strndup(name, stop - name));
+
+  return stop + 2;
+}
+
+/* [Heading]({{< ref "file.md" >}} "Heading") */
+static const gchar *
+parse_ref_link(struct parse_ctx *ctx, const gchar *iter, const gchar *end)
+{
+  const gchar *name = iter + 1;
+  const gchar *stop;
+  const gchar *file;
+  const gchar *title;
+  const gchar *close;
+
+  stop = memchr(name, ']', end - name);
+  if (stop == NULL || stop == name) {
+    return NULL;
+  }
+
+  file = stop + 1;
+  if (end - file < (gssize) strlen(REF_START) ||
+      !g_str_has_prefix(file, REF_START)) {
+    return NULL;
+  }
+  file += strlen(REF_START);
+
+  title = g_strstr_len(file, end - file, REF_MIDDLE);
+  if (title == NULL) {
+    return NULL;
+  }
+  title += strlen(REF_MIDDLE);
+
+  close = g_strstr_len(title, end - title, REF_END);
+  if (close == NULL) {
+    return NULL;
+  }
+
+  add_span(ctx, MARKDOWN_SPAN_LINK, ctx->chars, ctx->chars,
+           g_strndup(name, stop - name));
+
+  return close + strlen(REF_END);
+}
+
+/* Bold and links inside a single line, without its newline */
+static void
+parse_inline(struct parse_ctx *ctx, const gchar *iter, const gchar *end)
+{
+  const gchar *plain = iter;
+
+  while (iter < end) {
+    const gchar *next = NULL;
+    const gchar *close = NULL;
+
+    if (end - iter >= 4 && strncmp(iter, "**", 2) == 0) {
+      close = g_strstr_len(iter + 2, end - iter - 2, "**");
+    }
+
+    if (close != NULL && close > iter + 2) {
+      gint start;
+
+      append(ctx, plain, iter - plain);
+      start = ctx->chars;
+      parse_inline(ctx, iter + 2, close);
+      add_span(ctx, MARKDOWN_SPAN_BOLD, start, ctx->chars, NULL);
+      iter = plain = close + 2;
+      continue;
+    }
+
+    if (iter[0] == '[') {
+      /* Links take no room in the text, flush what came before them */
+      append(ctx, plain, iter - plain);
+      plain = iter;
+
+      if (end - iter >= 2 && iter[1] == '[') {
+        next = parse_wiki_link(ctx, iter, end);
+      } else {
+        next = parse_ref_link(ctx, iter, end);
+      }
+
+      if (next != NULL) {
+        iter = plain = next;
+        continue;
+      }
+    }
+
+    iter = g_utf8_next_char(iter);
+  }
+
+  append(ctx, plain, end - plain);
+}
+
+MarkdownDoc *
+markdown_parse(const gchar *input, gssize len)
+{
+  struct parse_ctx ctx = { 0 };
+  const gchar *line;
+  const gchar *input_end;
+  gboolean code = FALSE;
+  gint code_start = 0;
+
+  g_return_val_if_fail(input != NULL, NULL);
+
+  if (len < 0) {
+    len = strlen(input);
+  }
+
+  ctx.doc = g_malloc0(sizeof(*ctx.doc));
+  ctx.doc->text = g_string_sized_new(len);
+  ctx.doc->spans = g_array_new(FALSE, TRUE, sizeof(MarkdownSpan));
+  g_array_set_clear_func(ctx.doc->spans, clear_span);
+
+  input_end = input + len;
+  line = input;
+
+  while (line < input_end) {
+    const gchar *line_end;
+    const gchar *next;
+    gsize line_len;
+    gint start;
+
+    line_end = memchr(line, '\n', input_end - line);
+    if (line_end == NULL) {
+      line_end = input_end;
+      next = input_end;
+    } else {
+      next = line_end + 1;
+    }
+    line_len = line_end - line;
+
+    if (line_len == strlen(CODE_FENCE) &&
+        strncmp(line, CODE_FENCE, line_len) == 0) {
+      if (code) {
+        add_span(&ctx, MARKDOWN_SPAN_CODE, code_start, ctx.chars, NULL);
+      } else {
+        code_start = ctx.chars;
+      }
+      code = !code;
+    } else if (code) {
+      append(&ctx, line, next - line);
+    } else if (g_str_has_prefix(line, "### ")) {
+      start = ctx.chars;
+      parse_inline(&ctx, line + 4, line_end);
+      add_span(&ctx, MARKDOWN_SPAN_H3, start, ctx.chars, NULL);
+      append(&ctx, line_end, next - line_end);
+    } else if (g_str_has_prefix(line, "## ")) {
+      start = ctx.chars;
+      parse_inline(&ctx, line + 3, line_end);
+      add_span(&ctx, MARKDOWN_SPAN_H2, start, ctx.chars, NULL);
+      append(&ctx, line_end, next - line_end);
+    } else if (g_str_has_prefix(line, "# ")) {
+      start = ctx.chars;
+      parse_inline(&ctx, line + 2, line_end);
+      add_span(&ctx, MARKDOWN_SPAN_H1, start, ctx.chars, NULL);
+      append(&ctx, line_end, next - line_end);
+    } else {
+      parse_inline(&ctx, line, line_end);
+      append(&ctx, line_end, next - line_end);
+    }
+
+    line = next;
+  }
+
+  if (code) {
+    add_span(&ctx, MARKDOWN_SPAN_CODE, code_start, ctx.chars, NULL);
+  }
+
+  return ctx.doc;
+}
+
+void
+markdown_doc_free(MarkdownDoc *doc)
+{
+  if (doc == NULL) {
+    return;
+  }
+
+  g_string_free(doc->text, TRUE);
+  g_array_unref(doc->spans);
+  g_free(doc);
+}
+
+const gchar *
+markdown_span_tag_name(enum markdown_span_type type)
+{
+  switch (type) {
+  case MARKDOWN_SPAN_BOLD:
+    return "bold";
+  case MARKDOWN_SPAN_CODE:
+    return "code";
+  case MARKDOWN_SPAN_H1:
+    return "h1";
+  case MARKDOWN_SPAN_H2:
+    return "h2";
+  case MARKDOWN_SPAN_H3:
+    return "h3";
+  case MARKDOWN_SPAN_LINK:
+  default:
+    return NULL;
+  }
+}
+
+/* The body of a note, after the YAML front matter between the --- lines */
+const gchar *
+markdown_skip_front_matter(const gchar *content)
+{
+  const gchar *end;
+
+  g_return_val_if_fail(content != NULL, NULL);
+
+  if (!g_str_has_prefix(content, "---")) {
+    return content;
+  }
+
+  end = strstr(content + 3, "\n---");
+  if (end == NULL) {
+    return content + strlen(content);
+  }
+
+  end += strlen("\n---");
+  if (end[0] == '\n') {
+    end++;
+  }
+
+  return end;
+}
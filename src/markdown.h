@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+enum markdown_span_type {
+  MARKDOWN_SPAN_BOLD = 0,
+  MARKDOWN_SPAN_CODE,
+  MARKDOWN_SPAN_H1,
+  MARKDOWN_SPAN_H2,
+  MARKDOWN_SPAN_H3,
+  MARKDOWN_SPAN_LINK
+};
+
+typedef struct {
+  enum markdown_span_type type;
+  /* Character offsets into the stripped text, links have start == end */
+  gint start;
+  gint end;
+  /* Heading of the linked page, only set for links */
+  gchar *target;
+} MarkdownSpan;
+
+/* Markdown with the markup stripped and recorded as spans, the same result
+ * as loading the text into a page and fixing up its content */
+typedef struct {
+  GString *text;
+  GArray *spans;
+} MarkdownDoc;
+
+MarkdownDoc *markdown_parse(const gchar *input, gssize len);
+
+void markdown_doc_free(MarkdownDoc *doc);
+
+const gchar *markdown_span_tag_name(enum markdown_span_type type);
+
+const gchar *markdown_skip_front_matter(const gchar *content);
+
+G_END_DECLS
@@ -3,24 +3,29 @@
 #include <glib.h>
 #include "notes_page_store.h"
 
+/* Height of the link picker before it scrolls */
+#define PICKER_MAX_HEIGHT 400
+
 struct _NotesPageList {
   GtkBox parent;
   NotesPageStore *pages;
   gchar *link_to;
   gchar *new_page;
   EditorPage *current;
+
+  /* Link picker, the pages in the store that match the search */
+  GtkWidget *popover;
+  GtkWidget *search;
+  GtkStringFilter *filter;
+  GtkFilterListModel *matches;
 };
 
 G_DEFINE_TYPE(NotesPageList, notes_page_list, GTK_TYPE_BOX)
 
 static void
-add_link(GtkDropDown *drop_down,
-         G_GNUC_UNUSED GParamSpec *spec,
-         NotesPageList *self)
+add_link(NotesPageList *self, EditorPage *selected)
 {
-  EditorPage *selected;
-
-  selected = gtk_drop_down_get_selected_item(drop_down);
+  gtk_popover_popdown(GTK_POPOVER(self->popover));
 
   if (notes_page_store_page_noop(selected)) {
     return;
@@ -28,7 +33,6 @@ add_link(GtkDropDown *drop_down,
 
   if (notes_page_store_page_new(selected)) {
     g_print("Creating new page");
-    gtk_drop_down_set_selected(drop_down, 0);
     editor_page_add_anchor(self->current, NULL);
 
     return;
@@ -37,8 +41,123 @@ add_link(GtkDropDown *drop_down,
   g_print("Selecting page %s.\n", selected->heading);
 
   editor_page_add_anchor(self->current, selected);
+  notes_page_store_linked(self->pages, selected);
+}
 
-  gtk_drop_down_set_selected(drop_down, 0);
+static void
+row_activated(G_GNUC_UNUSED GtkListView *view,
+              guint position,
+              NotesPageList *self)
+{
+  EditorPage *page = g_list_model_get_item(G_LIST_MODEL(self->matches),
+                                           position);
+
+  if (page != NULL) {
+    add_link(self, page);
+    g_object_unref(page);
+  }
+}
+
+/* Enter links the first page that matches, the actions are skipped */
+static void
+search_activated(G_GNUC_UNUSED GtkSearchEntry *entry, NotesPageList *self)
+{
+  GListModel *matches = G_LIST_MODEL(self->matches);
+
+  for (guint i = 0; i < g_list_model_get_n_items(matches); i++) {
+    EditorPage *page = g_list_model_get_item(matches, i);
+    gboolean action = notes_page_store_page_noop(page) ||
+                      notes_page_store_page_new(page);
+
+    if (!action) {
+      add_link(self, page);
+    }
+
+    g_object_unref(page);
+    if (!action) {
+      break;
+    }
+  }
+}
+
+static void
+search_changed(GtkSearchEntry *entry, NotesPageList *self)
+{
+  gtk_string_filter_set_search(self->filter,
+                               gtk_editable_get_text(GTK_EDITABLE(entry)));
+}
+
+static void
+picker_shown(G_GNUC_UNUSED GtkWidget *popover, NotesPageList *self)
+{
+  gtk_widget_grab_focus(self->search);
+}
+
+static void
+picker_closed(G_GNUC_UNUSED GtkPopover *popover, NotesPageList *self)
+{
+  gtk_editable_set_text(GTK_EDITABLE(self->search), "");
+}
+
+/* The actions are listed whatever the search */
+static gboolean
+is_action(gpointer item, G_GNUC_UNUSED gpointer user_data)
+{
+  EditorPage *page = EDITOR_PAGE(item);
+
+  return notes_page_store_page_noop(page) || notes_page_store_page_new(page);
+}
+
+static void
+setup_row(G_GNUC_UNUSED GtkSignalListItemFactory *factory,
+          GtkListItem *item,
+          G_GNUC_UNUSED gpointer user_data)
+{
+  GtkWidget *label = gtk_label_new(NULL);
+
+  gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+  gtk_label_set_ellipsize(GTK_LABEL(label), PANGO_ELLIPSIZE_END);
+  gtk_list_item_set_child(item, label);
+}
+
+static void
+row_heading_changed(EditorPage *page,
+                    G_GNUC_UNUSED GParamSpec *spec,
+                    GtkLabel *label)
+{
+  gtk_label_set_text(label, page->heading);
+}
+
+static void
+bind_row(G_GNUC_UNUSED GtkSignalListItemFactory *factory,
+         GtkListItem *item,
+         G_GNUC_UNUSED gpointer user_data)
+{
+  EditorPage *page = gtk_list_item_get_item(item);
+  GtkWidget *label = gtk_list_item_get_child(item);
+
+  gtk_label_set_text(GTK_LABEL(label), page->heading);
+  g_signal_connect_object(page, "notify::heading",
+                          G_CALLBACK(row_heading_changed), label, 0);
+}
+
+static void
+unbind_row(G_GNUC_UNUSED GtkSignalListItemFactory *factory,
+           GtkListItem *item,
+           G_GNUC_UNUSED gpointer user_data)
+{
+  g_signal_handlers_disconnect_by_func(gtk_list_item_get_item(item),
+                                       row_heading_changed,
+                                       gtk_list_item_get_child(item));
+}
+
+static void
+sort_toggled(GtkToggleButton *button, NotesPageList *self)
+{
+  notes_page_store_set_sort(self->pages,
+                            gtk_toggle_button_get_active(button) ?
+                              NOTES_PAGE_STORE_SORT_FRECENCY :
+                              NOTES_PAGE_STORE_SORT_HEADING);
 }
 
 static void
@@ -62,6 +181,8 @@ notes_page_list_finalize(GObject *obj)
 
   g_assert(self);
 
+  g_clear_object(&self->matches);
+  g_clear_object(&self->filter);
   g_clear_object(&self->pages);
 
   /* Always chain up to the parent finalize function to complete object
@@ -78,21 +199,99 @@ notes_page_list_class_init(NotesPageListClass *klass)
   object_class->finalize = notes_page_list_finalize;
 }
 
+/* A search entry over a list view of the matching pages. The list is
+ * filtered a chunk per frame and only the rows in view are made, so
+ * opening and typing do not depend on the number of pages. */
+static GtkWidget *
+create_picker(NotesPageList *self)
+{
+  GtkListItemFactory *factory;
+  GtkFilter *filter;
+  GtkWidget *scroll;
+  GtkWidget *view;
+  GtkWidget *box;
+
+  self->filter = gtk_string_filter_new(
+    gtk_property_expression_new(EDITOR_TYPE_PAGE, NULL, "heading"));
+  gtk_string_filter_set_match_mode(self->filter,
+                                   GTK_STRING_FILTER_MATCH_MODE_SUBSTRING);
+  gtk_string_filter_set_ignore_case(self->filter, TRUE);
+
+  filter = GTK_FILTER(gtk_any_filter_new());
+  gtk_multi_filter_append(GTK_MULTI_FILTER(filter),
+                          GTK_FILTER(gtk_custom_filter_new(is_action, NULL,
+                                                           NULL)));
+  gtk_multi_filter_append(GTK_MULTI_FILTER(filter),
+                          GTK_FILTER(g_object_ref(self->filter)));
+
+  self->matches = gtk_filter_list_model_new(
+    G_LIST_MODEL(g_object_ref(self->pages)), filter);
+  gtk_filter_list_model_set_incremental(self->matches, TRUE);
+
+  factory = gtk_signal_list_item_factory_new();
+  g_signal_connect(factory, "setup", G_CALLBACK(setup_row), NULL);
+  g_signal_connect(factory, "bind", G_CALLBACK(bind_row), NULL);
+  g_signal_connect(factory, "unbind", G_CALLBACK(unbind_row), NULL);
+
+  view = gtk_list_view_new(GTK_SELECTION_MODEL(gtk_no_selection_new(
+                             G_LIST_MODEL(g_object_ref(self->matches)))),
+                           factory);
+  gtk_list_view_set_single_click_activate(GTK_LIST_VIEW(view), TRUE);
+
+  scroll = gtk_scrolled_window_new();
+  gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scroll),
+                                 GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_max_content_height(GTK_SCROLLED_WINDOW(scroll),
+                                             PICKER_MAX_HEIGHT);
+  gtk_scrolled_window_set_propagate_natural_height(GTK_SCROLLED_WINDOW(scroll),
+                                                   TRUE);
+  gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scroll), view);
+
+  self->search = gtk_search_entry_new();
+
+  box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+  gtk_box_append(GTK_BOX(box), self->search);
+  gtk_box_append(GTK_BOX(box), scroll);
+
+  self->popover = gtk_popover_new();
+  gtk_widget_set_size_request(self->popover, 300, -1);
+  gtk_popover_set_child(GTK_POPOVER(self->popover), box);
+
+  g_signal_connect(view, "activate", G_CALLBACK(row_activated), self);
+  g_signal_connect(self->search, "search-changed", G_CALLBACK(search_changed),
+                   self);
+  g_signal_connect(self->search, "activate", G_CALLBACK(search_activated),
+                   self);
+  g_signal_connect(self->popover, "map", G_CALLBACK(picker_shown), self);
+  g_signal_connect(self->popover, "closed", G_CALLBACK(picker_closed), self);
+
+  return self->popover;
+}
+
 static void
 notes_page_list_init(NotesPageList *self)
 {
   g_assert(self);
-  GtkWidget *drop_down;
+  GtkWidget *link_button;
+  GtkWidget *recent;
 
   self->pages = notes_page_store_new();
-  drop_down = gtk_drop_down_new(G_LIST_MODEL(self->pages),
-                                gtk_property_expression_new(EDITOR_TYPE_PAGE,
-                                                            NULL, "heading"));
-
-  gtk_box_append(GTK_BOX(self), drop_down);
 
-  g_signal_connect(drop_down, "notify::selected-item", G_CALLBACK(add_link),
-                   self);
+  link_button = gtk_menu_button_new();
+  gtk_menu_button_set_icon_name(GTK_MENU_BUTTON(link_button),
+                                "insert-link-symbolic");
+  gtk_widget_set_tooltip_text(link_button, "Link to a page");
+  gtk_menu_button_set_popover(GTK_MENU_BUTTON(link_button),
+                              create_picker(self));
+  gtk_box_append(GTK_BOX(self), link_button);
+
+  recent = gtk_toggle_button_new();
+  gtk_button_set_icon_name(GTK_BUTTON(recent),
+                           "document-open-recent-symbolic");
+  gtk_widget_set_tooltip_text(recent, "Most used pages first");
+  gtk_box_append(GTK_BOX(self), recent);
+
+  g_signal_connect(recent, "toggled", G_CALLBACK(sort_toggled), self);
 }
 
 NotesPageList *
@@ -116,6 +315,22 @@ notes_page_list_add(NotesPageList *self, EditorPage *page)
   notes_page_store_add(self->pages, page);
 }
 
+void
+notes_page_list_begin_update(NotesPageList *self)
+{
+  g_return_if_fail(self != NULL);
+
+  notes_page_store_begin_update(self->pages);
+}
+
+void
+notes_page_list_end_update(NotesPageList *self)
+{
+  g_return_if_fail(self != NULL);
+
+  notes_page_store_end_update(self->pages);
+}
+
 void
 notes_page_list_remove(NotesPageList *self, EditorPage *page)
 {
@@ -138,4 +353,16 @@ notes_page_list_set_current(NotesPageList *self, EditorPage *page)
 {
   g_clear_object(&self->current);
   self->current = g_object_ref(page);
+
+  notes_page_store_opened(self->pages, page);
+}
+
+/* Ranks the pages by how they were used in the workspace at root */
+void
+notes_page_list_load_frecency(NotesPageList *self, const gchar *root)
+{
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(root != NULL);
+
+  notes_page_store_load_frecency(self->pages, root);
 }
@@ -20,10 +20,15 @@ EditorPage *notes_page_list_find(NotesPageList *self, const gchar *name);
 void notes_page_list_add(NotesPageList *self, EditorPage *page);
 void notes_page_list_remove(NotesPageList *self, EditorPage *page);
 
+void notes_page_list_begin_update(NotesPageList *self);
+void notes_page_list_end_update(NotesPageList *self);
+
 void notes_page_list_for_each(NotesPageList *self,
                               pages_for_each fn,
                               gpointer user_data);
 
 void
 notes_page_list_set_current(NotesPageList *self, EditorPage *page);
+
+void notes_page_list_load_frecency(NotesPageList *self, const gchar *root);
 G_END_DECLS
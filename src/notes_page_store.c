@@ -4,12 +4,34 @@
 #include <glib.h>
 
 #include "editor_page.h"
+#include "frecency.h"
+
+/* Quiet time after a page was opened or linked before the scores are saved */
+#define FRECENCY_SAVE_DELAY_S 5
+
+/* Sort ranks of the two actions listed before the pages */
+#define SORT_RANK_NOOP     20
+#define SORT_RANK_NEW_PAGE 10
 
 struct _NotesPageStore {
   GObject parent;
 
   GType item_type;
   GPtrArray *store;
+  NotesPageStoreSort sort;
+
+  /* Nesting of begin_update, pages added meanwhile wait in pending */
+  guint updating;
+  GPtrArray *pending;
+
+  /* Interned heading -> the first page added with it, hashed by pointer */
+  GHashTable *by_heading;
+  /* EditorPage -> a ref on the heading it is filed under in by_heading */
+  GHashTable *filed;
+
+  /* Where the frecency of the pages is kept, NULL until loaded */
+  gchar *frecency_path;
+  guint frecency_save_source;
 };
 
 static void list_model_interface_init(GListModelInterface *iface);
@@ -30,75 +52,165 @@ static GParamSpec *obj_properties[N_PROPERTIES] = {
 };
 
 static gint
-page_sort(gconstpointer a, gconstpointer b)
+page_sort(gconstpointer a, gconstpointer b, gpointer user_data)
 {
-  gint *sva;
-  gint *svb;
+  NotesPageStore *self = user_data;
+  gint res;
 
   const EditorPage *pa = *((EditorPage **) a);
   const EditorPage *pb = *((EditorPage **) b);
 
-  sva = g_object_get_data(G_OBJECT(pa), "sort-val");
-  svb = g_object_get_data(G_OBJECT(pb), "sort-val");
+  /* Actions first, regular pages all have rank 0 */
+  if (pa->sort_rank != pb->sort_rank) {
+    return pb->sort_rank - pa->sort_rank;
+  }
 
-  if (sva != NULL && svb == NULL) {
-    return -1;
+  if (self->sort == NOTES_PAGE_STORE_SORT_FRECENCY) {
+    res = frecency_cmp(&pa->frecency, &pb->frecency);
+    if (res != 0) {
+      return res;
+    }
   }
 
-  if (sva == NULL && svb != NULL) {
-    return 1;
+  return editor_page_cmp(pa, pb);
+}
+
+/* Sorts the store and tells views about the one range that differs from
+ * what they were shown before, old. The sort is stable, so pages whose
+ * place did not change are left alone at either end. */
+static void
+changed(NotesPageStore *self, GPtrArray *old)
+{
+  GPtrArray *store = self->store;
+  guint prefix = 0;
+  guint suffix = 0;
+
+  g_ptr_array_sort_with_data(store, page_sort, self);
+
+  while (prefix < old->len && prefix < store->len &&
+         old->pdata[prefix] == store->pdata[prefix]) {
+    prefix++;
+  }
+  while (suffix < old->len - prefix && suffix < store->len - prefix &&
+         old->pdata[old->len - suffix - 1] ==
+           store->pdata[store->len - suffix - 1]) {
+    suffix++;
+  }
+
+  if (old->len != store->len || prefix < old->len) {
+    g_list_model_items_changed(G_LIST_MODEL(self), prefix,
+                               old->len - prefix - suffix,
+                               store->len - prefix - suffix);
   }
 
-  if (sva != NULL && svb != NULL) {
-    return (*svb) - (*sva);
+  if (old->len != store->len) {
+    g_object_notify_by_pspec(G_OBJECT(self), obj_properties[PROP_N_ITEMS]);
   }
 
-  return g_strcmp0(pa->heading, pb->heading);
+  g_ptr_array_unref(old);
 }
 
-static gboolean
-page_heading_equal(gconstpointer a, gconstpointer b)
+/* First position whose page sorts after page */
+static guint
+insert_position(NotesPageStore *self, EditorPage *page)
+{
+  guint lo = 0;
+  guint hi = self->store->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (page_sort(&self->store->pdata[mid], &page, self) <= 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return lo;
+}
+
+/* The page at from has a new sort key, moves it to where it belongs now as
+ * one removal and one insertion. Nothing is emitted if it stays. */
+static void
+reposition(NotesPageStore *self, guint from)
 {
-  g_print("In exuals func (%p vs %s)\n", a, (gchar *) b);
-  /* a is tag object from array, b is gchar tag name */
+  EditorPage *page = g_ptr_array_steal_index(self->store, from);
+  guint to = insert_position(self, page);
 
-  EditorPage *p = EDITOR_PAGE((gpointer) a);
+  if (to == from) {
+    g_ptr_array_insert(self->store, to, page);
+    return;
+  }
 
-  g_print("1\n");
-  if (p == NULL) {
-    g_print("Looking for a NULL page...\n");
-    return FALSE;
+  g_list_model_items_changed(G_LIST_MODEL(self), from, 1, 0);
+  g_ptr_array_insert(self->store, to, page);
+  g_list_model_items_changed(G_LIST_MODEL(self), to, 0, 1);
+}
+
+static void
+file_page(NotesPageStore *self, EditorPage *page)
+{
+  gchar *heading;
+
+  if (page->heading == NULL) {
+    return;
   }
-  g_print("2\n");
-  const gchar *heading = (const gchar *) b;
 
-  g_print("Comparing %s with %s\n", heading, p->heading);
+  heading = g_ref_string_acquire(page->heading);
+  g_hash_table_insert(self->filed, page, heading);
 
-  return g_strcmp0(heading, p->heading) == 0;
+  /* Pages with the same heading, find gets the one that came first */
+  if (!g_hash_table_contains(self->by_heading, heading)) {
+    g_hash_table_insert(self->by_heading, heading, page);
+  }
 }
 
+/* Another page with the old heading takes its place, a rare case worth a
+ * scan */
 static void
-changed(NotesPageStore *self)
+unfile_page(NotesPageStore *self, EditorPage *page)
 {
-  g_ptr_array_sort(self->store, page_sort);
-  /* Notify changes */
-  g_list_model_items_changed(G_LIST_MODEL(self), 0, self->store->len - 1,
-                             self->store->len);
+  gchar *heading = g_hash_table_lookup(self->filed, page);
 
-  g_object_notify_by_pspec(G_OBJECT(self), obj_properties[PROP_N_ITEMS]);
+  if (heading == NULL) {
+    return;
+  }
+
+  if (g_hash_table_lookup(self->by_heading, heading) == page) {
+    g_hash_table_remove(self->by_heading, heading);
+
+    for (guint i = 0; i < self->store->len + self->pending->len; i++) {
+      EditorPage *other = i < self->store->len ?
+                            self->store->pdata[i] :
+                            self->pending->pdata[i - self->store->len];
+
+      if (other != page && g_hash_table_lookup(self->filed, other) == heading) {
+        g_hash_table_insert(self->by_heading, heading, other);
+        break;
+      }
+    }
+  }
+
+  g_hash_table_remove(self->filed, page);
 }
 
 static void
-changed_heading(G_GNUC_UNUSED EditorPage *page,
+changed_heading(EditorPage *page,
                 G_GNUC_UNUSED GParamSpec *spec,
                 NotesPageStore *self)
 {
+  guint from;
+
   g_assert(self);
 
-  g_ptr_array_sort(self->store, page_sort);
-  /* Notify changes */
-  g_list_model_items_changed(G_LIST_MODEL(self), 0, self->store->len,
-                             self->store->len);
+  unfile_page(self, page);
+  file_page(self, page);
+
+  /* The row shows the new heading by itself, only its place can change */
+  if (g_ptr_array_find(self->store, page, &from)) {
+    reposition(self, from);
+  }
 }
 
 static GType
@@ -170,6 +282,44 @@ set_property(GObject *object,
   }
 }
 
+static gboolean
+is_sentinel(EditorPage *page)
+{
+  return page->sort_rank != 0;
+}
+
+static gboolean
+save_frecency(gpointer user_data)
+{
+  NotesPageStore *self = NOTES_PAGE_STORE(user_data);
+  GError *lerr = NULL;
+  GHashTable *records;
+
+  self->frecency_save_source = 0;
+
+  if (self->frecency_path == NULL) {
+    return G_SOURCE_REMOVE;
+  }
+
+  /* heading -> Frecency of the page, nothing copied */
+  records = g_hash_table_new(g_str_hash, g_str_equal);
+  for (guint i = 0; i < self->store->len; i++) {
+    EditorPage *page = self->store->pdata[i];
+
+    if (!is_sentinel(page)) {
+      g_hash_table_insert(records, page->heading, &page->frecency);
+    }
+  }
+
+  if (!frecency_write(self->frecency_path, records, &lerr)) {
+    g_warning("Could not save page frecency: %s", lerr->message);
+    g_clear_error(&lerr);
+  }
+
+  g_hash_table_unref(records);
+  return G_SOURCE_REMOVE;
+}
+
 static void
 notes_page_store_dispose(GObject *obj)
 {
@@ -181,6 +331,12 @@ notes_page_store_dispose(GObject *obj)
    * and dispose might be called several times on the same object
    */
 
+  /* Scores not written yet */
+  if (self->frecency_save_source != 0) {
+    g_source_remove(self->frecency_save_source);
+    save_frecency(self);
+  }
+
   /* Always chain up to the parent dispose function to complete object
    * destruction. */
   G_OBJECT_CLASS(notes_page_store_parent_class)->dispose(obj);
@@ -194,6 +350,10 @@ notes_page_store_finalize(GObject *obj)
   g_assert(self);
 
   /* free stuff */
+  g_free(self->frecency_path);
+  g_clear_pointer(&self->pending, g_ptr_array_unref);
+  g_clear_pointer(&self->by_heading, g_hash_table_unref);
+  g_clear_pointer(&self->filed, g_hash_table_unref);
 
   /* Always chain up to the parent finalize function to complete object
    * destruction. */
@@ -228,28 +388,31 @@ notes_page_store_init(G_GNUC_UNUSED NotesPageStore *self)
 {
   /* initialize all public and private members to reasonable default values.
    * They are all automatically initialized to 0 to begin with. */
+  GPtrArray *old;
   EditorPage *p;
-  gint *sv;
 
   self->store = g_ptr_array_new();
+  self->pending = g_ptr_array_new();
+  self->by_heading = g_hash_table_new(g_direct_hash, g_direct_equal);
+  self->filed = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                      (GDestroyNotify) g_ref_string_release);
+  old = g_ptr_array_new();
   g_print("PAges len: %u\n", self->store->len);
 
   p = editor_page_new("< Link to >", NULL, NULL, NULL, NULL, NULL);
-  sv = g_malloc0(sizeof(*sv));
-  *sv = 20;
-  g_object_set_data_full(G_OBJECT(p), "sort-val", sv, g_free);
+  p->sort_rank = SORT_RANK_NOOP;
   g_ptr_array_add(self->store, p);
+  file_page(self, p);
 
   g_print("PAges len: %u\n", self->store->len);
 
   p = editor_page_new("< New Page >", NULL, NULL, NULL, NULL, NULL);
-  sv = g_malloc0(sizeof(*sv));
-  *sv = 10;
-  g_object_set_data_full(G_OBJECT(p), "sort-val", sv, g_free);
+  p->sort_rank = SORT_RANK_NEW_PAGE;
   g_ptr_array_add(self->store, p);
+  file_page(self, p);
 
   g_print("PAges len: %u\n", self->store->len);
-  changed(self);
+  changed(self, old);
 }
 
 static void
@@ -268,40 +431,43 @@ notes_page_store_new(void)
                       NULL);
 }
 
+/* Inserted where the page sorts, after pages with an equal key, so loading
+ * n pages takes O(n log n) comparisons */
 void
 notes_page_store_add(NotesPageStore *self, EditorPage *page)
 {
+  guint position;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+
   g_print("Adding page to store %s\n", page->heading);
-  g_ptr_array_add(self->store, g_object_ref(page));
   g_signal_connect(page, "notify::heading", G_CALLBACK(changed_heading), self);
-  changed(self);
+  file_page(self, page);
+
+  if (self->updating > 0) {
+    /* Sorted in with the others when the update ends */
+    g_ptr_array_add(self->pending, g_object_ref(page));
+    return;
+  }
+
+  position = insert_position(self, page);
+  g_ptr_array_insert(self->store, position, g_object_ref(page));
+
+  g_list_model_items_changed(G_LIST_MODEL(self), position, 0, 1);
+  g_object_notify_by_pspec(G_OBJECT(self), obj_properties[PROP_N_ITEMS]);
 }
 
 gboolean
 notes_page_store_page_noop(EditorPage *page)
 {
-  gint *val;
-
-  val = (gint *) g_object_get_data(G_OBJECT(page), "sort-val");
-
-  if (val == NULL) {
-    return FALSE;
-  }
-
-  return *val == 20;
+  return page->sort_rank == SORT_RANK_NOOP;
 }
 
 gboolean
 notes_page_store_page_new(EditorPage *page)
 {
-  gint *val;
-  val = (gint *) g_object_get_data(G_OBJECT(page), "sort-val");
-
-  if (val == NULL) {
-    return FALSE;
-  }
-
-  return *val == 10;
+  return page->sort_rank == SORT_RANK_NEW_PAGE;
 }
 
 void
@@ -314,24 +480,188 @@ notes_page_store_foreach(NotesPageStore *self, GFunc fn, gpointer user_data)
   g_print("For-eaching pages\n");
 
   g_ptr_array_foreach(self->store, fn, user_data);
+  g_ptr_array_foreach(self->pending, fn, user_data);
 }
 
 EditorPage *
 notes_page_store_find(NotesPageStore *self, const gchar *heading)
 {
-  guint index = 0;
+  EditorPage *res;
+  gchar *key;
   g_return_val_if_fail(self != NULL, NULL);
   g_return_val_if_fail(heading != NULL, NULL);
 
   g_print("Finding page with name %s (%u)\n", heading, self->store->len);
 
-  if (!g_ptr_array_find_with_equal_func(self->store, heading,
-                                        page_heading_equal, &index)) {
-    g_print("Returning Not found\n");
-    return NULL;
+  /* The page has the same string, the table is keyed by its pointer */
+  key = g_ref_string_new_intern(heading);
+  res = g_hash_table_lookup(self->by_heading, key);
+  g_ref_string_release(key);
+
+  return res;
+}
+
+/* Where the page is in the sorted store. Pages are found by their sort key,
+ * so this has to be called before the key changes. */
+static gboolean
+find_sorted(NotesPageStore *self, EditorPage *page, guint *index)
+{
+  guint lo = 0;
+  guint hi = self->store->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (page_sort(&self->store->pdata[mid], &page, self) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  /* Equal keys, like two pages with the same heading */
+  for (guint i = lo; i < self->store->len &&
+                     page_sort(&self->store->pdata[i], &page, self) == 0;
+       i++) {
+    if (self->store->pdata[i] == page) {
+      *index = i;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+static void
+visited(NotesPageStore *self, EditorPage *page, gboolean linked)
+{
+  gint64 now = g_get_real_time();
+  guint from;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+
+  if (is_sentinel(page)) {
+    return;
+  }
+
+  if (self->sort != NOTES_PAGE_STORE_SORT_FRECENCY ||
+      !find_sorted(self, page, &from)) {
+    from = G_MAXUINT;
+  }
+
+  if (linked) {
+    frecency_linked(&page->frecency, now);
+  } else {
+    frecency_opened(&page->frecency, now);
+  }
+
+  /* Only this page changed its score, everything else stays in order */
+  if (from != G_MAXUINT) {
+    reposition(self, from);
+  }
+
+  if (self->frecency_path != NULL && self->frecency_save_source == 0) {
+    self->frecency_save_source =
+      g_timeout_add_seconds(FRECENCY_SAVE_DELAY_S, save_frecency, self);
+  }
+}
+
+void
+notes_page_store_opened(NotesPageStore *self, EditorPage *page)
+{
+  visited(self, page, FALSE);
+}
+
+void
+notes_page_store_linked(NotesPageStore *self, EditorPage *page)
+{
+  visited(self, page, TRUE);
+}
+
+void
+notes_page_store_set_sort(NotesPageStore *self, NotesPageStoreSort sort)
+{
+  g_return_if_fail(self != NULL);
+
+  if (self->sort == sort) {
+    return;
+  }
+
+  self->sort = sort;
+  changed(self, g_ptr_array_copy(self->store, NULL, NULL));
+}
+
+NotesPageStoreSort
+notes_page_store_get_sort(NotesPageStore *self)
+{
+  g_return_val_if_fail(self != NULL, NOTES_PAGE_STORE_SORT_HEADING);
+
+  return self->sort;
+}
+
+/* Picks up the scores saved in the workspace at root for the pages in the
+ * store, and saves them there from now on */
+void
+notes_page_store_load_frecency(NotesPageStore *self, const gchar *root)
+{
+  GError *lerr = NULL;
+  GHashTable *records;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(root != NULL);
+
+  g_free(self->frecency_path);
+  self->frecency_path = g_build_filename(root, FRECENCY_FILE, NULL);
+
+  records = frecency_read(self->frecency_path, &lerr);
+  if (records == NULL) {
+    g_debug("No page frecency: %s", lerr->message);
+    g_clear_error(&lerr);
+    return;
+  }
+
+  for (guint i = 0; i < self->store->len; i++) {
+    EditorPage *page = self->store->pdata[i];
+    Frecency *record = g_hash_table_lookup(records, page->heading);
+
+    if (record != NULL && !is_sentinel(page)) {
+      page->frecency = *record;
+    }
+  }
+
+  g_hash_table_unref(records);
+
+  if (self->sort == NOTES_PAGE_STORE_SORT_FRECENCY) {
+    changed(self, g_ptr_array_copy(self->store, NULL, NULL));
   }
+}
 
-  g_print("Returning found index %u / %u\n", index, self->store->len);
+/* Pages added until the matching end_update are held back and the store
+ * does not change as seen by its views. Calls can be nested. */
+void
+notes_page_store_begin_update(NotesPageStore *self)
+{
+  g_return_if_fail(self != NULL);
 
-  return self->store->pdata[index];
-}
\ No newline at end of file
+  self->updating++;
+}
+
+/* Sorts the held back pages in with one sort and one items-changed */
+void
+notes_page_store_end_update(NotesPageStore *self)
+{
+  GPtrArray *old;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(self->updating > 0);
+
+  if (--self->updating > 0 || self->pending->len == 0) {
+    return;
+  }
+
+  old = g_ptr_array_copy(self->store, NULL, NULL);
+  g_ptr_array_extend_and_steal(self->store, self->pending);
+  self->pending = g_ptr_array_new();
+  changed(self, old);
+}
@@ -11,6 +11,12 @@ G_BEGIN_DECLS
  * Type declaration.
  */
 
+typedef enum {
+  NOTES_PAGE_STORE_SORT_HEADING = 0,
+  /* Most often and most recently opened or linked first */
+  NOTES_PAGE_STORE_SORT_FRECENCY,
+} NotesPageStoreSort;
+
 #define NOTES_TYPE_PAGE_STORE notes_page_store_get_type()
 G_DECLARE_FINAL_TYPE(NotesPageStore, notes_page_store, NOTES, PAGE_STORE, GObject)
 
@@ -31,4 +37,18 @@ notes_page_store_foreach(NotesPageStore *self, GFunc fn, gpointer user_data);
 EditorPage *
 notes_page_store_find(NotesPageStore *self, const gchar *heading);
 
+void notes_page_store_opened(NotesPageStore *self, EditorPage *page);
+
+void notes_page_store_linked(NotesPageStore *self, EditorPage *page);
+
+void notes_page_store_set_sort(NotesPageStore *self, NotesPageStoreSort sort);
+
+NotesPageStoreSort notes_page_store_get_sort(NotesPageStore *self);
+
+void notes_page_store_load_frecency(NotesPageStore *self, const gchar *root);
+
+void notes_page_store_begin_update(NotesPageStore *self);
+
+void notes_page_store_end_update(NotesPageStore *self);
+
 G_END_DECLS
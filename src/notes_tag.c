@@ -1,19 +1,29 @@
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
-#include <gtk/gtk.h>
 
 #include "editor_page.h"
 #include "notes_tag.h"
+#include "utils.h"
 
 struct _NotesTag {
-  GtkWidget parent;
+  GObject parent;
   gchar *name;
+  /* utils_sort_key of the name */
+  gchar *sort_key;
+  /* Sorted with editor_page_cmp */
   GPtrArray *pages;
-  GtkWidget *exp;
-  GtkWidget *box;
+  /* Nesting of begin_update, pages added meanwhile wait in pending */
+  guint updating;
+  GHashTable *pending;
 };
 
-G_DEFINE_TYPE(NotesTag, notes_tag, GTK_TYPE_BOX)
+static void list_model_interface_init(GListModelInterface *iface);
+G_DEFINE_TYPE_WITH_CODE(NotesTag,
+                        notes_tag,
+                        G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(G_TYPE_LIST_MODEL,
+                                              list_model_interface_init))
 
 static void
 notes_tag_dispose(GObject *obj)
@@ -38,9 +48,9 @@ notes_tag_finalize(GObject *obj)
 
   g_assert(self);
   g_clear_pointer(&self->pages, g_ptr_array_unref);
-  g_clear_object(&self->exp);
-  g_clear_object(&self->box);
-  g_free(self->name);
+  g_clear_pointer(&self->pending, g_hash_table_unref);
+  g_clear_pointer(&self->name, g_ref_string_release);
+  g_free(self->sort_key);
 
   /* free stuff */
 
@@ -64,18 +74,50 @@ notes_tag_init(NotesTag *self)
   /* initialize all public and private members to reasonable default values.
    * They are all automatically initialized to 0 to begin with. */
   self->pages = g_ptr_array_new_with_free_func(g_object_unref);
+  self->pending = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                        g_object_unref, NULL);
+}
+
+static GType
+get_item_type(G_GNUC_UNUSED GListModel *list)
+{
+  return EDITOR_TYPE_PAGE;
+}
+
+static guint
+get_n_items(GListModel *list)
+{
+  NotesTag *self = NOTES_TAG(list);
+
+  return self->pages->len;
+}
+
+static gpointer
+get_item(GListModel *list, guint position)
+{
+  NotesTag *self = NOTES_TAG(list);
+
+  if (position >= self->pages->len) {
+    return NULL;
+  }
+
+  return g_object_ref(self->pages->pdata[position]);
+}
+
+static void
+list_model_interface_init(GListModelInterface *iface)
+{
+  iface->get_item_type = get_item_type;
+  iface->get_n_items = get_n_items;
+  iface->get_item = get_item;
 }
 
 NotesTag *
 notes_tag_new(const gchar *name)
 {
-  NotesTag *n = g_object_new(NOTES_TYPE_TAG, "orientation",
-                             GTK_ORIENTATION_VERTICAL, "spacing", 0, NULL);
-  n->name = g_strdup(name);
-  n->exp = gtk_expander_new(n->name);
-  n->box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
-  gtk_expander_set_child(GTK_EXPANDER(n->exp), n->box);
-  gtk_box_append(GTK_BOX(n), n->exp);
+  NotesTag *n = g_object_new(NOTES_TYPE_TAG, NULL);
+  n->name = g_ref_string_new_intern(name);
+  n->sort_key = utils_sort_key(name);
 
   return n;
 }
@@ -88,58 +130,174 @@ notes_tag_name(NotesTag *self)
   return self->name;
 }
 
+const gchar *
+notes_tag_sort_key(NotesTag *self)
+{
+  g_return_val_if_fail(self != NULL, NULL);
+
+  return self->sort_key;
+}
+
 static gint
 page_sort(gconstpointer a, gconstpointer b)
 {
   const EditorPage *pa = *((EditorPage **) a);
   const EditorPage *pb = *((EditorPage **) b);
 
-  return g_strcmp0(pa->heading, pb->heading);
+  return editor_page_cmp(pa, pb);
+}
+
+/* Where page goes in the sorted pages, after those with the same heading.
+ * FALSE if it is there already, index is then where it is. */
+static gboolean
+insert_position(NotesTag *self, EditorPage *page, guint *index)
+{
+  guint lo = 0;
+  guint hi = self->pages->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (page_sort(&self->pages->pdata[mid], &page) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  /* Equal headings, the page could be any of them */
+  for (; lo < self->pages->len &&
+         page_sort(&self->pages->pdata[lo], &page) == 0;
+       lo++) {
+    if (self->pages->pdata[lo] == page) {
+      *index = lo;
+      return FALSE;
+    }
+  }
+
+  *index = lo;
+  return TRUE;
 }
 
+/* The page has a new heading, moves it to where it sorts now as one removal
+ * and one insertion. Nothing is emitted if it stays. */
+static void
+changed_heading(EditorPage *page,
+                G_GNUC_UNUSED GParamSpec *spec,
+                NotesTag *self)
+{
+  guint from;
+  guint to;
+
+  /* Its old key is gone, so it is not where a search would look */
+  if (!g_ptr_array_find(self->pages, page, &from)) {
+    return;
+  }
+
+  page = g_ptr_array_steal_index(self->pages, from);
+  insert_position(self, page, &to);
+
+  if (to == from) {
+    g_ptr_array_insert(self->pages, to, page);
+    return;
+  }
+
+  g_list_model_items_changed(G_LIST_MODEL(self), from, 1, 0);
+  g_ptr_array_insert(self->pages, to, page);
+  g_list_model_items_changed(G_LIST_MODEL(self), to, 0, 1);
+}
+
+/* Pages in the sorted array follow their heading until removed */
+static void
+insert_page(NotesTag *self, guint index, EditorPage *page)
+{
+  g_ptr_array_insert(self->pages, index, page);
+  g_signal_connect_object(page, "notify::heading",
+                          G_CALLBACK(changed_heading), self, 0);
+}
+
+/* Rows for the page are made by the views of the tag, and only while the
+ * tag is expanded and the rows are scrolled into view */
 void
 notes_tag_add_page(NotesTag *self, EditorPage *page)
 {
   guint index;
-  GtkWidget *page_button;
   g_return_if_fail(self != NULL);
 
   g_return_if_fail(page != NULL);
 
-  if (g_ptr_array_find(self->pages, page, NULL)) {
+  if (!insert_position(self, page, &index)) {
     g_print("Page already in array\n");
     return;
   }
 
-  g_ptr_array_add(self->pages, g_object_ref(page));
-  g_ptr_array_sort(self->pages, page_sort);
-  g_ptr_array_find(self->pages, page, &index);
+  if (self->updating > 0) {
+    /* Sorted in with the others when the update ends */
+    if (!g_hash_table_contains(self->pending, page)) {
+      g_hash_table_add(self->pending, g_object_ref(page));
+    }
+    return;
+  }
+
+  insert_page(self, index, g_object_ref(page));
+  g_list_model_items_changed(G_LIST_MODEL(self), index, 0, 1);
+}
 
-  page_button = editor_page_in_list_button(page);
+/* TRUE if the tag has no pages left */
+gboolean
+notes_tag_remove_page(NotesTag *self, EditorPage *page)
+{
+  guint index;
 
-  if (index == 0) {
-    g_print("Adding page to tag, by prepend\n");
-    gtk_box_prepend(GTK_BOX(self->box), page_button);
-  } else {
-    g_print("Adding page to tag\n");
-    GtkWidget *after_button = NULL;
-    EditorPage *after_page;
+  g_return_val_if_fail(self != NULL, FALSE);
+  g_return_val_if_fail(page != NULL, FALSE);
 
-    after_page = EDITOR_PAGE(g_ptr_array_index(self->pages, index - 1));
+  g_hash_table_remove(self->pending, page);
 
-    for (guint i = 0; i < after_page->buttons->len; i++) {
-      if (gtk_widget_get_parent(GTK_WIDGET(after_page->buttons->pdata[i])) ==
-          self->box) {
-        after_button = GTK_WIDGET(after_page->buttons->pdata[i]);
-      }
-    }
+  if (insert_position(self, page, &index)) {
+    return self->pages->len == 0 && g_hash_table_size(self->pending) == 0;
+  }
 
-    if (after_button == NULL) {
-      g_warning("Could not find parent of previous button!");
-      return;
-    }
+  g_signal_handlers_disconnect_by_func(page, changed_heading, self);
+  g_ptr_array_remove_index(self->pages, index);
+  g_list_model_items_changed(G_LIST_MODEL(self), index, 1, 0);
 
-    gtk_box_insert_child_after(GTK_BOX(self->box), page_button,
-                               GTK_WIDGET(after_button));
+  return self->pages->len == 0 && g_hash_table_size(self->pending) == 0;
+}
+
+/* Pages added until the matching end_update are held back, calls can be
+ * nested */
+void
+notes_tag_begin_update(NotesTag *self)
+{
+  g_return_if_fail(self != NULL);
+
+  self->updating++;
+}
+
+/* Sorts the held back pages in with one sort and one items-changed */
+void
+notes_tag_end_update(NotesTag *self)
+{
+  GHashTableIter iter;
+  EditorPage *page;
+  guint old_len;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(self->updating > 0);
+
+  if (--self->updating > 0 || g_hash_table_size(self->pending) == 0) {
+    return;
+  }
+
+  old_len = self->pages->len;
+
+  g_hash_table_iter_init(&iter, self->pending);
+  while (g_hash_table_iter_next(&iter, (gpointer *) &page, NULL)) {
+    insert_page(self, self->pages->len, page);
+    g_hash_table_iter_steal(&iter);
   }
-}
\ No newline at end of file
+
+  g_ptr_array_sort(self->pages, page_sort);
+  g_list_model_items_changed(G_LIST_MODEL(self), 0, old_len, self->pages->len);
+}
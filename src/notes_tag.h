@@ -11,7 +11,7 @@ G_BEGIN_DECLS
  */
 
 #define NOTES_TYPE_TAG notes_tag_get_type()
-G_DECLARE_FINAL_TYPE(NotesTag, notes_tag, NOTES, TAG, GtkBox)
+G_DECLARE_FINAL_TYPE(NotesTag, notes_tag, NOTES, TAG, GObject)
 
 /*
  * Method definitions.
@@ -20,6 +20,14 @@ NotesTag *notes_tag_new(const gchar *name);
 
 const gchar *notes_tag_name(NotesTag *t);
 
+const gchar *notes_tag_sort_key(NotesTag *t);
+
 void notes_tag_add_page(NotesTag *self, EditorPage *page);
 
+gboolean notes_tag_remove_page(NotesTag *self, EditorPage *page);
+
+void notes_tag_begin_update(NotesTag *self);
+
+void notes_tag_end_update(NotesTag *self);
+
 G_END_DECLS
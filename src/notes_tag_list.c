@@ -5,10 +5,27 @@
 #include "editor_page.h"
 #include "notes_tag.h"
 #include "notes_tag_list.h"
+#include "tag_index.h"
+
+/* Matching pages shown at most, the count says if there are more */
+#define MAX_FILTER_RESULTS 500
 
 struct _NotesTagList {
   GtkWidget parent;
+  /* NotesTag sorted by name, the same as in tag_model */
   GPtrArray *tags;
+  GListStore *tag_model;
+  /* Interned tag name -> NotesTag */
+  GHashTable *by_name;
+  TagIndex *index;
+  GtkWidget *filter;
+  GtkWidget *status;
+  GtkWidget *results;
+  GtkWidget *results_scroll;
+  /* Tags and, below the expanded ones, their pages */
+  GtkWidget *groups;
+  /* Nesting of begin_update, new tags are only listed at the end */
+  guint updating;
 };
 
 G_DEFINE_TYPE(NotesTagList, notes_tag_list, GTK_TYPE_BOX)
@@ -37,6 +54,9 @@ notes_tag_list_finalize(GObject *obj)
   g_assert(self);
 
   g_clear_pointer(&self->tags, g_ptr_array_unref);
+  g_clear_object(&self->tag_model);
+  g_clear_pointer(&self->by_name, g_hash_table_unref);
+  g_clear_pointer(&self->index, tag_index_free);
 
   /* free stuff */
 
@@ -54,12 +74,238 @@ notes_tag_list_class_init(NotesTagListClass *klass)
   object_class->finalize = notes_tag_list_finalize;
 }
 
+static gint
+heading_sort(gconstpointer a, gconstpointer b)
+{
+  EditorPage *pa = *((EditorPage **) a);
+  EditorPage *pb = *((EditorPage **) b);
+
+  return editor_page_cmp(pa, pb);
+}
+
+static void
+result_clicked(G_GNUC_UNUSED GtkButton *button, EditorPage *page)
+{
+  editor_page_switch_to(page);
+}
+
+static void
+clear_results(NotesTagList *self)
+{
+  GtkWidget *child;
+
+  while ((child = gtk_widget_get_first_child(self->results)) != NULL) {
+    gtk_box_remove(GTK_BOX(self->results), child);
+  }
+}
+
+static void
+filter_changed(GtkSearchEntry *entry, NotesTagList *self)
+{
+  GError *lerr = NULL;
+  const gchar *expr;
+  GPtrArray *pages;
+  gchar *status;
+
+  expr = gtk_editable_get_text(GTK_EDITABLE(entry));
+
+  clear_results(self);
+
+  if (expr == NULL || expr[0] == '\0') {
+    gtk_widget_set_visible(self->status, FALSE);
+    gtk_widget_set_visible(self->results_scroll, FALSE);
+    gtk_widget_set_visible(self->groups, TRUE);
+    return;
+  }
+
+  gtk_widget_set_visible(self->status, TRUE);
+  gtk_widget_set_visible(self->results_scroll, TRUE);
+  gtk_widget_set_visible(self->groups, FALSE);
+
+  pages = tag_index_filter(self->index, expr, &lerr);
+  if (pages == NULL) {
+    gtk_label_set_text(GTK_LABEL(self->status), lerr->message);
+    g_clear_error(&lerr);
+    return;
+  }
+
+  status = g_strdup_printf("%u pages", pages->len);
+  gtk_label_set_text(GTK_LABEL(self->status), status);
+  g_free(status);
+
+  g_ptr_array_sort(pages, heading_sort);
+
+  for (guint i = 0; i < pages->len && i < MAX_FILTER_RESULTS; i++) {
+    EditorPage *page = pages->pdata[i];
+    GtkWidget *button = gtk_button_new_with_label(page->heading);
+
+    gtk_button_set_has_frame(GTK_BUTTON(button), FALSE);
+    gtk_label_set_xalign(GTK_LABEL(gtk_button_get_child(GTK_BUTTON(button))),
+                         0.0);
+    g_signal_connect(button, "clicked", G_CALLBACK(result_clicked), page);
+    gtk_box_append(GTK_BOX(self->results), button);
+  }
+
+  g_ptr_array_unref(pages);
+}
+
+/* Pages of a tag as the children of its row, pages have none */
+static GListModel *
+create_child_model(gpointer item, G_GNUC_UNUSED gpointer user_data)
+{
+  if (!NOTES_IS_TAG(item)) {
+    return NULL;
+  }
+
+  return G_LIST_MODEL(g_object_ref(item));
+}
+
+static void
+setup_row(G_GNUC_UNUSED GtkSignalListItemFactory *factory,
+          GtkListItem *item,
+          G_GNUC_UNUSED gpointer user_data)
+{
+  GtkWidget *expander = gtk_tree_expander_new();
+  GtkWidget *label = gtk_label_new(NULL);
+
+  gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+  gtk_label_set_ellipsize(GTK_LABEL(label), PANGO_ELLIPSIZE_END);
+  gtk_tree_expander_set_child(GTK_TREE_EXPANDER(expander), label);
+  gtk_list_item_set_child(item, expander);
+}
+
+static void
+row_heading_changed(EditorPage *page,
+                    G_GNUC_UNUSED GParamSpec *spec,
+                    GtkLabel *label)
+{
+  gtk_label_set_text(label, page->heading);
+}
+
+/* Rows are recycled, so a row only ever shows what it is bound to */
+static void
+bind_row(G_GNUC_UNUSED GtkSignalListItemFactory *factory,
+         GtkListItem *item,
+         G_GNUC_UNUSED gpointer user_data)
+{
+  GtkTreeListRow *row = gtk_list_item_get_item(item);
+  GtkWidget *expander = gtk_list_item_get_child(item);
+  GtkWidget *label = gtk_tree_expander_get_child(GTK_TREE_EXPANDER(expander));
+  gpointer obj = gtk_tree_list_row_get_item(row);
+
+  gtk_tree_expander_set_list_row(GTK_TREE_EXPANDER(expander), row);
+
+  if (NOTES_IS_TAG(obj)) {
+    gtk_label_set_text(GTK_LABEL(label), notes_tag_name(obj));
+    gtk_widget_add_css_class(label, "heading");
+  } else {
+    EditorPage *page = EDITOR_PAGE(obj);
+
+    gtk_label_set_text(GTK_LABEL(label), page->heading);
+    gtk_widget_remove_css_class(label, "heading");
+    g_signal_connect_object(page, "notify::heading",
+                            G_CALLBACK(row_heading_changed), label, 0);
+  }
+
+  g_object_unref(obj);
+}
+
+static void
+unbind_row(G_GNUC_UNUSED GtkSignalListItemFactory *factory,
+           GtkListItem *item,
+           G_GNUC_UNUSED gpointer user_data)
+{
+  GtkTreeListRow *row = gtk_list_item_get_item(item);
+  GtkWidget *expander = gtk_list_item_get_child(item);
+  GtkWidget *label = gtk_tree_expander_get_child(GTK_TREE_EXPANDER(expander));
+  gpointer obj = gtk_tree_list_row_get_item(row);
+
+  if (EDITOR_IS_PAGE(obj)) {
+    g_signal_handlers_disconnect_by_func(obj, row_heading_changed, label);
+  }
+
+  gtk_tree_expander_set_list_row(GTK_TREE_EXPANDER(expander), NULL);
+  g_object_unref(obj);
+}
+
+/* A tag opens or closes, a page is switched to */
+static void
+row_activated(GtkListView *view,
+              guint position,
+              G_GNUC_UNUSED gpointer user_data)
+{
+  GListModel *model = G_LIST_MODEL(gtk_list_view_get_model(view));
+  GtkTreeListRow *row = g_list_model_get_item(model, position);
+  gpointer obj = gtk_tree_list_row_get_item(row);
+
+  if (NOTES_IS_TAG(obj)) {
+    gtk_tree_list_row_set_expanded(row, !gtk_tree_list_row_get_expanded(row));
+  } else {
+    editor_page_switch_to(EDITOR_PAGE(obj));
+  }
+
+  g_object_unref(obj);
+  g_object_unref(row);
+}
+
 static void
 notes_tag_list_init(NotesTagList *self)
 {
+  GtkTreeListModel *tree;
+  GtkListItemFactory *factory;
+  GtkWidget *view;
+
   /* initialize all public and private members to reasonable default values.
    * They are all automatically initialized to 0 to begin with. */
   self->tags = g_ptr_array_new_with_free_func(g_object_unref);
+  self->tag_model = g_list_store_new(NOTES_TYPE_TAG);
+  self->by_name = g_hash_table_new(g_direct_hash, g_direct_equal);
+  self->index = tag_index_new();
+
+  self->filter = gtk_search_entry_new();
+  gtk_widget_set_tooltip_text(self->filter,
+                              "Tags to show, like: work and not done, "
+                              "(a or b) -\"Not tagged\"");
+  gtk_box_append(GTK_BOX(self), self->filter);
+
+  self->status = gtk_label_new("");
+  gtk_label_set_xalign(GTK_LABEL(self->status), 0.0);
+  gtk_label_set_wrap(GTK_LABEL(self->status), TRUE);
+  gtk_widget_add_css_class(self->status, "dim-label");
+  gtk_widget_set_visible(self->status, FALSE);
+  gtk_box_append(GTK_BOX(self), self->status);
+
+  self->results = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+  self->results_scroll = gtk_scrolled_window_new();
+  gtk_widget_set_vexpand(self->results_scroll, TRUE);
+  gtk_widget_set_visible(self->results_scroll, FALSE);
+  gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(self->results_scroll),
+                                self->results);
+  gtk_box_append(GTK_BOX(self), self->results_scroll);
+
+  /* Only the rows in view exist, in their own scrolled window so the view
+   * knows which those are */
+  tree = gtk_tree_list_model_new(G_LIST_MODEL(g_object_ref(self->tag_model)),
+                                 FALSE, FALSE, create_child_model, NULL, NULL);
+
+  factory = gtk_signal_list_item_factory_new();
+  g_signal_connect(factory, "setup", G_CALLBACK(setup_row), NULL);
+  g_signal_connect(factory, "bind", G_CALLBACK(bind_row), NULL);
+  g_signal_connect(factory, "unbind", G_CALLBACK(unbind_row), NULL);
+
+  view = gtk_list_view_new(GTK_SELECTION_MODEL(gtk_no_selection_new(
+                             G_LIST_MODEL(tree))),
+                           factory);
+  gtk_list_view_set_single_click_activate(GTK_LIST_VIEW(view), TRUE);
+  g_signal_connect(view, "activate", G_CALLBACK(row_activated), NULL);
+
+  self->groups = gtk_scrolled_window_new();
+  gtk_widget_set_vexpand(self->groups, TRUE);
+  gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(self->groups), view);
+  gtk_box_append(GTK_BOX(self), self->groups);
+
+  g_signal_connect(self->filter, "search-changed", G_CALLBACK(filter_changed),
+                   self);
 }
 
 GtkWidget *
@@ -69,75 +315,235 @@ notes_tag_list_new(void)
                       GTK_ORIENTATION_VERTICAL, "spacing", 5, NULL);
 }
 
-static gboolean
-tag_equal(gconstpointer a, gconstpointer b)
+/* Tags by their sort keys, names that only differ in case or accents by
+ * their bytes */
+static gint
+tag_cmp(NotesTag *a, NotesTag *b)
+{
+  gint res = g_strcmp0(notes_tag_sort_key(a), notes_tag_sort_key(b));
+
+  if (res != 0) {
+    return res;
+  }
+
+  return g_strcmp0(notes_tag_name(a), notes_tag_name(b));
+}
+
+/* Where t goes in the sorted tags, or where it is */
+static guint
+insert_position(NotesTagList *self, NotesTag *t)
 {
-  /* a is tag object from array, b is gchar tag name */
-  NotesTag *t = NOTES_TAG((gpointer) a);
-  const gchar *name = (const gchar *) b;
+  guint lo = 0;
+  guint hi = self->tags->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
 
-  return g_strcmp0(name, notes_tag_name(t)) == 0;
+    if (tag_cmp(self->tags->pdata[mid], t) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return lo;
 }
 
-static gint
-tag_sort(gconstpointer a, gconstpointer b)
+/* The tag called name, made if there is none. name is interned. */
+static NotesTag *
+get_tag(NotesTagList *self, const gchar *name)
 {
-  NotesTag *ta = *((NotesTag **) a);
-  NotesTag *tb = *((NotesTag **) b);
+  NotesTag *t;
+  guint index;
 
-  return g_strcmp0(notes_tag_name(ta), notes_tag_name(tb));
+  /* Page tags and tag names are interned, found by pointer */
+  t = g_hash_table_lookup(self->by_name, name);
+  if (t != NULL) {
+    return t;
+  }
+
+  t = notes_tag_new(name);
+  index = insert_position(self, t);
+  g_ptr_array_insert(self->tags, index, t);
+  g_hash_table_insert(self->by_name, (gpointer) notes_tag_name(t), t);
+  if (self->updating > 0) {
+    notes_tag_begin_update(t);
+  } else {
+    g_list_store_insert(self->tag_model, index, t);
+  }
+
+  return t;
+}
+
+/* A tag without pages goes away */
+static void
+drop_tag(NotesTagList *self, NotesTag *t)
+{
+  guint position;
+
+  g_hash_table_remove(self->by_name, notes_tag_name(t));
+
+  if (g_list_store_find(self->tag_model, t, &position)) {
+    g_list_store_remove(self->tag_model, position);
+  }
+
+  g_ptr_array_remove_index(self->tags, insert_position(self, t));
+}
+
+static void
+refresh_filter(NotesTagList *self)
+{
+  if (self->updating == 0 && gtk_widget_get_visible(self->status)) {
+    filter_changed(GTK_SEARCH_ENTRY(self->filter), self);
+  }
 }
 
 void
 notes_tag_list_add(NotesTagList *self, EditorPage *page)
 {
-  NotesTag *t = NULL;
   g_return_if_fail(self != NULL);
   g_return_if_fail(page != NULL);
 
   for (guint i = 0; i < page->tags->len; i++) {
-    guint index;
     const gchar *tag_name = (const gchar *) page->tags->pdata[i];
-    if (g_ptr_array_find_with_equal_func(self->tags, tag_name, tag_equal,
-                                         &index)) {
-      /* Tag already exists */
-      g_print("Tag exists: %s\n", tag_name);
-      t = NOTES_TAG(g_ptr_array_index(self->tags, index));
-    } else {
-      t = notes_tag_new(tag_name);
-      g_ptr_array_add(self->tags, t);
-      g_ptr_array_sort(self->tags, tag_sort);
-      g_ptr_array_find(self->tags, t, &index);
-      if (index == 0) {
-        gtk_box_prepend(GTK_BOX(self), GTK_WIDGET(t));
-      } else {
-        g_print("Tag inserted after: %s\n", tag_name);
-        NotesTag *after = NOTES_TAG(g_ptr_array_index(self->tags, index - 1));
-        gtk_box_insert_child_after(GTK_BOX(self), GTK_WIDGET(t),
-                                   GTK_WIDGET(after));
-      }
-    }
+
     g_print("Adding page %s to tag %s\n", page->heading, tag_name);
-    notes_tag_add_page(t, page);
+    notes_tag_add_page(get_tag(self, tag_name), page);
   }
+
+  /* Also picks up tags removed from the page since the last time */
+  tag_index_set_page_tags(self->index, page, page->tags);
+  tag_index_set_page_draft(self->index, page, editor_page_is_draft(page));
+
+  refresh_filter(self);
 }
 
-gchar **
-notes_tag_list_get_tags_not_on_page(NotesTagList *self, EditorPage *page)
+/* Tags the page with name, only that tag is updated. FALSE if the page
+ * had it already. */
+gboolean
+notes_tag_list_add_tag(NotesTagList *self, EditorPage *page, const gchar *name)
 {
-  GStrvBuilder *res;
+  gchar *tag;
+
+  g_return_val_if_fail(self != NULL, FALSE);
+  g_return_val_if_fail(page != NULL, FALSE);
+  g_return_val_if_fail(name != NULL, FALSE);
+
+  tag = g_ref_string_new_intern(name);
+  if (g_ptr_array_find(page->tags, tag, NULL)) {
+    g_ref_string_release(tag);
+    return FALSE;
+  }
 
-  res = g_strv_builder_new();
+  /* The page keeps the reference */
+  g_ptr_array_add(page->tags, tag);
+  notes_tag_add_page(get_tag(self, tag), page);
+  tag_index_set_page_tag(self->index, page, tag, TRUE);
+
+  if (g_strcmp0(tag, EDITOR_PAGE_NOT_TAGGED) != 0) {
+    notes_tag_list_remove_tag(self, page, EDITOR_PAGE_NOT_TAGGED);
+  }
+
+  refresh_filter(self);
+  return TRUE;
+}
+
+/* Takes the tag name off the page, and out of the list if no other page
+ * has it. A page without tags is not tagged. FALSE if the page did not
+ * have it. */
+gboolean
+notes_tag_list_remove_tag(NotesTagList *self,
+                          EditorPage *page,
+                          const gchar *name)
+{
+  NotesTag *t;
+  gchar *tag;
+  guint index;
+
+  g_return_val_if_fail(self != NULL, FALSE);
+  g_return_val_if_fail(page != NULL, FALSE);
+  g_return_val_if_fail(name != NULL, FALSE);
+
+  tag = g_ref_string_new_intern(name);
+  if (!g_ptr_array_find(page->tags, tag, &index)) {
+    g_ref_string_release(tag);
+    return FALSE;
+  }
+
+  g_ptr_array_remove_index(page->tags, index);
+  tag_index_set_page_tag(self->index, page, tag, FALSE);
+
+  t = g_hash_table_lookup(self->by_name, tag);
+  if (t != NULL && notes_tag_remove_page(t, page)) {
+    drop_tag(self, t);
+  }
+
+  if (page->tags->len == 0) {
+    notes_tag_list_add_tag(self, page, EDITOR_PAGE_NOT_TAGGED);
+  }
+
+  g_ref_string_release(tag);
+  refresh_filter(self);
+  return TRUE;
+}
+
+/* The NotesTag of the list, sorted by name */
+GListModel *
+notes_tag_list_get_model(NotesTagList *self)
+{
+  g_return_val_if_fail(self != NULL, NULL);
+
+  return G_LIST_MODEL(self->tag_model);
+}
+
+/* Pages added until the matching end_update are only shown when it ends,
+ * calls can be nested */
+void
+notes_tag_list_begin_update(NotesTagList *self)
+{
+  g_return_if_fail(self != NULL);
+
+  if (self->updating++ > 0) {
+    return;
+  }
 
   for (guint i = 0; i < self->tags->len; i++) {
-    if (!g_ptr_array_find_with_equal_func(page->tags,notes_tag_name(self->tags->pdata[i]),
-                                          g_str_equal, NULL)) {
-      g_strv_builder_add(res, notes_tag_name(self->tags->pdata[i]));
-      g_print("Adding %s to list\n", notes_tag_name(self->tags->pdata[i]));
-    } else {
-      g_print("Already had %s\n", notes_tag_name(self->tags->pdata[i]));
-    }
+    notes_tag_begin_update(self->tags->pdata[i]);
+  }
+}
+
+/* Each tag takes its new pages in one change, and the tags are listed
+ * again with one change of the tag model */
+void
+notes_tag_list_end_update(NotesTagList *self)
+{
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(self->updating > 0);
+
+  if (--self->updating > 0) {
+    return;
   }
 
-  return g_strv_builder_end(res);
-}
\ No newline at end of file
+  for (guint i = 0; i < self->tags->len; i++) {
+    notes_tag_end_update(self->tags->pdata[i]);
+  }
+
+  if (g_list_model_get_n_items(G_LIST_MODEL(self->tag_model)) !=
+      self->tags->len) {
+    g_list_store_splice(self->tag_model, 0,
+                        g_list_model_get_n_items(
+                          G_LIST_MODEL(self->tag_model)),
+                        self->tags->pdata, self->tags->len);
+  }
+
+  refresh_filter(self);
+}
+
+/* Tags and draft state of every page added to the list */
+TagIndex *
+notes_tag_list_get_index(NotesTagList *self)
+{
+  g_return_val_if_fail(self != NULL, NULL);
+
+  return self->index;
+}
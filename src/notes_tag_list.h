@@ -3,6 +3,7 @@
 #include <glib-object.h>
 #include <gtk/gtk.h>
 #include "editor_page.h"
+#include "tag_index.h"
 
 G_BEGIN_DECLS
 
@@ -20,7 +21,20 @@ GtkWidget *notes_tag_list_new(void);
 
 void notes_tag_list_add(NotesTagList *self, EditorPage *page);
 
-gchar **notes_tag_list_get_tags_not_on_page(NotesTagList *self,
-                                            EditorPage *page);
+void notes_tag_list_begin_update(NotesTagList *self);
+
+void notes_tag_list_end_update(NotesTagList *self);
+
+TagIndex *notes_tag_list_get_index(NotesTagList *self);
+
+gboolean notes_tag_list_add_tag(NotesTagList *self,
+                                EditorPage *page,
+                                const gchar *name);
+
+gboolean notes_tag_list_remove_tag(NotesTagList *self,
+                                   EditorPage *page,
+                                   const gchar *name);
+
+GListModel *notes_tag_list_get_model(NotesTagList *self);
 
 G_END_DECLS
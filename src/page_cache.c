@@ -0,0 +1,228 @@
+#include <glib.h>
+
+#include "editor_page.h"
+#include "page_cache.h"
+
+/* Keeps track of the order pages were viewed in. The least recently viewed
+ * pages are evicted first once the resident buffers exceed the budget, and
+ * lose their undo history first once the undo budget is used up. */
+struct _PageCache {
+  gsize budget;
+  guint undo_levels;
+
+  /* Most recently viewed page first */
+  GQueue lru;
+  /* EditorPage -> CacheEntry */
+  GHashTable *entries;
+  /* Sum of the sizes in the entries */
+  gsize resident;
+};
+
+typedef struct {
+  GList *link;
+  /* Resident size of the page when it was last looked at */
+  gsize size;
+} CacheEntry;
+
+PageCache *
+page_cache_new(gsize budget, guint undo_levels)
+{
+  PageCache *self = g_malloc0(sizeof(*self));
+
+  self->budget = budget;
+  self->undo_levels = undo_levels;
+  g_queue_init(&self->lru);
+  self->entries = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                        g_free);
+
+  return self;
+}
+
+void
+page_cache_free(PageCache *self)
+{
+  if (self == NULL) {
+    return;
+  }
+
+  g_queue_clear_full(&self->lru, g_object_unref);
+  g_hash_table_unref(self->entries);
+  g_free(self);
+}
+
+/* Brings the total up to date with the size of one page */
+static void
+account(PageCache *self, EditorPage *page)
+{
+  CacheEntry *entry = g_hash_table_lookup(self->entries, page);
+
+  if (entry == NULL) {
+    return;
+  }
+
+  self->resident -= entry->size;
+  entry->size = editor_page_resident_size(page);
+  self->resident += entry->size;
+}
+
+void
+page_cache_add(PageCache *self, EditorPage *page)
+{
+  CacheEntry *entry;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+
+  if (g_hash_table_contains(self->entries, page)) {
+    return;
+  }
+
+  /* Not viewed yet, so first in line for eviction and nothing to undo */
+  g_queue_push_tail(&self->lru, g_object_ref(page));
+  entry = g_malloc0(sizeof(*entry));
+  entry->link = g_queue_peek_tail_link(&self->lru);
+  g_hash_table_insert(self->entries, page, entry);
+  account(self, page);
+
+  /* No limit is what 0 undo levels means, so undo is turned off instead */
+  if (editor_page_is_resident(page)) {
+    gtk_text_buffer_set_enable_undo(page->content, FALSE);
+  }
+}
+
+/* Hand out the undo budget in viewing order. Only the viewed page can be
+ * edited, so everything past the first page with undo turned off has it
+ * turned off as well. */
+static void
+share_undo_levels(PageCache *self)
+{
+  guint left = self->undo_levels;
+
+  for (GList *iter = self->lru.head; iter != NULL; iter = iter->next) {
+    EditorPage *page = EDITOR_PAGE(iter->data);
+    guint levels;
+
+    if (!editor_page_is_resident(page)) {
+      continue;
+    }
+
+    levels = MIN(left, EDITOR_PAGE_MAX_UNDO_LEVELS);
+    if (levels == 0) {
+      if (!gtk_text_buffer_get_enable_undo(page->content)) {
+        break;
+      }
+      /* Drops the history */
+      gtk_text_buffer_set_enable_undo(page->content, FALSE);
+      continue;
+    }
+
+    /* Lowering the limit drops the oldest steps */
+    gtk_text_buffer_set_enable_undo(page->content, TRUE);
+    gtk_text_buffer_set_max_undo_levels(page->content, levels);
+    left -= levels;
+  }
+}
+
+/* The text of a page changed without the cache being involved, like when
+ * it is loaded or edited */
+void
+page_cache_resize(PageCache *self, EditorPage *page)
+{
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+
+  account(self, page);
+}
+
+void
+page_cache_touch(PageCache *self, EditorPage *page)
+{
+  CacheEntry *entry;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+
+  entry = g_hash_table_lookup(self->entries, page);
+
+  if (entry == NULL) {
+    page_cache_add(self, page);
+    entry = g_hash_table_lookup(self->entries, page);
+  }
+
+  g_queue_unlink(&self->lru, entry->link);
+  g_queue_push_head_link(&self->lru, entry->link);
+
+  editor_page_restore(page);
+  account(self, page);
+
+  share_undo_levels(self);
+  page_cache_trim(self);
+}
+
+void
+page_cache_trim(PageCache *self)
+{
+  GList *iter;
+
+  g_return_if_fail(self != NULL);
+
+  if (self->resident <= self->budget) {
+    return;
+  }
+
+  /* Never evict the head, it is the page being shown */
+  iter = g_queue_peek_tail_link(&self->lru);
+  while (iter != NULL && iter != self->lru.head &&
+         self->resident > self->budget) {
+    EditorPage *page = EDITOR_PAGE(iter->data);
+    CacheEntry *entry = g_hash_table_lookup(self->entries, page);
+
+    if (entry->size > 0 && editor_page_evict(page)) {
+      g_debug("Evicted %s (%" G_GSIZE_FORMAT " bytes)", page->heading,
+              entry->size);
+      account(self, page);
+    }
+
+    iter = iter->prev;
+  }
+}
+
+gsize
+page_cache_resident_bytes(PageCache *self)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  return self->resident;
+}
+
+gsize
+page_cache_budget(PageCache *self)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  return self->budget;
+}
+
+guint
+page_cache_resident_pages(PageCache *self)
+{
+  guint res = 0;
+
+  g_return_val_if_fail(self != NULL, 0);
+
+  for (GList *iter = self->lru.head; iter != NULL; iter = iter->next) {
+    if (editor_page_is_resident(EDITOR_PAGE(iter->data))) {
+      res++;
+    }
+  }
+
+  return res;
+}
+
+guint
+page_cache_n_pages(PageCache *self)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  return self->lru.length;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glib.h>
+
+#include "editor_page.h"
+
+G_BEGIN_DECLS
+
+typedef struct _PageCache PageCache;
+
+PageCache *page_cache_new(gsize budget, guint undo_levels);
+
+void page_cache_free(PageCache *self);
+
+void page_cache_add(PageCache *self, EditorPage *page);
+
+void page_cache_resize(PageCache *self, EditorPage *page);
+
+void page_cache_touch(PageCache *self, EditorPage *page);
+
+void page_cache_trim(PageCache *self);
+
+gsize page_cache_resident_bytes(PageCache *self);
+
+gsize page_cache_budget(PageCache *self);
+
+guint page_cache_resident_pages(PageCache *self);
+
+guint page_cache_n_pages(PageCache *self);
+
+G_END_DECLS
@@ -0,0 +1,384 @@
+#include <gio/gio.h>
+#include <glib.h>
+#include <string.h>
+
+#include "editor_page.h"
+#include "page_query.h"
+#include "search_index.h"
+#include "tag_index.h"
+
+/*
+ * Queries like: tag:meeting draft:true text:'budget plan' -tag:done
+ *
+ *   query     := predicate*
+ *   predicate := "-"? (key ":")? value
+ *   key       := "tag" | "draft" | "text"
+ *   value     := word | '...' | "..."
+ *
+ * A value without a key is text, and every word of a text is a predicate of
+ * its own. All predicates have to hold. Each one is answered from an index:
+ * tags and drafts from the bitsets of the TagIndex, text from the postings
+ * of the SearchIndex. They are ordered by the number of pages they let
+ * through, the pages of the first are listed and the others are only
+ * checked against those, so the cost follows the most selective predicate
+ * and not the size of the workspace.
+ */
+
+typedef enum {
+  PREDICATE_TAG,
+  PREDICATE_DRAFT,
+  PREDICATE_TEXT,
+} PredicateKind;
+
+typedef struct {
+  PredicateKind kind;
+  gboolean negate;
+  /* Tag name or one term of a text, unused for drafts */
+  gchar *value;
+  /* Pages the predicate lets through */
+  guint n_pages;
+} Predicate;
+
+static const struct {
+  const gchar *key;
+  PredicateKind kind;
+} keys[] = {
+  { "tag:", PREDICATE_TAG },
+  { "draft:", PREDICATE_DRAFT },
+  { "text:", PREDICATE_TEXT },
+};
+
+G_DEFINE_QUARK(page-query-error-quark, page_query_error)
+
+static void
+predicate_clear(Predicate *pred)
+{
+  g_free(pred->value);
+}
+
+/* Length of the key at pos, 0 when there is none */
+static gsize
+match_key(const gchar *pos, PredicateKind *kind)
+{
+  for (guint i = 0; i < G_N_ELEMENTS(keys); i++) {
+    gsize len = strlen(keys[i].key);
+
+    if (g_ascii_strncasecmp(pos, keys[i].key, len) == 0) {
+      *kind = keys[i].kind;
+      return len;
+    }
+  }
+
+  return 0;
+}
+
+/* TRUE when the query uses a key, plain words are left to the search bar */
+gboolean
+page_query_is_structured(const gchar *query)
+{
+  PredicateKind kind;
+  const gchar *pos = query;
+
+  g_return_val_if_fail(query != NULL, FALSE);
+
+  while (*pos != '\0') {
+    while (g_ascii_isspace(*pos)) {
+      pos++;
+    }
+    if (*pos == '-') {
+      pos++;
+    }
+    if (match_key(pos, &kind) > 0) {
+      return TRUE;
+    }
+    while (*pos != '\0' && !g_ascii_isspace(*pos)) {
+      pos++;
+    }
+  }
+
+  return FALSE;
+}
+
+static gchar *
+parse_value(const gchar **pos, GError **error)
+{
+  const gchar *start = *pos;
+  const gchar *end;
+
+  if (*start == '\'' || *start == '"') {
+    end = strchr(start + 1, *start);
+    if (end == NULL) {
+      g_set_error(error, PAGE_QUERY_ERROR, PAGE_QUERY_ERROR_SYNTAX,
+                  "Missing closing quote");
+      return NULL;
+    }
+    *pos = end + 1;
+    return g_strndup(start + 1, end - start - 1);
+  }
+
+  end = start;
+  while (*end != '\0' && !g_ascii_isspace(*end)) {
+    end++;
+  }
+  *pos = end;
+
+  return g_strndup(start, end - start);
+}
+
+static gboolean
+add_predicate(GArray *preds,
+              PredicateKind kind,
+              gboolean negate,
+              gchar *value,
+              GError **error)
+{
+  Predicate pred = { kind, negate, NULL, 0 };
+  gchar **terms;
+
+  switch (kind) {
+  case PREDICATE_TAG:
+    if (value[0] == '\0') {
+      g_set_error(error, PAGE_QUERY_ERROR, PAGE_QUERY_ERROR_SYNTAX,
+                  "Expected a tag after \"tag:\"");
+      return FALSE;
+    }
+    pred.value = g_strdup(value);
+    g_array_append_val(preds, pred);
+    break;
+  case PREDICATE_DRAFT:
+    /* draft:false is not draft:true */
+    if (g_ascii_strcasecmp(value, "false") == 0 ||
+        g_ascii_strcasecmp(value, "no") == 0) {
+      pred.negate = !negate;
+    } else if (g_ascii_strcasecmp(value, "true") != 0 &&
+               g_ascii_strcasecmp(value, "yes") != 0) {
+      g_set_error(error, PAGE_QUERY_ERROR, PAGE_QUERY_ERROR_SYNTAX,
+                  "Expected true or false after \"draft:\"");
+      return FALSE;
+    }
+    g_array_append_val(preds, pred);
+    break;
+  case PREDICATE_TEXT:
+    /* Indexed as words, -text:'a b' has neither a nor b */
+    terms = search_tokenize(value);
+    for (guint i = 0; terms[i] != NULL; i++) {
+      pred.value = g_strdup(terms[i]);
+      g_array_append_val(preds, pred);
+    }
+    g_strfreev(terms);
+    break;
+  }
+
+  return TRUE;
+}
+
+static GArray *
+parse(const gchar *query, GError **error)
+{
+  GArray *preds = g_array_new(FALSE, FALSE, sizeof(Predicate));
+  const gchar *pos = query;
+
+  g_array_set_clear_func(preds, (GDestroyNotify) predicate_clear);
+
+  for (;;) {
+    PredicateKind kind = PREDICATE_TEXT;
+    gboolean negate = FALSE;
+    gboolean ok;
+    gchar *value;
+
+    while (g_ascii_isspace(*pos)) {
+      pos++;
+    }
+    if (*pos == '\0') {
+      break;
+    }
+
+    if (*pos == '-') {
+      negate = TRUE;
+      pos++;
+    }
+    pos += match_key(pos, &kind);
+
+    value = parse_value(&pos, error);
+    if (value == NULL) {
+      g_array_unref(preds);
+      return NULL;
+    }
+
+    ok = add_predicate(preds, kind, negate, value, error);
+    g_free(value);
+
+    if (!ok) {
+      g_array_unref(preds);
+      return NULL;
+    }
+  }
+
+  return preds;
+}
+
+static guint
+count_pages(Predicate *pred, TagIndex *tags, SearchIndex *words)
+{
+  switch (pred->kind) {
+  case PREDICATE_TAG:
+    return tag_index_count(tags, pred->value);
+  case PREDICATE_DRAFT:
+    return tag_index_n_drafts(tags);
+  case PREDICATE_TEXT:
+    return search_index_term_pages(words, pred->value);
+  }
+
+  g_assert_not_reached();
+}
+
+static gint
+selectivity_cmp(gconstpointer a, gconstpointer b)
+{
+  const Predicate *pa = a;
+  const Predicate *pb = b;
+
+  return (pa->n_pages > pb->n_pages) - (pa->n_pages < pb->n_pages);
+}
+
+static gboolean
+holds(Predicate *pred, EditorPage *page, TagIndex *tags, SearchIndex *words)
+{
+  gboolean res = FALSE;
+
+  switch (pred->kind) {
+  case PREDICATE_TAG:
+    res = tag_index_has_tag(tags, page, pred->value);
+    break;
+  case PREDICATE_DRAFT:
+    res = tag_index_is_draft(tags, page);
+    break;
+  case PREDICATE_TEXT:
+    res = search_index_term_hits(words, page, pred->value) > 0;
+    break;
+  }
+
+  return res != pred->negate;
+}
+
+/* Pages of a predicate that is not negated */
+static GPtrArray *
+list_pages(Predicate *pred, TagIndex *tags, SearchIndex *words)
+{
+  GPtrArray *res;
+  GArray *found;
+
+  switch (pred->kind) {
+  case PREDICATE_TAG:
+    return tag_index_tagged(tags, pred->value);
+  case PREDICATE_DRAFT:
+    return tag_index_drafts(tags);
+  case PREDICATE_TEXT:
+    found = search_index_query(words, pred->value);
+    res = g_ptr_array_sized_new(found->len);
+    for (guint i = 0; i < found->len; i++) {
+      g_ptr_array_add(res, g_array_index(found, SearchResult, i).page);
+    }
+    g_array_unref(found);
+    return res;
+  }
+
+  g_assert_not_reached();
+}
+
+/* Pages matching the query as a list of EditorPage, most text hits first and
+ * then by heading. NULL with error set if the query does not parse. */
+GListModel *
+page_query_run(const gchar *query,
+               TagIndex *tags,
+               SearchIndex *words,
+               GError **error)
+{
+  GListStore *res;
+  GPtrArray *candidates;
+  GArray *matches;
+  GArray *preds;
+  Predicate *driver = NULL;
+  gpointer *items;
+  guint n_all;
+
+  g_return_val_if_fail(query != NULL, NULL);
+  g_return_val_if_fail(tags != NULL, NULL);
+  g_return_val_if_fail(words != NULL, NULL);
+
+  preds = parse(query, error);
+  if (preds == NULL) {
+    return NULL;
+  }
+
+  res = g_list_store_new(EDITOR_TYPE_PAGE);
+  if (preds->len == 0) {
+    goto out;
+  }
+
+  n_all = tag_index_n_pages(tags);
+
+  for (guint i = 0; i < preds->len; i++) {
+    Predicate *pred = &g_array_index(preds, Predicate, i);
+
+    pred->n_pages = count_pages(pred, tags, words);
+    if (pred->negate) {
+      pred->n_pages = n_all - MIN(pred->n_pages, n_all);
+    }
+    if (pred->n_pages == 0) {
+      /* Nothing gets past this one */
+      goto out;
+    }
+  }
+
+  /* Most selective first, so checks fail as early as they can */
+  g_array_sort(preds, selectivity_cmp);
+
+  for (guint i = 0; i < preds->len && driver == NULL; i++) {
+    if (!g_array_index(preds, Predicate, i).negate) {
+      driver = &g_array_index(preds, Predicate, i);
+    }
+  }
+
+  /* Only negations, all pages it is */
+  candidates = driver != NULL ? list_pages(driver, tags, words) :
+                                tag_index_pages(tags);
+  matches = g_array_new(FALSE, FALSE, sizeof(SearchResult));
+
+  for (guint c = 0; c < candidates->len; c++) {
+    SearchResult match = { candidates->pdata[c], 0 };
+    guint i;
+
+    for (i = 0; i < preds->len; i++) {
+      Predicate *pred = &g_array_index(preds, Predicate, i);
+
+      if (pred != driver && !holds(pred, match.page, tags, words)) {
+        break;
+      }
+      if (pred->kind == PREDICATE_TEXT && !pred->negate) {
+        match.hits += search_index_term_hits(words, match.page, pred->value);
+      }
+    }
+
+    if (i == preds->len) {
+      g_array_append_val(matches, match);
+    }
+  }
+
+  search_results_sort(matches);
+
+  /* One items-changed for the whole result */
+  items = g_new(gpointer, matches->len);
+  for (guint i = 0; i < matches->len; i++) {
+    items[i] = g_array_index(matches, SearchResult, i).page;
+  }
+  g_list_store_splice(res, 0, 0, items, matches->len);
+
+  g_free(items);
+  g_array_unref(matches);
+  g_ptr_array_unref(candidates);
+
+out:
+  g_array_unref(preds);
+  return G_LIST_MODEL(res);
+}
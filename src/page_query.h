@@ -0,0 +1,26 @@
+#pragma once
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "search_index.h"
+#include "tag_index.h"
+
+G_BEGIN_DECLS
+
+#define PAGE_QUERY_ERROR page_query_error_quark()
+
+typedef enum {
+  PAGE_QUERY_ERROR_SYNTAX,
+} PageQueryError;
+
+GQuark page_query_error_quark(void);
+
+gboolean page_query_is_structured(const gchar *query);
+
+GListModel *page_query_run(const gchar *query,
+                           TagIndex *tags,
+                           SearchIndex *words,
+                           GError **error);
+
+G_END_DECLS
@@ -0,0 +1,286 @@
+#include <adwaita.h>
+#include <glib.h>
+#include <string.h>
+
+#include "editor_page.h"
+#include "fuzzy.h"
+#include "notes_page_list.h"
+#include "notes_page_store.h"
+#include "quick_switcher.h"
+
+#define MAX_RESULTS 50
+
+struct switcher_match {
+  guint entry;
+  gint score;
+};
+
+struct switcher {
+  GtkWidget *window;
+  GtkWidget *results;
+  /* EditorPage, matched against the fuzzy_key the page keeps */
+  GPtrArray *entries;
+  /* Indices of the entries matching the previous pattern */
+  GArray *candidates;
+  gchar *pattern;
+};
+
+static void
+switcher_free(struct switcher *sw)
+{
+  g_ptr_array_unref(sw->entries);
+  g_clear_pointer(&sw->candidates, g_array_unref);
+  g_free(sw->pattern);
+  g_free(sw);
+}
+
+static void
+add_entry(EditorPage *page, struct switcher *sw)
+{
+  /* "< Link to >" and "< New Page >" are actions of the list, not pages */
+  if (notes_page_store_page_noop(page) || notes_page_store_page_new(page)) {
+    return;
+  }
+
+  g_ptr_array_add(sw->entries, g_object_ref(page));
+}
+
+static gint
+match_cmp(const struct switcher_match *a,
+          const struct switcher_match *b,
+          GPtrArray *entries)
+{
+  if (a->score != b->score) {
+    return a->score > b->score ? -1 : 1;
+  }
+
+  return g_strcmp0(EDITOR_PAGE(entries->pdata[a->entry])->fuzzy_key,
+                   EDITOR_PAGE(entries->pdata[b->entry])->fuzzy_key);
+}
+
+/* Keeps the best MAX_RESULTS in order, no need to sort every match */
+static void
+keep_best(GArray *best, struct switcher_match *match, GPtrArray *entries)
+{
+  guint lo = 0;
+  guint hi = best->len;
+
+  if (best->len == MAX_RESULTS &&
+      match_cmp(match,
+                &g_array_index(best, struct switcher_match, best->len - 1),
+                entries) >= 0) {
+    return;
+  }
+
+  while (lo < hi) {
+    guint mid = (lo + hi) / 2;
+
+    if (match_cmp(match, &g_array_index(best, struct switcher_match, mid),
+                  entries) < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  g_array_insert_val(best, lo, *match);
+  if (best->len > MAX_RESULTS) {
+    g_array_set_size(best, MAX_RESULTS);
+  }
+}
+
+static void
+show_results(struct switcher *sw, GArray *best)
+{
+  GtkWidget *child;
+
+  while ((child = gtk_widget_get_first_child(sw->results)) != NULL) {
+    gtk_list_box_remove(GTK_LIST_BOX(sw->results), child);
+  }
+
+  for (guint i = 0; i < best->len; i++) {
+    struct switcher_match *match = &g_array_index(best, struct switcher_match,
+                                                  i);
+    EditorPage *page = sw->entries->pdata[match->entry];
+    GtkWidget *row = gtk_list_box_row_new();
+    GtkWidget *label = gtk_label_new(page->heading);
+
+    gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+    gtk_list_box_row_set_child(GTK_LIST_BOX_ROW(row), label);
+    g_object_set_data(G_OBJECT(row), "page", page);
+    gtk_list_box_append(GTK_LIST_BOX(sw->results), row);
+  }
+
+  gtk_list_box_select_row(GTK_LIST_BOX(sw->results),
+                          gtk_list_box_get_row_at_index(
+                            GTK_LIST_BOX(sw->results), 0));
+}
+
+static void
+search_changed(GtkEditable *search, struct switcher *sw)
+{
+  GArray *matched;
+  GArray *best;
+  gchar *pattern;
+  gboolean narrowing;
+  guint n;
+
+  pattern = fuzzy_fold(gtk_editable_get_text(search));
+
+  /* Whatever matches the longer pattern also matched the shorter one */
+  narrowing = sw->candidates != NULL && sw->pattern != NULL &&
+              g_str_has_prefix(pattern, sw->pattern);
+  n = narrowing ? sw->candidates->len : sw->entries->len;
+
+  matched = g_array_new(FALSE, FALSE, sizeof(guint));
+  best = g_array_sized_new(FALSE, FALSE, sizeof(struct switcher_match),
+                           MAX_RESULTS + 1);
+
+  for (guint i = 0; i < n; i++) {
+    guint idx = narrowing ? g_array_index(sw->candidates, guint, i) : i;
+    EditorPage *page = sw->entries->pdata[idx];
+    struct switcher_match match = { idx, fuzzy_score(page->fuzzy_key,
+                                                     pattern) };
+
+    if (match.score == FUZZY_NO_MATCH) {
+      continue;
+    }
+
+    g_array_append_val(matched, idx);
+    keep_best(best, &match, sw->entries);
+  }
+
+  show_results(sw, best);
+
+  g_clear_pointer(&sw->candidates, g_array_unref);
+  sw->candidates = matched;
+  g_free(sw->pattern);
+  sw->pattern = pattern;
+
+  g_array_unref(best);
+}
+
+static void
+row_activated(G_GNUC_UNUSED GtkListBox *box,
+              GtkListBoxRow *row,
+              struct switcher *sw)
+{
+  EditorPage *page = g_object_get_data(G_OBJECT(row), "page");
+
+  g_object_ref(page);
+  gtk_window_destroy(GTK_WINDOW(sw->window));
+
+  /* Same as clicking a link to the page */
+  editor_page_switch_to(page);
+  g_object_unref(page);
+}
+
+static void
+entry_activated(G_GNUC_UNUSED GtkSearchEntry *search, struct switcher *sw)
+{
+  GtkListBoxRow *row;
+
+  row = gtk_list_box_get_selected_row(GTK_LIST_BOX(sw->results));
+  if (row != NULL) {
+    row_activated(NULL, row, sw);
+  }
+}
+
+static void
+move_selection(struct switcher *sw, gint step)
+{
+  GtkListBoxRow *row;
+  gint index = 0;
+
+  row = gtk_list_box_get_selected_row(GTK_LIST_BOX(sw->results));
+  if (row != NULL) {
+    index = gtk_list_box_row_get_index(row) + step;
+  }
+
+  row = gtk_list_box_get_row_at_index(GTK_LIST_BOX(sw->results), index);
+  if (row != NULL) {
+    gtk_list_box_select_row(GTK_LIST_BOX(sw->results), row);
+  }
+}
+
+static gboolean
+key_pressed(G_GNUC_UNUSED GtkEventControllerKey *controller,
+            guint keyval,
+            G_GNUC_UNUSED guint keycode,
+            G_GNUC_UNUSED GdkModifierType state,
+            struct switcher *sw)
+{
+  /* The focus stays in the entry, arrows move through the results */
+  if (keyval == GDK_KEY_Down) {
+    move_selection(sw, 1);
+    return TRUE;
+  } else if (keyval == GDK_KEY_Up) {
+    move_selection(sw, -1);
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+static void
+stop_search(G_GNUC_UNUSED GtkSearchEntry *search, struct switcher *sw)
+{
+  gtk_window_destroy(GTK_WINDOW(sw->window));
+}
+
+void
+quick_switcher_show(GtkWindow *parent, NotesPageList *pages_list)
+{
+  struct switcher *sw;
+  GtkWidget *box;
+  GtkWidget *search;
+  GtkWidget *scroll;
+  GtkEventController *keys;
+
+  g_return_if_fail(pages_list != NULL);
+
+  sw = g_malloc0(sizeof(*sw));
+  sw->entries = g_ptr_array_new_with_free_func(g_object_unref);
+  notes_page_list_for_each(pages_list, (pages_for_each) add_entry, sw);
+
+  sw->window = adw_window_new();
+  gtk_window_set_transient_for(GTK_WINDOW(sw->window), parent);
+  gtk_window_set_modal(GTK_WINDOW(sw->window), TRUE);
+  gtk_window_set_default_size(GTK_WINDOW(sw->window), 500, 400);
+  g_object_set_data_full(G_OBJECT(sw->window), "switcher", sw,
+                         (GDestroyNotify) switcher_free);
+
+  box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+
+  search = gtk_search_entry_new();
+  g_object_set(search, "placeholder-text", "Go to page", NULL);
+  gtk_box_append(GTK_BOX(box), search);
+
+  sw->results = gtk_list_box_new();
+  gtk_list_box_set_activate_on_single_click(GTK_LIST_BOX(sw->results), TRUE);
+
+  scroll = gtk_scrolled_window_new();
+  gtk_widget_set_vexpand(scroll, TRUE);
+  gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scroll), sw->results);
+  gtk_box_append(GTK_BOX(box), scroll);
+
+  adw_window_set_content(ADW_WINDOW(sw->window), box);
+
+  keys = gtk_event_controller_key_new();
+  gtk_widget_add_controller(search, keys);
+
+  /* "changed" rather than "search-changed", results follow every key
+   * without the search delay */
+  g_signal_connect(search, "changed", G_CALLBACK(search_changed), sw);
+  g_signal_connect(search, "activate", G_CALLBACK(entry_activated), sw);
+  g_signal_connect(keys, "key-pressed", G_CALLBACK(key_pressed), sw);
+  g_signal_connect(search, "stop-search", G_CALLBACK(stop_search), sw);
+  g_signal_connect(sw->results, "row-activated", G_CALLBACK(row_activated),
+                   sw);
+
+  /* Everything, best first, before anything is typed */
+  search_changed(GTK_EDITABLE(search), sw);
+
+  gtk_window_present(GTK_WINDOW(sw->window));
+  gtk_widget_grab_focus(search);
+}
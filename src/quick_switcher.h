@@ -0,0 +1,12 @@
+#pragma once
+
+#include <glib-object.h>
+#include <gtk/gtk.h>
+
+#include "notes_page_list.h"
+
+G_BEGIN_DECLS
+
+void quick_switcher_show(GtkWindow *parent, NotesPageList *pages_list);
+
+G_END_DECLS
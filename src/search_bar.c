@@ -0,0 +1,308 @@
+#include <glib-object.h>
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <string.h>
+
+#include "editor_page.h"
+#include "page_query.h"
+#include "search_bar.h"
+#include "search_index.h"
+#include "tag_index.h"
+#include "trigram_index.h"
+
+#define MAX_RESULTS 50
+
+struct _NotesSearchBar {
+  GtkBox parent;
+  SearchIndex *index;
+  TrigramIndex *trigrams;
+  TagIndex *tags;
+  GtkWidget *entry;
+  GtkWidget *exact;
+  GtkWidget *popover;
+  GtkWidget *results;
+};
+
+G_DEFINE_TYPE(NotesSearchBar, notes_search_bar, GTK_TYPE_BOX)
+
+enum notes_search_bar_signals {
+  NOTES_SEARCH_BAR_OPEN_RESULT = 0,
+  NOTES_SEARCH_BAR_LAST
+};
+
+static guint search_bar_signals[NOTES_SEARCH_BAR_LAST] = { 0 };
+
+static void
+clear_results(NotesSearchBar *self)
+{
+  GtkWidget *child;
+
+  while ((child = gtk_widget_get_first_child(self->results)) != NULL) {
+    gtk_list_box_remove(GTK_LIST_BOX(self->results), child);
+  }
+}
+
+static GtkWidget *
+result_row(EditorPage *page, const gchar *text)
+{
+  GtkWidget *row;
+  GtkWidget *label;
+
+  label = gtk_label_new(text);
+  gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+
+  row = gtk_list_box_row_new();
+  gtk_list_box_row_set_child(GTK_LIST_BOX_ROW(row), label);
+  g_object_set_data_full(G_OBJECT(row), "page", g_object_ref(page),
+                         g_object_unref);
+
+  return row;
+}
+
+static void
+add_result(NotesSearchBar *self, SearchResult *result)
+{
+  gchar *text;
+
+  text = g_strdup_printf("%s (%u)", result->page->heading, result->hits);
+  gtk_list_box_append(GTK_LIST_BOX(self->results),
+                      result_row(result->page, text));
+  g_free(text);
+}
+
+static void
+add_message(NotesSearchBar *self, const gchar *message)
+{
+  GtkWidget *label = gtk_label_new(message);
+
+  gtk_label_set_wrap(GTK_LABEL(label), TRUE);
+  gtk_widget_set_sensitive(label, FALSE);
+  gtk_list_box_append(GTK_LIST_BOX(self->results), label);
+}
+
+/* tag:, draft: and text: predicates, see page_query.c. "tag:x" alone can
+ * match most of the workspace, only the first MAX_RESULTS get a row. */
+static void
+run_query(NotesSearchBar *self, const gchar *query)
+{
+  GError *lerr = NULL;
+  GListModel *results;
+  guint n_items;
+
+  results = page_query_run(query, self->tags, self->index, &lerr);
+  if (results == NULL) {
+    add_message(self, lerr->message);
+    g_clear_error(&lerr);
+    return;
+  }
+
+  n_items = g_list_model_get_n_items(results);
+  for (guint i = 0; i < n_items && i < MAX_RESULTS; i++) {
+    EditorPage *page = g_list_model_get_item(results, i);
+
+    gtk_list_box_append(GTK_LIST_BOX(self->results),
+                        result_row(page, page->heading));
+    g_object_unref(page);
+  }
+
+  if (n_items == 0) {
+    add_message(self, "No matches");
+  } else if (n_items > MAX_RESULTS) {
+    gchar *more = g_strdup_printf("%u more pages match", n_items - MAX_RESULTS);
+
+    add_message(self, more);
+    g_free(more);
+  }
+
+  g_object_unref(results);
+}
+
+static gboolean
+is_exact(NotesSearchBar *self)
+{
+  return gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(self->exact));
+}
+
+static void
+search_changed(G_GNUC_UNUSED GtkWidget *widget, NotesSearchBar *self)
+{
+  const gchar *query;
+  GArray *results;
+
+  query = gtk_editable_get_text(GTK_EDITABLE(self->entry));
+
+  clear_results(self);
+
+  if (query == NULL || query[0] == '\0') {
+    gtk_popover_popdown(GTK_POPOVER(self->popover));
+    return;
+  }
+
+  if (self->tags != NULL && page_query_is_structured(query)) {
+    run_query(self, query);
+    gtk_popover_popup(GTK_POPOVER(self->popover));
+    return;
+  }
+
+  if (is_exact(self) && strlen(query) < TRIGRAM_MIN_QUERY) {
+    add_message(self, "Type at least 3 characters for an exact search");
+    gtk_popover_popup(GTK_POPOVER(self->popover));
+    return;
+  }
+
+  if (is_exact(self)) {
+    results = trigram_index_query(self->trigrams, query);
+  } else {
+    results = search_index_query(self->index, query);
+  }
+
+  for (guint i = 0; i < results->len && i < MAX_RESULTS; i++) {
+    add_result(self, &g_array_index(results, SearchResult, i));
+  }
+
+  if (results->len == 0) {
+    add_message(self, "No matches");
+  }
+
+  g_array_unref(results);
+  gtk_popover_popup(GTK_POPOVER(self->popover));
+}
+
+static void
+result_activated(G_GNUC_UNUSED GtkListBox *box,
+                 GtkListBoxRow *row,
+                 NotesSearchBar *self)
+{
+  const gchar *query;
+  EditorPage *page;
+  gchar **terms;
+
+  page = g_object_get_data(G_OBJECT(row), "page");
+  if (page == NULL) {
+    return;
+  }
+
+  query = gtk_editable_get_text(GTK_EDITABLE(self->entry));
+
+  gtk_popover_popdown(GTK_POPOVER(self->popover));
+
+  if (self->tags != NULL && page_query_is_structured(query)) {
+    g_signal_emit(self, search_bar_signals[NOTES_SEARCH_BAR_OPEN_RESULT], 0,
+                  page, NULL);
+    return;
+  }
+
+  if (is_exact(self)) {
+    g_signal_emit(self, search_bar_signals[NOTES_SEARCH_BAR_OPEN_RESULT], 0,
+                  page, query);
+    return;
+  }
+
+  /* Select the first word, the others may be anywhere in the page */
+  terms = search_tokenize(query);
+  g_signal_emit(self, search_bar_signals[NOTES_SEARCH_BAR_OPEN_RESULT], 0,
+                page, terms[0]);
+  g_strfreev(terms);
+}
+
+static void
+entry_activated(G_GNUC_UNUSED GtkSearchEntry *entry, NotesSearchBar *self)
+{
+  GtkListBoxRow *first;
+
+  first = gtk_list_box_get_row_at_index(GTK_LIST_BOX(self->results), 0);
+  if (first != NULL) {
+    result_activated(NULL, first, self);
+  }
+}
+
+static void
+stop_search(G_GNUC_UNUSED GtkSearchEntry *entry, NotesSearchBar *self)
+{
+  gtk_popover_popdown(GTK_POPOVER(self->popover));
+}
+
+static void
+notes_search_bar_dispose(GObject *obj)
+{
+  NotesSearchBar *self = NOTES_SEARCH_BAR(obj);
+
+  g_assert(self);
+
+  /* Popovers are not children of the box, they need unparenting */
+  g_clear_pointer(&self->popover, gtk_widget_unparent);
+
+  G_OBJECT_CLASS(notes_search_bar_parent_class)->dispose(obj);
+}
+
+static void
+notes_search_bar_class_init(NotesSearchBarClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+  object_class->dispose = notes_search_bar_dispose;
+
+  GType params[] = { G_TYPE_OBJECT, G_TYPE_STRING };
+  search_bar_signals[NOTES_SEARCH_BAR_OPEN_RESULT] =
+    g_signal_newv("open-result", G_TYPE_FROM_CLASS(klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  NULL, NULL, NULL, NULL, G_TYPE_NONE, 2, params);
+}
+
+static void
+notes_search_bar_init(NotesSearchBar *self)
+{
+  GtkWidget *scroll;
+
+  self->entry = gtk_search_entry_new();
+  gtk_widget_set_size_request(self->entry, 250, -1);
+  gtk_widget_set_tooltip_text(self->entry,
+                              "Words to find, or a query like: tag:meeting "
+                              "draft:true text:'budget' -tag:done");
+  gtk_box_append(GTK_BOX(self), self->entry);
+
+  self->exact = gtk_toggle_button_new_with_label("{ }");
+  gtk_widget_set_tooltip_text(self->exact,
+                              "Match exact text, including code and paths");
+  gtk_box_append(GTK_BOX(self), self->exact);
+
+  self->results = gtk_list_box_new();
+  gtk_list_box_set_activate_on_single_click(GTK_LIST_BOX(self->results), TRUE);
+
+  scroll = gtk_scrolled_window_new();
+  gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scroll), self->results);
+  gtk_scrolled_window_set_propagate_natural_height(GTK_SCROLLED_WINDOW(scroll),
+                                                   TRUE);
+  gtk_scrolled_window_set_max_content_height(GTK_SCROLLED_WINDOW(scroll), 400);
+  gtk_scrolled_window_set_min_content_width(GTK_SCROLLED_WINDOW(scroll), 250);
+
+  self->popover = gtk_popover_new();
+  gtk_popover_set_child(GTK_POPOVER(self->popover), scroll);
+  /* Keep the focus in the entry while typing */
+  gtk_popover_set_autohide(GTK_POPOVER(self->popover), FALSE);
+  gtk_popover_set_position(GTK_POPOVER(self->popover), GTK_POS_BOTTOM);
+  gtk_widget_set_parent(self->popover, GTK_WIDGET(self));
+
+  g_signal_connect(self->entry, "search-changed", G_CALLBACK(search_changed),
+                   self);
+  g_signal_connect(self->exact, "toggled", G_CALLBACK(search_changed), self);
+  g_signal_connect(self->entry, "activate", G_CALLBACK(entry_activated), self);
+  g_signal_connect(self->entry, "stop-search", G_CALLBACK(stop_search), self);
+  g_signal_connect(self->results, "row-activated",
+                   G_CALLBACK(result_activated), self);
+}
+
+NotesSearchBar *
+notes_search_bar_new(SearchIndex *index,
+                     TrigramIndex *trigrams,
+                     TagIndex *tags)
+{
+  NotesSearchBar *self = g_object_new(NOTES_TYPE_SEARCH_BAR, "orientation",
+                                      GTK_ORIENTATION_HORIZONTAL, NULL);
+
+  self->index = index;
+  self->trigrams = trigrams;
+  self->tags = tags;
+
+  return self;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glib-object.h>
+#include <gtk/gtk.h>
+
+#include "search_index.h"
+#include "tag_index.h"
+#include "trigram_index.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Type declaration.
+ */
+
+#define NOTES_TYPE_SEARCH_BAR notes_search_bar_get_type()
+G_DECLARE_FINAL_TYPE(NotesSearchBar, notes_search_bar, NOTES, SEARCH_BAR, GtkBox)
+
+/*
+ * Method definitions.
+ */
+NotesSearchBar *notes_search_bar_new(SearchIndex *index,
+                                     TrigramIndex *trigrams,
+                                     TagIndex *tags);
+
+G_END_DECLS
@@ -0,0 +1,627 @@
+#include <gio/gio.h>
+#include <glib.h>
+#include <string.h>
+
+#include "editor_page.h"
+#include "search_cache.h"
+#include "search_index.h"
+#include "trigram_index.h"
+
+/* The words and trigrams of every page, written next to the pages so a
+ * launch only has to read and parse the files that changed since. The file
+ * is mapped as is: a header, then fixed size records that refer to each
+ * other by index and into a pool of strings that are not NUL terminated.
+ *
+ *   header
+ *   files[n_files]          sorted by name
+ *   terms[n_terms]          the term dictionary
+ *   entries[n_entries]      term and positions of one term in one file
+ *   positions[n_positions]  guint32 word positions
+ *   trigrams[n_trigrams]    guint32 trigrams of each file, sorted
+ *   strings[strings_len]
+ *
+ * Queries are not answered from the mapping. A lookup copies the records of
+ * one file into the in-memory indexes, which is still far cheaper than
+ * reading, parsing and tokenizing the file again.
+ *
+ * Only the header is checked when the file is mapped, the records of a file
+ * are checked when it is looked up. Anything that does not add up is the
+ * same as the file not being in the cache. */
+
+#define CACHE_MAGIC      "NEINDEX"
+#define CACHE_VERSION    2
+#define CACHE_BYTE_ORDER 0x01020304
+
+typedef struct {
+  gchar magic[8];
+  guint32 version;
+  guint32 byte_order;
+  guint32 n_files;
+  guint32 n_terms;
+  guint32 n_entries;
+  guint32 n_positions;
+  guint32 strings_len;
+  guint32 n_trigrams;
+} CacheHeader;
+
+typedef struct {
+  gint64 mtime;
+  guint64 size;
+  guint32 name;
+  guint32 name_len;
+  guint32 first_entry;
+  guint32 n_entries;
+  guint32 first_trigram;
+  guint32 n_trigrams;
+} CacheFile;
+
+typedef struct {
+  guint32 text;
+  guint32 len;
+} CacheTerm;
+
+typedef struct {
+  guint32 term;
+  guint32 first_position;
+  guint32 n_positions;
+} CacheEntry;
+
+G_STATIC_ASSERT(sizeof(CacheHeader) % 8 == 0);
+G_STATIC_ASSERT(sizeof(CacheFile) % 8 == 0);
+
+typedef struct {
+  gchar *filename;
+  SearchStamp stamp;
+} PageStamp;
+
+struct _SearchCache {
+  gchar *root;
+  gchar *path;
+
+  /* Mapped on the first lookup */
+  gboolean loaded;
+  GMappedFile *file;
+  const CacheHeader *header;
+  const CacheFile *files;
+  const CacheTerm *terms;
+  const CacheEntry *entries;
+  const guint32 *positions;
+  const guint32 *trigrams;
+  const gchar *strings;
+
+  /* EditorPage -> PageStamp, pages whose index matches their file */
+  GHashTable *stamps;
+  gboolean dirty;
+};
+
+static void
+page_stamp_free(PageStamp *stamp)
+{
+  g_free(stamp->filename);
+  g_free(stamp);
+}
+
+gboolean
+search_stamp_read(const gchar *path, SearchStamp *stamp)
+{
+  GFileInfo *info;
+  GFile *file;
+
+  g_return_val_if_fail(path != NULL, FALSE);
+  g_return_val_if_fail(stamp != NULL, FALSE);
+
+  file = g_file_new_for_path(path);
+  info = g_file_query_info(file,
+                           G_FILE_ATTRIBUTE_STANDARD_SIZE
+                           "," G_FILE_ATTRIBUTE_TIME_MODIFIED
+                           "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                           G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  g_object_unref(file);
+
+  if (info == NULL) {
+    return FALSE;
+  }
+
+  stamp->mtime =
+    (gint64) g_file_info_get_attribute_uint64(info,
+                                              G_FILE_ATTRIBUTE_TIME_MODIFIED) *
+      G_USEC_PER_SEC +
+    g_file_info_get_attribute_uint32(info,
+                                     G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+  stamp->size = g_file_info_get_size(info);
+  g_object_unref(info);
+
+  return TRUE;
+}
+
+SearchCache *
+search_cache_new(const gchar *root)
+{
+  SearchCache *self;
+
+  g_return_val_if_fail(root != NULL, NULL);
+
+  self = g_malloc0(sizeof(*self));
+  self->root = g_strdup(root);
+  self->path = g_build_filename(root, SEARCH_CACHE_FILE, NULL);
+  self->stamps = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                       g_object_unref,
+                                       (GDestroyNotify) page_stamp_free);
+
+  return self;
+}
+
+void
+search_cache_free(SearchCache *self)
+{
+  if (self == NULL) {
+    return;
+  }
+
+  g_clear_pointer(&self->file, g_mapped_file_unref);
+  g_hash_table_unref(self->stamps);
+  g_free(self->root);
+  g_free(self->path);
+  g_free(self);
+}
+
+const gchar *
+search_cache_get_root(SearchCache *self)
+{
+  g_return_val_if_fail(self != NULL, NULL);
+
+  return self->root;
+}
+
+static void
+unload(SearchCache *self)
+{
+  g_clear_pointer(&self->file, g_mapped_file_unref);
+  self->header = NULL;
+}
+
+static void
+load(SearchCache *self)
+{
+  GError *lerr = NULL;
+  const gchar *data;
+  guint64 expected;
+  gsize size;
+
+  self->loaded = TRUE;
+
+  self->file = g_mapped_file_new(self->path, FALSE, &lerr);
+  if (self->file == NULL) {
+    g_debug("No search cache: %s", lerr->message);
+    g_clear_error(&lerr);
+    return;
+  }
+
+  data = g_mapped_file_get_contents(self->file);
+  size = g_mapped_file_get_length(self->file);
+
+  if (size < sizeof(CacheHeader)) {
+    g_debug("Search cache %s is truncated", self->path);
+    unload(self);
+    return;
+  }
+
+  self->header = (const CacheHeader *) data;
+
+  if (memcmp(self->header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+      self->header->version != CACHE_VERSION ||
+      self->header->byte_order != CACHE_BYTE_ORDER) {
+    g_debug("Search cache %s is from another version", self->path);
+    unload(self);
+    return;
+  }
+
+  expected = sizeof(CacheHeader) +
+             (guint64) self->header->n_files * sizeof(CacheFile) +
+             (guint64) self->header->n_terms * sizeof(CacheTerm) +
+             (guint64) self->header->n_entries * sizeof(CacheEntry) +
+             (guint64) self->header->n_positions * sizeof(guint32) +
+             (guint64) self->header->n_trigrams * sizeof(guint32) +
+             self->header->strings_len;
+
+  if (expected != size) {
+    g_debug("Search cache %s has the wrong size", self->path);
+    unload(self);
+    return;
+  }
+
+  self->files = (const CacheFile *) (self->header + 1);
+  self->terms = (const CacheTerm *) (self->files + self->header->n_files);
+  self->entries = (const CacheEntry *) (self->terms + self->header->n_terms);
+  self->positions =
+    (const guint32 *) (self->entries + self->header->n_entries);
+  self->trigrams = self->positions + self->header->n_positions;
+  self->strings = (const gchar *) (self->trigrams + self->header->n_trigrams);
+}
+
+static gboolean
+string_in_bounds(SearchCache *self, guint32 offset, guint32 len)
+{
+  return (guint64) offset + len <= self->header->strings_len;
+}
+
+static const CacheFile *
+find_file(SearchCache *self, const gchar *filename)
+{
+  gsize len = strlen(filename);
+  guint lo = 0;
+  guint hi = self->header->n_files;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    const CacheFile *file = &self->files[mid];
+    gint cmp;
+
+    if (!string_in_bounds(self, file->name, file->name_len)) {
+      return NULL;
+    }
+
+    cmp = memcmp(self->strings + file->name, filename,
+                 MIN(file->name_len, len));
+    if (cmp == 0) {
+      cmp = (file->name_len > len) - (file->name_len < len);
+    }
+
+    if (cmp == 0) {
+      return file;
+    } else if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return NULL;
+}
+
+/* The record of the file, NULL when it is not in the cache or has changed
+ * since */
+static const CacheFile *
+find_current(SearchCache *self,
+             const gchar *filename,
+             const SearchStamp *stamp)
+{
+  const CacheFile *file;
+
+  if (!self->loaded) {
+    load(self);
+  }
+  if (self->header == NULL) {
+    return NULL;
+  }
+
+  file = find_file(self, filename);
+  if (file == NULL || file->mtime != stamp->mtime ||
+      file->size != stamp->size) {
+    return NULL;
+  }
+
+  return file;
+}
+
+/* The word index of the file as it was written, NULL when the file is not
+ * in the cache or has changed since */
+SearchDoc *
+search_cache_lookup(SearchCache *self,
+                    const gchar *filename,
+                    const SearchStamp *stamp)
+{
+  const CacheFile *file;
+  SearchDoc *doc;
+
+  g_return_val_if_fail(self != NULL, NULL);
+  g_return_val_if_fail(filename != NULL, NULL);
+  g_return_val_if_fail(stamp != NULL, NULL);
+
+  file = find_current(self, filename, stamp);
+  if (file == NULL) {
+    return NULL;
+  }
+
+  if ((guint64) file->first_entry + file->n_entries >
+      self->header->n_entries) {
+    return NULL;
+  }
+
+  doc = g_malloc0(sizeof(*doc));
+  doc->terms = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                     (GDestroyNotify) g_array_unref);
+
+  for (guint i = 0; i < file->n_entries; i++) {
+    const CacheEntry *entry = &self->entries[file->first_entry + i];
+    const CacheTerm *term;
+    GArray *positions;
+
+    if (entry->term >= self->header->n_terms ||
+        (guint64) entry->first_position + entry->n_positions >
+          self->header->n_positions) {
+      goto corrupt;
+    }
+
+    term = &self->terms[entry->term];
+    if (!string_in_bounds(self, term->text, term->len)) {
+      goto corrupt;
+    }
+
+    positions = g_array_sized_new(FALSE, FALSE, sizeof(guint32),
+                                  entry->n_positions);
+    g_array_append_vals(positions, self->positions + entry->first_position,
+                        entry->n_positions);
+    g_hash_table_insert(doc->terms,
+                        g_strndup(self->strings + term->text, term->len),
+                        positions);
+  }
+
+  return doc;
+
+corrupt:
+  g_debug("Search cache entry of %s is corrupt", filename);
+  search_doc_free(doc);
+  return NULL;
+}
+
+/* The trigrams of the file as it was written, the same rules as for
+ * search_cache_lookup() */
+TrigramDoc *
+search_cache_lookup_trigrams(SearchCache *self,
+                             const gchar *filename,
+                             const SearchStamp *stamp)
+{
+  const CacheFile *file;
+  TrigramDoc *doc;
+
+  g_return_val_if_fail(self != NULL, NULL);
+  g_return_val_if_fail(filename != NULL, NULL);
+  g_return_val_if_fail(stamp != NULL, NULL);
+
+  file = find_current(self, filename, stamp);
+  if (file == NULL) {
+    return NULL;
+  }
+
+  if ((guint64) file->first_trigram + file->n_trigrams >
+      self->header->n_trigrams) {
+    g_debug("Search cache entry of %s is corrupt", filename);
+    return NULL;
+  }
+
+  doc = g_malloc0(sizeof(*doc));
+  doc->trigrams = g_array_sized_new(FALSE, FALSE, sizeof(guint32),
+                                    file->n_trigrams);
+  g_array_append_vals(doc->trigrams, self->trigrams + file->first_trigram,
+                      file->n_trigrams);
+
+  return doc;
+}
+
+/* The page is indexed with the content of the file as it is on disk */
+void
+search_cache_stamp(SearchCache *self,
+                   EditorPage *page,
+                   const gchar *filename,
+                   const SearchStamp *stamp)
+{
+  const CacheFile *file = NULL;
+  PageStamp *page_stamp;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+  g_return_if_fail(filename != NULL);
+  g_return_if_fail(stamp != NULL);
+
+  page_stamp = g_hash_table_lookup(self->stamps, page);
+  if (page_stamp != NULL && g_strcmp0(page_stamp->filename, filename) == 0 &&
+      page_stamp->stamp.mtime == stamp->mtime &&
+      page_stamp->stamp.size == stamp->size) {
+    return;
+  }
+
+  page_stamp = g_malloc0(sizeof(*page_stamp));
+  page_stamp->filename = g_strdup(filename);
+  page_stamp->stamp = *stamp;
+
+  g_hash_table_insert(self->stamps, g_object_ref(page), page_stamp);
+
+  /* Pages restored from the cache do not need it written again */
+  if (!self->loaded) {
+    load(self);
+  }
+  if (self->header != NULL) {
+    file = find_file(self, filename);
+  }
+  if (file == NULL || file->mtime != stamp->mtime ||
+      file->size != stamp->size) {
+    self->dirty = TRUE;
+  }
+}
+
+/* The page was edited, its index no longer matches the file */
+void
+search_cache_unstamp(SearchCache *self, EditorPage *page)
+{
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+
+  if (g_hash_table_remove(self->stamps, page)) {
+    self->dirty = TRUE;
+  }
+}
+
+typedef struct {
+  /* term -> index in terms, plus one */
+  GHashTable *term_ids;
+  GPtrArray *terms;
+  GArray *entries;
+  GArray *positions;
+} CacheBuilder;
+
+static void
+add_term(const gchar *term, GArray *positions, gpointer user_data)
+{
+  CacheBuilder *builder = (CacheBuilder *) user_data;
+  CacheEntry entry;
+  guint id;
+
+  id = GPOINTER_TO_UINT(g_hash_table_lookup(builder->term_ids, term));
+  if (id == 0) {
+    g_ptr_array_add(builder->terms, (gpointer) term);
+    id = builder->terms->len;
+    g_hash_table_insert(builder->term_ids, (gpointer) term,
+                        GUINT_TO_POINTER(id));
+  }
+
+  entry.term = id - 1;
+  entry.first_position = builder->positions->len;
+  entry.n_positions = positions->len;
+  g_array_append_val(builder->entries, entry);
+  g_array_append_vals(builder->positions, positions->data, positions->len);
+}
+
+typedef struct {
+  EditorPage *page;
+  const PageStamp *stamp;
+} StampedPage;
+
+static gint
+stamped_page_cmp(gconstpointer a, gconstpointer b)
+{
+  const StampedPage *sa = a;
+  const StampedPage *sb = b;
+
+  return strcmp(sa->stamp->filename, sb->stamp->filename);
+}
+
+static guint32
+add_string(GString *strings, const gchar *text)
+{
+  guint32 offset = strings->len;
+
+  g_string_append(strings, text);
+
+  return offset;
+}
+
+/* Writes the indexes of every stamped page, does nothing when no page was
+ * stamped or unstamped since the last write */
+gboolean
+search_cache_write(SearchCache *self,
+                   SearchIndex *index,
+                   TrigramIndex *trigrams,
+                   GError **error)
+{
+  CacheHeader header = { CACHE_MAGIC, CACHE_VERSION, CACHE_BYTE_ORDER };
+  CacheBuilder builder;
+  GHashTableIter iter;
+  EditorPage *page;
+  PageStamp *page_stamp;
+  GArray *pages;
+  GArray *files;
+  GArray *grams;
+  GString *strings;
+  GByteArray *out;
+  gboolean res;
+
+  g_return_val_if_fail(self != NULL, FALSE);
+  g_return_val_if_fail(index != NULL, FALSE);
+  g_return_val_if_fail(trigrams != NULL, FALSE);
+
+  if (!self->dirty) {
+    return TRUE;
+  }
+
+  /* Pages still waiting to be indexed are left out until the next write */
+  pages = g_array_new(FALSE, FALSE, sizeof(StampedPage));
+  g_hash_table_iter_init(&iter, self->stamps);
+  while (g_hash_table_iter_next(&iter, (gpointer *) &page,
+                                (gpointer *) &page_stamp)) {
+    StampedPage stamped = { page, page_stamp };
+
+    if (search_index_has_page(index, page) &&
+        trigram_index_has_page(trigrams, page)) {
+      g_array_append_val(pages, stamped);
+    }
+  }
+  g_array_sort(pages, stamped_page_cmp);
+
+  builder.term_ids = g_hash_table_new(g_str_hash, g_str_equal);
+  builder.terms = g_ptr_array_new();
+  builder.entries = g_array_new(FALSE, FALSE, sizeof(CacheEntry));
+  builder.positions = g_array_new(FALSE, FALSE, sizeof(guint32));
+  files = g_array_sized_new(FALSE, TRUE, sizeof(CacheFile), pages->len);
+  grams = g_array_new(FALSE, FALSE, sizeof(guint32));
+  strings = g_string_new("");
+
+  for (guint i = 0; i < pages->len; i++) {
+    StampedPage *stamped = &g_array_index(pages, StampedPage, i);
+    const GArray *page_grams;
+    CacheFile file = { 0 };
+
+    file.mtime = stamped->stamp->stamp.mtime;
+    file.size = stamped->stamp->stamp.size;
+    file.name = add_string(strings, stamped->stamp->filename);
+    file.name_len = strlen(stamped->stamp->filename);
+    file.first_entry = builder.entries->len;
+    search_index_page_foreach(index, stamped->page, add_term, &builder);
+    file.n_entries = builder.entries->len - file.first_entry;
+    page_grams = trigram_index_get_trigrams(trigrams, stamped->page);
+    file.first_trigram = grams->len;
+    file.n_trigrams = page_grams->len;
+    g_array_append_vals(grams, page_grams->data, page_grams->len);
+    g_array_append_val(files, file);
+  }
+
+  out = g_byte_array_new();
+  header.n_files = files->len;
+  header.n_terms = builder.terms->len;
+  header.n_entries = builder.entries->len;
+  header.n_positions = builder.positions->len;
+  header.n_trigrams = grams->len;
+
+  g_byte_array_append(out, (guint8 *) &header, sizeof(header));
+  g_byte_array_append(out, (guint8 *) files->data,
+                      files->len * sizeof(CacheFile));
+
+  for (guint i = 0; i < builder.terms->len; i++) {
+    const gchar *term = builder.terms->pdata[i];
+    CacheTerm record = { add_string(strings, term), strlen(term) };
+
+    g_byte_array_append(out, (guint8 *) &record, sizeof(record));
+  }
+
+  g_byte_array_append(out, (guint8 *) builder.entries->data,
+                      builder.entries->len * sizeof(CacheEntry));
+  g_byte_array_append(out, (guint8 *) builder.positions->data,
+                      builder.positions->len * sizeof(guint32));
+  g_byte_array_append(out, (guint8 *) grams->data,
+                      grams->len * sizeof(guint32));
+  g_byte_array_append(out, (guint8 *) strings->str, strings->len);
+
+  /* The header went in before the string pool was complete */
+  ((CacheHeader *) out->data)->strings_len = strings->len;
+
+  /* Replaced with a rename, the next lookup maps the new file */
+  res = g_file_set_contents(self->path, (const gchar *) out->data, out->len,
+                            error);
+  if (res) {
+    self->dirty = FALSE;
+    unload(self);
+    self->loaded = FALSE;
+  }
+
+  g_byte_array_unref(out);
+  g_string_free(strings, TRUE);
+  g_array_unref(grams);
+  g_array_unref(files);
+  g_array_unref(builder.positions);
+  g_array_unref(builder.entries);
+  g_ptr_array_unref(builder.terms);
+  g_hash_table_unref(builder.term_ids);
+  g_array_unref(pages);
+
+  return res;
+}
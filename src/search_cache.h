@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glib.h>
+
+#include "editor_page.h"
+#include "search_index.h"
+#include "trigram_index.h"
+
+G_BEGIN_DECLS
+
+/* Name of the cache file, kept in the workspace folder */
+#define SEARCH_CACHE_FILE ".notes-editor.index"
+
+typedef struct _SearchCache SearchCache;
+
+/* What a file looked like on disk when it was indexed */
+typedef struct {
+  /* Microseconds since the epoch */
+  gint64 mtime;
+  guint64 size;
+} SearchStamp;
+
+gboolean search_stamp_read(const gchar *path, SearchStamp *stamp);
+
+SearchCache *search_cache_new(const gchar *root);
+
+void search_cache_free(SearchCache *self);
+
+const gchar *search_cache_get_root(SearchCache *self);
+
+SearchDoc *search_cache_lookup(SearchCache *self,
+                               const gchar *filename,
+                               const SearchStamp *stamp);
+
+TrigramDoc *search_cache_lookup_trigrams(SearchCache *self,
+                                         const gchar *filename,
+                                         const SearchStamp *stamp);
+
+void search_cache_stamp(SearchCache *self,
+                        EditorPage *page,
+                        const gchar *filename,
+                        const SearchStamp *stamp);
+
+void search_cache_unstamp(SearchCache *self, EditorPage *page);
+
+gboolean search_cache_write(SearchCache *self,
+                            SearchIndex *index,
+                            TrigramIndex *trigrams,
+                            GError **error);
+
+G_END_DECLS
@@ -0,0 +1,386 @@
+#include <glib.h>
+
+#include "editor_page.h"
+#include "search_index.h"
+
+/* Longer words are most likely not something anyone searches for */
+#define MAX_TERM_LEN 64
+
+struct _SearchIndex {
+  /* term -> (EditorPage -> GArray of guint32 positions) */
+  GHashTable *terms;
+  /* EditorPage -> GPtrArray of the terms it is posted under */
+  GHashTable *pages;
+};
+
+static gboolean
+is_word_char(gunichar c)
+{
+  return g_unichar_isalnum(c) || c == '_';
+}
+
+typedef void (*token_fn)(const gchar *term, guint32 pos, gpointer user_data);
+
+static void
+tokenize(const gchar *text, gssize len, token_fn fn, gpointer user_data)
+{
+  const gchar *end;
+  const gchar *iter;
+  GString *term = g_string_new("");
+  guint32 pos = 0;
+
+  if (len < 0) {
+    len = strlen(text);
+  }
+  end = text + len;
+
+  for (iter = text; iter <= end; iter = g_utf8_next_char(iter)) {
+    gunichar c = iter < end ? g_utf8_get_char(iter) : 0;
+
+    if (iter < end && is_word_char(c)) {
+      g_string_append_unichar(term, g_unichar_tolower(c));
+      continue;
+    }
+
+    if (term->len > 0 && term->len <= MAX_TERM_LEN) {
+      fn(term->str, pos++, user_data);
+    }
+    g_string_truncate(term, 0);
+
+    if (iter == end) {
+      break;
+    }
+  }
+
+  g_string_free(term, TRUE);
+}
+
+static void
+add_doc_term(const gchar *term, guint32 pos, gpointer user_data)
+{
+  GHashTable *terms = (GHashTable *) user_data;
+  GArray *positions;
+
+  positions = g_hash_table_lookup(terms, term);
+  if (positions == NULL) {
+    positions = g_array_new(FALSE, FALSE, sizeof(guint32));
+    g_hash_table_insert(terms, g_strdup(term), positions);
+  }
+
+  g_array_append_val(positions, pos);
+}
+
+SearchDoc *
+search_doc_new(const gchar *text, gssize len)
+{
+  SearchDoc *doc;
+
+  g_return_val_if_fail(text != NULL, NULL);
+
+  doc = g_malloc0(sizeof(*doc));
+  doc->terms = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                     (GDestroyNotify) g_array_unref);
+
+  tokenize(text, len, add_doc_term, doc->terms);
+
+  return doc;
+}
+
+void
+search_doc_free(SearchDoc *doc)
+{
+  if (doc == NULL) {
+    return;
+  }
+
+  g_hash_table_unref(doc->terms);
+  g_free(doc);
+}
+
+static void
+add_query_term(const gchar *term, G_GNUC_UNUSED guint32 pos, gpointer user_data)
+{
+  GStrvBuilder *builder = (GStrvBuilder *) user_data;
+
+  g_strv_builder_add(builder, term);
+}
+
+/* Split a query into the same terms that are indexed */
+gchar **
+search_tokenize(const gchar *text)
+{
+  GStrvBuilder *builder = g_strv_builder_new();
+  gchar **res;
+
+  tokenize(text, -1, add_query_term, builder);
+
+  res = g_strv_builder_end(builder);
+  g_strv_builder_unref(builder);
+
+  return res;
+}
+
+SearchIndex *
+search_index_new(void)
+{
+  SearchIndex *self = g_malloc0(sizeof(*self));
+
+  self->terms = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                      (GDestroyNotify) g_hash_table_unref);
+  self->pages = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                      g_object_unref,
+                                      (GDestroyNotify) g_ptr_array_unref);
+
+  return self;
+}
+
+void
+search_index_free(SearchIndex *self)
+{
+  if (self == NULL) {
+    return;
+  }
+
+  g_hash_table_unref(self->terms);
+  g_hash_table_unref(self->pages);
+  g_free(self);
+}
+
+gboolean
+search_index_has_page(SearchIndex *self, EditorPage *page)
+{
+  g_return_val_if_fail(self != NULL, FALSE);
+
+  return g_hash_table_contains(self->pages, page);
+}
+
+void
+search_index_remove_page(SearchIndex *self, EditorPage *page)
+{
+  GPtrArray *page_terms;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+
+  page_terms = g_hash_table_lookup(self->pages, page);
+  if (page_terms == NULL) {
+    return;
+  }
+
+  for (guint i = 0; i < page_terms->len; i++) {
+    const gchar *term = page_terms->pdata[i];
+    GHashTable *postings = g_hash_table_lookup(self->terms, term);
+
+    g_hash_table_remove(postings, page);
+    if (g_hash_table_size(postings) == 0) {
+      g_hash_table_remove(self->terms, term);
+    }
+  }
+
+  g_hash_table_remove(self->pages, page);
+}
+
+/* Replaces whatever the page was indexed with before, takes the doc */
+void
+search_index_set_page(SearchIndex *self, EditorPage *page, SearchDoc *doc)
+{
+  GHashTableIter iter;
+  GPtrArray *page_terms;
+  gchar *term;
+  GArray *positions;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+  g_return_if_fail(doc != NULL);
+
+  search_index_remove_page(self, page);
+
+  page_terms = g_ptr_array_new();
+
+  g_hash_table_iter_init(&iter, doc->terms);
+  while (g_hash_table_iter_next(&iter, (gpointer *) &term,
+                                (gpointer *) &positions)) {
+    GHashTable *postings;
+    gchar *key;
+
+    if (!g_hash_table_lookup_extended(self->terms, term, (gpointer *) &key,
+                                      (gpointer *) &postings)) {
+      key = g_strdup(term);
+      postings = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                       (GDestroyNotify) g_array_unref);
+      g_hash_table_insert(self->terms, key, postings);
+    }
+
+    /* Ownership of the positions moves to the index */
+    g_hash_table_iter_steal(&iter);
+    g_free(term);
+    g_hash_table_insert(postings, page, positions);
+    g_ptr_array_add(page_terms, key);
+  }
+
+  g_hash_table_insert(self->pages, g_object_ref(page), page_terms);
+  search_doc_free(doc);
+}
+
+static gint
+posting_size_cmp(gconstpointer a, gconstpointer b)
+{
+  guint sa = g_hash_table_size(*((GHashTable **) a));
+  guint sb = g_hash_table_size(*((GHashTable **) b));
+
+  return (sa > sb) - (sa < sb);
+}
+
+static gint
+result_cmp(gconstpointer a, gconstpointer b)
+{
+  const SearchResult *ra = a;
+  const SearchResult *rb = b;
+
+  if (ra->hits != rb->hits) {
+    return ra->hits > rb->hits ? -1 : 1;
+  }
+
+  return editor_page_cmp(ra->page, rb->page);
+}
+
+/* Most hits first, ties by heading */
+void
+search_results_sort(GArray *results)
+{
+  g_return_if_fail(results != NULL);
+
+  g_array_sort(results, result_cmp);
+}
+
+/* Pages containing every term of the query, most hits first */
+GArray *
+search_index_query(SearchIndex *self, const gchar *query)
+{
+  GArray *res = g_array_new(FALSE, FALSE, sizeof(SearchResult));
+  GPtrArray *lists;
+  GHashTableIter iter;
+  EditorPage *page;
+  GArray *positions;
+  gchar **terms;
+
+  g_return_val_if_fail(self != NULL, res);
+  g_return_val_if_fail(query != NULL, res);
+
+  terms = search_tokenize(query);
+  lists = g_ptr_array_new();
+
+  for (guint i = 0; terms[i] != NULL; i++) {
+    GHashTable *postings = g_hash_table_lookup(self->terms, terms[i]);
+
+    if (postings == NULL) {
+      /* Nothing can contain all the terms */
+      goto out;
+    }
+    g_ptr_array_add(lists, postings);
+  }
+
+  if (lists->len == 0) {
+    goto out;
+  }
+
+  /* Walk the rarest term and look the page up in the others */
+  g_ptr_array_sort(lists, posting_size_cmp);
+
+  g_hash_table_iter_init(&iter, lists->pdata[0]);
+  while (g_hash_table_iter_next(&iter, (gpointer *) &page,
+                                (gpointer *) &positions)) {
+    SearchResult result = { page, positions->len };
+    guint i;
+
+    for (i = 1; i < lists->len; i++) {
+      GArray *other = g_hash_table_lookup(lists->pdata[i], page);
+
+      if (other == NULL) {
+        break;
+      }
+      result.hits += other->len;
+    }
+
+    if (i == lists->len) {
+      g_array_append_val(res, result);
+    }
+  }
+
+  search_results_sort(res);
+
+out:
+  g_ptr_array_unref(lists);
+  g_strfreev(terms);
+  return res;
+}
+
+guint
+search_index_n_terms(SearchIndex *self)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  return g_hash_table_size(self->terms);
+}
+
+/* Number of pages the term is in, takes a term as search_tokenize() makes
+ * them */
+guint
+search_index_term_pages(SearchIndex *self, const gchar *term)
+{
+  GHashTable *postings;
+
+  g_return_val_if_fail(self != NULL, 0);
+  g_return_val_if_fail(term != NULL, 0);
+
+  postings = g_hash_table_lookup(self->terms, term);
+
+  return postings != NULL ? g_hash_table_size(postings) : 0;
+}
+
+/* Times the term is in the page, 0 when it is not */
+guint
+search_index_term_hits(SearchIndex *self, EditorPage *page, const gchar *term)
+{
+  GHashTable *postings;
+  GArray *positions;
+
+  g_return_val_if_fail(self != NULL, 0);
+  g_return_val_if_fail(page != NULL, 0);
+  g_return_val_if_fail(term != NULL, 0);
+
+  postings = g_hash_table_lookup(self->terms, term);
+  if (postings == NULL) {
+    return 0;
+  }
+
+  positions = g_hash_table_lookup(postings, page);
+
+  return positions != NULL ? positions->len : 0;
+}
+
+/* Every term the page is posted under, with its positions in the page */
+void
+search_index_page_foreach(SearchIndex *self,
+                          EditorPage *page,
+                          SearchTermFunc fn,
+                          gpointer user_data)
+{
+  GPtrArray *page_terms;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+  g_return_if_fail(fn != NULL);
+
+  page_terms = g_hash_table_lookup(self->pages, page);
+  if (page_terms == NULL) {
+    return;
+  }
+
+  for (guint i = 0; i < page_terms->len; i++) {
+    const gchar *term = page_terms->pdata[i];
+    GHashTable *postings = g_hash_table_lookup(self->terms, term);
+
+    fn(term, g_hash_table_lookup(postings, page), user_data);
+  }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glib.h>
+
+#include "editor_page.h"
+
+G_BEGIN_DECLS
+
+typedef struct _SearchIndex SearchIndex;
+
+/* Terms of one text, term -> GArray of guint32 word positions. Built without
+ * touching any page, so it can be done in a worker thread. */
+typedef struct {
+  GHashTable *terms;
+} SearchDoc;
+
+typedef struct {
+  EditorPage *page;
+  guint hits;
+} SearchResult;
+
+typedef void (*SearchTermFunc)(const gchar *term,
+                               GArray *positions,
+                               gpointer user_data);
+
+SearchDoc *search_doc_new(const gchar *text, gssize len);
+
+void search_doc_free(SearchDoc *doc);
+
+gchar **search_tokenize(const gchar *text);
+
+SearchIndex *search_index_new(void);
+
+void search_index_free(SearchIndex *self);
+
+gboolean search_index_has_page(SearchIndex *self, EditorPage *page);
+
+void search_index_set_page(SearchIndex *self, EditorPage *page, SearchDoc *doc);
+
+void search_index_remove_page(SearchIndex *self, EditorPage *page);
+
+GArray *search_index_query(SearchIndex *self, const gchar *query);
+
+void search_results_sort(GArray *results);
+
+guint search_index_n_terms(SearchIndex *self);
+
+guint search_index_term_pages(SearchIndex *self, const gchar *term);
+
+guint search_index_term_hits(SearchIndex *self,
+                             EditorPage *page,
+                             const gchar *term);
+
+void search_index_page_foreach(SearchIndex *self,
+                               EditorPage *page,
+                               SearchTermFunc fn,
+                               gpointer user_data);
+
+G_END_DECLS
@@ -6,18 +6,17 @@ GtkWidget *
 get_framed_content(GtkWidget *menu, GtkWidget *content)
 {
   GtkWidget *flap;
-  GtkWidget *scroll;
 
   g_return_val_if_fail(menu != NULL, NULL);
   g_return_val_if_fail(content != NULL, NULL);
 
-  scroll = gtk_scrolled_window_new();
-  gtk_scrolled_window_set_min_content_width(GTK_SCROLLED_WINDOW(scroll), 250);
+  /* The menu scrolls its own lists, a list view only creates the rows in
+   * view when it gets a scrolled window of its own */
+  gtk_widget_set_size_request(menu, 250, -1);
 
   flap = adw_flap_new();
 
-  gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scroll), menu);
-  adw_flap_set_flap(ADW_FLAP(flap), scroll);
+  adw_flap_set_flap(ADW_FLAP(flap), menu);
   adw_flap_set_content(ADW_FLAP(flap), content);
 
   return flap;
@@ -0,0 +1,662 @@
+#include <glib.h>
+#include <string.h>
+
+#include "editor_page.h"
+#include "tag_index.h"
+
+/* Which pages have which tags, as one bitset of page ids per tag. Pages and
+ * tags get dense ids the first time they are seen, so a filter like
+ * "work and not done" is a few passes of 64 bit and/or/not over arrays
+ * of n_pages / 64 words, whatever the number of pages per tag. */
+
+#define WORD_BITS 64
+
+typedef struct {
+  guint64 *words;
+  guint n_words;
+} Bitset;
+
+struct _TagIndex {
+  /* EditorPage -> id + 1, and back */
+  GHashTable *page_ids;
+  GPtrArray *pages;
+  /* Ids of pages that were removed, reused before new ones */
+  GArray *free_ids;
+  /* tag name -> id + 1, and id -> Bitset */
+  GHashTable *tag_ids;
+  GPtrArray *tags;
+  /* Page id -> GArray of the tag ids it is set in */
+  GPtrArray *page_tags;
+  /* Pages with draft: true in their front matter */
+  Bitset *drafts;
+};
+
+G_DEFINE_QUARK(tag-index-error-quark, tag_index_error)
+
+static Bitset *
+bitset_new(guint n_words)
+{
+  Bitset *set = g_malloc(sizeof(*set));
+
+  set->n_words = n_words;
+  set->words = g_malloc0(MAX(n_words, 1) * sizeof(guint64));
+
+  return set;
+}
+
+static void
+bitset_free(Bitset *set)
+{
+  g_free(set->words);
+  g_free(set);
+}
+
+static void
+bitset_grow(Bitset *set, guint n_words)
+{
+  if (n_words <= set->n_words) {
+    return;
+  }
+
+  set->words = g_realloc(set->words, n_words * sizeof(guint64));
+  memset(set->words + set->n_words, 0,
+         (n_words - set->n_words) * sizeof(guint64));
+  set->n_words = n_words;
+}
+
+static inline gboolean
+bitset_get(const Bitset *set, guint bit)
+{
+  if (bit / WORD_BITS >= set->n_words) {
+    return FALSE;
+  }
+
+  return (set->words[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1;
+}
+
+static guint
+bitset_count(const Bitset *set)
+{
+  guint res = 0;
+
+  for (guint i = 0; i < set->n_words; i++) {
+    res += __builtin_popcountll(set->words[i]);
+  }
+
+  return res;
+}
+
+static inline void
+bitset_set(Bitset *set, guint bit, gboolean value)
+{
+  guint64 mask = G_GUINT64_CONSTANT(1) << (bit % WORD_BITS);
+
+  bitset_grow(set, bit / WORD_BITS + 1);
+
+  if (value) {
+    set->words[bit / WORD_BITS] |= mask;
+  } else {
+    set->words[bit / WORD_BITS] &= ~mask;
+  }
+}
+
+TagIndex *
+tag_index_new(void)
+{
+  TagIndex *self = g_malloc0(sizeof(*self));
+
+  self->page_ids = g_hash_table_new(g_direct_hash, g_direct_equal);
+  self->pages = g_ptr_array_new();
+  self->free_ids = g_array_new(FALSE, FALSE, sizeof(guint));
+  self->tag_ids = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                        (GDestroyNotify) g_ref_string_release,
+                                        NULL);
+  self->tags = g_ptr_array_new_with_free_func((GDestroyNotify) bitset_free);
+  self->page_tags = g_ptr_array_new_with_free_func(
+    (GDestroyNotify) g_array_unref);
+  self->drafts = bitset_new(0);
+
+  return self;
+}
+
+void
+tag_index_free(TagIndex *self)
+{
+  if (self == NULL) {
+    return;
+  }
+
+  g_hash_table_unref(self->page_ids);
+  g_ptr_array_unref(self->pages);
+  g_array_unref(self->free_ids);
+  g_hash_table_unref(self->tag_ids);
+  g_ptr_array_unref(self->tags);
+  g_ptr_array_unref(self->page_tags);
+  bitset_free(self->drafts);
+  g_free(self);
+}
+
+static guint
+page_id(TagIndex *self, EditorPage *page)
+{
+  gpointer id;
+  guint res;
+
+  id = g_hash_table_lookup(self->page_ids, page);
+  if (id != NULL) {
+    return GPOINTER_TO_UINT(id) - 1;
+  }
+
+  if (self->free_ids->len > 0) {
+    res = g_array_index(self->free_ids, guint, self->free_ids->len - 1);
+    g_array_set_size(self->free_ids, self->free_ids->len - 1);
+    self->pages->pdata[res] = page;
+  } else {
+    res = self->pages->len;
+    g_ptr_array_add(self->pages, page);
+    g_ptr_array_add(self->page_tags, g_array_new(FALSE, FALSE, sizeof(guint)));
+  }
+
+  g_hash_table_insert(self->page_ids, page, GUINT_TO_POINTER(res + 1));
+  return res;
+}
+
+static guint
+tag_id(TagIndex *self, const gchar *name)
+{
+  gpointer id;
+
+  id = g_hash_table_lookup(self->tag_ids, name);
+  if (id != NULL) {
+    return GPOINTER_TO_UINT(id) - 1;
+  }
+
+  g_ptr_array_add(self->tags, bitset_new(0));
+  g_hash_table_insert(self->tag_ids, g_ref_string_new_intern(name),
+                      GUINT_TO_POINTER(self->tags->len));
+
+  return self->tags->len - 1;
+}
+
+static void
+clear_page_bits(TagIndex *self, guint id)
+{
+  GArray *tags = self->page_tags->pdata[id];
+
+  for (guint i = 0; i < tags->len; i++) {
+    bitset_set(self->tags->pdata[g_array_index(tags, guint, i)], id, FALSE);
+  }
+  g_array_set_size(tags, 0);
+}
+
+/* Replaces the tags the page had before */
+void
+tag_index_set_page_tags(TagIndex *self, EditorPage *page, GPtrArray *tags)
+{
+  GArray *page_tags;
+  guint id;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+  g_return_if_fail(tags != NULL);
+
+  id = page_id(self, page);
+  clear_page_bits(self, id);
+  page_tags = self->page_tags->pdata[id];
+
+  for (guint i = 0; i < tags->len; i++) {
+    guint tag = tag_id(self, tags->pdata[i]);
+
+    bitset_set(self->tags->pdata[tag], id, TRUE);
+    g_array_append_val(page_tags, tag);
+  }
+}
+
+/* Adds or removes one tag of the page, the others are left alone */
+void
+tag_index_set_page_tag(TagIndex *self,
+                       EditorPage *page,
+                       const gchar *tag,
+                       gboolean tagged)
+{
+  GArray *page_tags;
+  guint id;
+  guint tid;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+  g_return_if_fail(tag != NULL);
+
+  id = page_id(self, page);
+  tid = tag_id(self, tag);
+
+  if (bitset_get(self->tags->pdata[tid], id) == tagged) {
+    return;
+  }
+
+  bitset_set(self->tags->pdata[tid], id, tagged);
+  page_tags = self->page_tags->pdata[id];
+
+  if (tagged) {
+    g_array_append_val(page_tags, tid);
+    return;
+  }
+
+  for (guint i = 0; i < page_tags->len; i++) {
+    if (g_array_index(page_tags, guint, i) == tid) {
+      g_array_remove_index_fast(page_tags, i);
+      break;
+    }
+  }
+}
+
+void
+tag_index_remove_page(TagIndex *self, EditorPage *page)
+{
+  gpointer id;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+
+  id = g_hash_table_lookup(self->page_ids, page);
+  if (id == NULL) {
+    return;
+  }
+
+  clear_page_bits(self, GPOINTER_TO_UINT(id) - 1);
+  bitset_set(self->drafts, GPOINTER_TO_UINT(id) - 1, FALSE);
+  self->pages->pdata[GPOINTER_TO_UINT(id) - 1] = NULL;
+  g_array_append_val(self->free_ids, GPOINTER_TO_UINT(id) - 1);
+  g_hash_table_remove(self->page_ids, page);
+}
+
+static GPtrArray *
+bitset_pages(TagIndex *self, const Bitset *set)
+{
+  GPtrArray *res = g_ptr_array_new();
+
+  for (guint w = 0; w < set->n_words; w++) {
+    guint64 word = set->words[w];
+
+    while (word != 0) {
+      guint id = w * WORD_BITS + __builtin_ctzll(word);
+
+      /* "not" also sets the unused and freed ids */
+      if (id < self->pages->len && self->pages->pdata[id] != NULL) {
+        g_ptr_array_add(res, self->pages->pdata[id]);
+      }
+      word &= word - 1;
+    }
+  }
+
+  return res;
+}
+
+void
+tag_index_set_page_draft(TagIndex *self, EditorPage *page, gboolean draft)
+{
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+
+  bitset_set(self->drafts, page_id(self, page), draft);
+}
+
+static const Bitset *
+lookup_tag(TagIndex *self, const gchar *tag)
+{
+  gpointer id = g_hash_table_lookup(self->tag_ids, tag);
+
+  return id != NULL ? self->tags->pdata[GPOINTER_TO_UINT(id) - 1] : NULL;
+}
+
+static guint
+lookup_page(TagIndex *self, EditorPage *page)
+{
+  return GPOINTER_TO_UINT(g_hash_table_lookup(self->page_ids, page));
+}
+
+gboolean
+tag_index_has_tag(TagIndex *self, EditorPage *page, const gchar *tag)
+{
+  const Bitset *set;
+  guint id;
+
+  g_return_val_if_fail(self != NULL, FALSE);
+  g_return_val_if_fail(page != NULL, FALSE);
+  g_return_val_if_fail(tag != NULL, FALSE);
+
+  set = lookup_tag(self, tag);
+  id = lookup_page(self, page);
+
+  return set != NULL && id != 0 && bitset_get(set, id - 1);
+}
+
+gboolean
+tag_index_is_draft(TagIndex *self, EditorPage *page)
+{
+  guint id;
+
+  g_return_val_if_fail(self != NULL, FALSE);
+  g_return_val_if_fail(page != NULL, FALSE);
+
+  id = lookup_page(self, page);
+
+  return id != 0 && bitset_get(self->drafts, id - 1);
+}
+
+/* Number of pages with the tag */
+guint
+tag_index_count(TagIndex *self, const gchar *tag)
+{
+  const Bitset *set;
+
+  g_return_val_if_fail(self != NULL, 0);
+  g_return_val_if_fail(tag != NULL, 0);
+
+  set = lookup_tag(self, tag);
+
+  return set != NULL ? bitset_count(set) : 0;
+}
+
+guint
+tag_index_n_drafts(TagIndex *self)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  return bitset_count(self->drafts);
+}
+
+/* Pages with the tag, in no particular order */
+GPtrArray *
+tag_index_tagged(TagIndex *self, const gchar *tag)
+{
+  const Bitset *set;
+
+  g_return_val_if_fail(self != NULL, NULL);
+  g_return_val_if_fail(tag != NULL, NULL);
+
+  set = lookup_tag(self, tag);
+  if (set == NULL) {
+    return g_ptr_array_new();
+  }
+
+  return bitset_pages(self, set);
+}
+
+GPtrArray *
+tag_index_drafts(TagIndex *self)
+{
+  g_return_val_if_fail(self != NULL, NULL);
+
+  return bitset_pages(self, self->drafts);
+}
+
+/* Every page the index knows about */
+GPtrArray *
+tag_index_pages(TagIndex *self)
+{
+  GPtrArray *res;
+
+  g_return_val_if_fail(self != NULL, NULL);
+
+  res = g_ptr_array_sized_new(g_hash_table_size(self->page_ids));
+
+  for (guint i = 0; i < self->pages->len; i++) {
+    if (self->pages->pdata[i] != NULL) {
+      g_ptr_array_add(res, self->pages->pdata[i]);
+    }
+  }
+
+  return res;
+}
+
+guint
+tag_index_n_tags(TagIndex *self)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  return self->tags->len;
+}
+
+guint
+tag_index_n_pages(TagIndex *self)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  return g_hash_table_size(self->page_ids);
+}
+
+/*
+ * Filter expressions
+ *
+ *   expr   := term ("or" term)*
+ *   term   := factor ("and"? factor)*
+ *   factor := "not" factor | "(" expr ")" | tag
+ *
+ * "|", "&" and "!" or "-" work too. A tag is a word, or anything between
+ * double quotes for tags with spaces. Tags nobody has match no page.
+ */
+
+struct parser {
+  TagIndex *index;
+  const gchar *pos;
+  guint n_words;
+  GError *error;
+};
+
+static void
+skip_space(struct parser *p)
+{
+  while (g_ascii_isspace(*p->pos)) {
+    p->pos++;
+  }
+}
+
+static gboolean
+is_word_end(gchar c)
+{
+  return c == '\0' || g_ascii_isspace(c) || c == '(' || c == ')' ||
+         c == '&' || c == '|';
+}
+
+/* Consumes the keyword if it is the next word */
+static gboolean
+accept_word(struct parser *p, const gchar *word, const gchar *symbol)
+{
+  gsize len = strlen(word);
+
+  skip_space(p);
+
+  if (symbol != NULL && *p->pos != '\0' && strchr(symbol, *p->pos) != NULL) {
+    p->pos++;
+    return TRUE;
+  }
+
+  if (g_ascii_strncasecmp(p->pos, word, len) == 0 && is_word_end(p->pos[len])) {
+    p->pos += len;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+static Bitset *parse_expr(struct parser *p);
+
+static Bitset *
+tag_bits(struct parser *p, const gchar *name)
+{
+  Bitset *res = bitset_new(p->n_words);
+  gpointer id;
+
+  id = g_hash_table_lookup(p->index->tag_ids, name);
+  if (id != NULL) {
+    Bitset *tag = p->index->tags->pdata[GPOINTER_TO_UINT(id) - 1];
+
+    memcpy(res->words, tag->words,
+           MIN(tag->n_words, p->n_words) * sizeof(guint64));
+  }
+
+  return res;
+}
+
+static Bitset *
+parse_factor(struct parser *p)
+{
+  const gchar *start;
+  gchar *name;
+  Bitset *res;
+
+  if (accept_word(p, "not", "!-")) {
+    res = parse_factor(p);
+    if (res != NULL) {
+      for (guint i = 0; i < res->n_words; i++) {
+        res->words[i] = ~res->words[i];
+      }
+    }
+    return res;
+  }
+
+  skip_space(p);
+
+  if (*p->pos == '(') {
+    p->pos++;
+    res = parse_expr(p);
+    skip_space(p);
+    if (res != NULL && *p->pos != ')') {
+      g_set_error(&p->error, TAG_INDEX_ERROR, TAG_INDEX_ERROR_SYNTAX,
+                  "Missing \")\"");
+      g_clear_pointer(&res, bitset_free);
+    } else if (res != NULL) {
+      p->pos++;
+    }
+    return res;
+  }
+
+  if (*p->pos == '"') {
+    start = ++p->pos;
+    while (*p->pos != '"' && *p->pos != '\0') {
+      p->pos++;
+    }
+    if (*p->pos == '\0') {
+      g_set_error(&p->error, TAG_INDEX_ERROR, TAG_INDEX_ERROR_SYNTAX,
+                  "Missing closing quote");
+      return NULL;
+    }
+    name = g_strndup(start, p->pos - start);
+    p->pos++;
+  } else {
+    start = p->pos;
+    while (!is_word_end(*p->pos)) {
+      p->pos++;
+    }
+    if (p->pos == start) {
+      g_set_error(&p->error, TAG_INDEX_ERROR, TAG_INDEX_ERROR_SYNTAX,
+                  "Expected a tag at \"%s\"", start);
+      return NULL;
+    }
+    name = g_strndup(start, p->pos - start);
+  }
+
+  res = tag_bits(p, name);
+  g_free(name);
+
+  return res;
+}
+
+static gboolean
+at_term_end(struct parser *p)
+{
+  const gchar *pos;
+
+  skip_space(p);
+  pos = p->pos;
+
+  if (*pos == '\0' || *pos == ')' || *pos == '|') {
+    return TRUE;
+  }
+
+  return g_ascii_strncasecmp(pos, "or", 2) == 0 && is_word_end(pos[2]);
+}
+
+static Bitset *
+parse_term(struct parser *p)
+{
+  Bitset *res = parse_factor(p);
+
+  while (res != NULL && !at_term_end(p)) {
+    Bitset *other;
+
+    /* "and" is optional, "a b" is "a and b" */
+    accept_word(p, "and", "&");
+
+    other = parse_factor(p);
+    if (other == NULL) {
+      g_clear_pointer(&res, bitset_free);
+      break;
+    }
+
+    for (guint i = 0; i < res->n_words; i++) {
+      res->words[i] &= other->words[i];
+    }
+    bitset_free(other);
+  }
+
+  return res;
+}
+
+static Bitset *
+parse_expr(struct parser *p)
+{
+  Bitset *res = parse_term(p);
+
+  while (res != NULL && accept_word(p, "or", "|")) {
+    Bitset *other = parse_term(p);
+
+    if (other == NULL) {
+      g_clear_pointer(&res, bitset_free);
+      break;
+    }
+
+    for (guint i = 0; i < res->n_words; i++) {
+      res->words[i] |= other->words[i];
+    }
+    bitset_free(other);
+  }
+
+  return res;
+}
+
+/* Pages matching a tag expression, in no particular order */
+GPtrArray *
+tag_index_filter(TagIndex *self, const gchar *expr, GError **error)
+{
+  struct parser p = { 0 };
+  GPtrArray *res;
+  Bitset *set;
+
+  g_return_val_if_fail(self != NULL, NULL);
+  g_return_val_if_fail(expr != NULL, NULL);
+
+  p.index = self;
+  p.pos = expr;
+  p.n_words = (self->pages->len + WORD_BITS - 1) / WORD_BITS;
+
+  set = parse_expr(&p);
+  skip_space(&p);
+
+  if (set != NULL && *p.pos != '\0') {
+    g_set_error(&p.error, TAG_INDEX_ERROR, TAG_INDEX_ERROR_SYNTAX,
+                "Unexpected \"%s\"", p.pos);
+    g_clear_pointer(&set, bitset_free);
+  }
+
+  if (set == NULL) {
+    g_propagate_error(error, p.error);
+    return NULL;
+  }
+
+  res = bitset_pages(self, set);
+  bitset_free(set);
+
+  return res;
+}
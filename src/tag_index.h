@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glib.h>
+
+#include "editor_page.h"
+
+G_BEGIN_DECLS
+
+#define TAG_INDEX_ERROR tag_index_error_quark()
+
+typedef enum {
+  TAG_INDEX_ERROR_SYNTAX,
+} TagIndexError;
+
+typedef struct _TagIndex TagIndex;
+
+GQuark tag_index_error_quark(void);
+
+TagIndex *tag_index_new(void);
+
+void tag_index_free(TagIndex *self);
+
+void tag_index_set_page_tags(TagIndex *self,
+                             EditorPage *page,
+                             GPtrArray *tags);
+
+void tag_index_set_page_tag(TagIndex *self,
+                            EditorPage *page,
+                            const gchar *tag,
+                            gboolean tagged);
+
+void tag_index_set_page_draft(TagIndex *self,
+                              EditorPage *page,
+                              gboolean draft);
+
+void tag_index_remove_page(TagIndex *self, EditorPage *page);
+
+gboolean tag_index_has_tag(TagIndex *self,
+                           EditorPage *page,
+                           const gchar *tag);
+
+gboolean tag_index_is_draft(TagIndex *self, EditorPage *page);
+
+guint tag_index_count(TagIndex *self, const gchar *tag);
+
+guint tag_index_n_drafts(TagIndex *self);
+
+GPtrArray *tag_index_tagged(TagIndex *self, const gchar *tag);
+
+GPtrArray *tag_index_drafts(TagIndex *self);
+
+GPtrArray *tag_index_pages(TagIndex *self);
+
+guint tag_index_n_tags(TagIndex *self);
+
+guint tag_index_n_pages(TagIndex *self);
+
+GPtrArray *tag_index_filter(TagIndex *self, const gchar *expr, GError **error);
+
+G_END_DECLS
@@ -0,0 +1,83 @@
+#include <glib.h>
+#include <string.h>
+
+#include "text_search.h"
+
+/* Boyer-Moore-Horspool over UTF-8 bytes. A match of valid UTF-8 in valid
+ * UTF-8 always starts at a character boundary, so byte search is enough.
+ * Ignoring case only folds ASCII, the bytes of other characters have to
+ * match exactly. */
+
+static void
+build_fold(guchar fold[256], gboolean match_case)
+{
+  for (guint c = 0; c < 256; c++) {
+    fold[c] = match_case ? c : g_ascii_tolower(c);
+  }
+}
+
+/* Byte offsets of the matches as gsize, left to right and not
+ * overlapping */
+GArray *
+text_search_find_all(const gchar *haystack,
+                     gsize len,
+                     const gchar *needle,
+                     gboolean match_case)
+{
+  GArray *res = g_array_new(FALSE, FALSE, sizeof(gsize));
+  const guchar *text = (const guchar *) haystack;
+  guchar fold[256];
+  guchar *pattern;
+  gsize skip[256];
+  gsize n;
+  gsize pos = 0;
+
+  g_return_val_if_fail(haystack != NULL, res);
+  g_return_val_if_fail(needle != NULL, res);
+
+  n = strlen(needle);
+  if (n == 0 || n > len) {
+    return res;
+  }
+
+  build_fold(fold, match_case);
+
+  pattern = g_malloc(n);
+  for (gsize i = 0; i < n; i++) {
+    pattern[i] = fold[(guchar) needle[i]];
+  }
+
+  /* How far the window can move when its last byte is c */
+  for (guint c = 0; c < 256; c++) {
+    skip[c] = n;
+  }
+  for (gsize i = 0; i + 1 < n; i++) {
+    skip[pattern[i]] = n - 1 - i;
+  }
+  if (!match_case) {
+    for (guint c = 'A'; c <= 'Z'; c++) {
+      skip[c] = skip[g_ascii_tolower(c)];
+    }
+  }
+
+  while (pos + n <= len) {
+    guchar last = fold[text[pos + n - 1]];
+    gsize i;
+
+    if (last == pattern[n - 1]) {
+      for (i = 0; i + 1 < n && fold[text[pos + i]] == pattern[i]; i++) {
+      }
+
+      if (i + 1 >= n) {
+        g_array_append_val(res, pos);
+        pos += n;
+        continue;
+      }
+    }
+
+    pos += skip[text[pos + n - 1]];
+  }
+
+  g_free(pattern);
+  return res;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+GArray *text_search_find_all(const gchar *haystack,
+                             gsize len,
+                             const gchar *needle,
+                             gboolean match_case);
+
+G_END_DECLS
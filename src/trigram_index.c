@@ -0,0 +1,385 @@
+#include <glib.h>
+#include <string.h>
+
+#include "editor_page.h"
+#include "search_index.h"
+#include "trigram_index.h"
+
+/* Substring search over the raw page text, so identifiers, paths and code
+ * that the word index splits apart can be found as typed. Text is folded
+ * with g_ascii_tolower() only, that keeps byte offsets stable and the
+ * folded query can be compared with memcmp(). Only the trigrams are kept,
+ * candidates are checked against the text of the page when a query runs. */
+
+struct _TrigramIndex {
+  /* trigram -> set of EditorPage */
+  GHashTable *postings;
+  /* EditorPage -> TrigramDoc it was indexed with */
+  GHashTable *pages;
+  TrigramTextFunc text_func;
+  gpointer user_data;
+};
+
+/* Folded on the fly, the text does not need a lowercase copy */
+static inline guint32
+trigram_at(const gchar *text)
+{
+  return ((guint32) (guchar) g_ascii_tolower(text[0]) << 16) |
+         ((guint32) (guchar) g_ascii_tolower(text[1]) << 8) |
+         (guint32) (guchar) g_ascii_tolower(text[2]);
+}
+
+static gint
+trigram_cmp(gconstpointer a, gconstpointer b)
+{
+  guint32 ta = *((const guint32 *) a);
+  guint32 tb = *((const guint32 *) b);
+
+  return (ta > tb) - (ta < tb);
+}
+
+/* Sorted and without duplicates */
+static GArray *
+collect_trigrams(const gchar *text, gsize len)
+{
+  GArray *res = g_array_new(FALSE, FALSE, sizeof(guint32));
+  guint out = 0;
+
+  if (len < 3) {
+    return res;
+  }
+
+  g_array_set_size(res, len - 2);
+  for (gsize i = 0; i + 2 < len; i++) {
+    g_array_index(res, guint32, i) = trigram_at(text + i);
+  }
+
+  g_array_sort(res, trigram_cmp);
+
+  for (guint i = 0; i < res->len; i++) {
+    if (out == 0 || g_array_index(res, guint32, i) !=
+                      g_array_index(res, guint32, out - 1)) {
+      g_array_index(res, guint32, out++) = g_array_index(res, guint32, i);
+    }
+  }
+  g_array_set_size(res, out);
+
+  return res;
+}
+
+TrigramDoc *
+trigram_doc_new(const gchar *text, gssize len)
+{
+  TrigramDoc *doc;
+
+  g_return_val_if_fail(text != NULL, NULL);
+
+  if (len < 0) {
+    len = strlen(text);
+  }
+
+  doc = g_malloc0(sizeof(*doc));
+  doc->trigrams = collect_trigrams(text, len);
+
+  return doc;
+}
+
+void
+trigram_doc_free(TrigramDoc *doc)
+{
+  if (doc == NULL) {
+    return;
+  }
+
+  g_array_unref(doc->trigrams);
+  g_free(doc);
+}
+
+TrigramIndex *
+trigram_index_new(TrigramTextFunc text_func, gpointer user_data)
+{
+  TrigramIndex *self;
+
+  g_return_val_if_fail(text_func != NULL, NULL);
+
+  self = g_malloc0(sizeof(*self));
+  self->text_func = text_func;
+  self->user_data = user_data;
+
+  self->postings = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                         (GDestroyNotify) g_hash_table_unref);
+  self->pages = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                      g_object_unref,
+                                      (GDestroyNotify) trigram_doc_free);
+
+  return self;
+}
+
+void
+trigram_index_free(TrigramIndex *self)
+{
+  if (self == NULL) {
+    return;
+  }
+
+  g_hash_table_unref(self->postings);
+  g_hash_table_unref(self->pages);
+  g_free(self);
+}
+
+gboolean
+trigram_index_has_page(TrigramIndex *self, EditorPage *page)
+{
+  g_return_val_if_fail(self != NULL, FALSE);
+
+  return g_hash_table_contains(self->pages, page);
+}
+
+/* Sorted, NULL when the page is not indexed */
+const GArray *
+trigram_index_get_trigrams(TrigramIndex *self, EditorPage *page)
+{
+  TrigramDoc *doc;
+
+  g_return_val_if_fail(self != NULL, NULL);
+
+  doc = g_hash_table_lookup(self->pages, page);
+
+  return doc != NULL ? doc->trigrams : NULL;
+}
+
+static void
+post(TrigramIndex *self, guint32 trigram, EditorPage *page)
+{
+  GHashTable *pages;
+
+  pages = g_hash_table_lookup(self->postings, GUINT_TO_POINTER(trigram));
+  if (pages == NULL) {
+    pages = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_hash_table_insert(self->postings, GUINT_TO_POINTER(trigram), pages);
+  }
+
+  g_hash_table_add(pages, page);
+}
+
+static void
+unpost(TrigramIndex *self, guint32 trigram, EditorPage *page)
+{
+  GHashTable *pages;
+
+  pages = g_hash_table_lookup(self->postings, GUINT_TO_POINTER(trigram));
+  if (pages == NULL) {
+    return;
+  }
+
+  g_hash_table_remove(pages, page);
+  if (g_hash_table_size(pages) == 0) {
+    g_hash_table_remove(self->postings, GUINT_TO_POINTER(trigram));
+  }
+}
+
+void
+trigram_index_remove_page(TrigramIndex *self, EditorPage *page)
+{
+  TrigramDoc *doc;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+
+  doc = g_hash_table_lookup(self->pages, page);
+  if (doc == NULL) {
+    return;
+  }
+
+  for (guint i = 0; i < doc->trigrams->len; i++) {
+    unpost(self, g_array_index(doc->trigrams, guint32, i), page);
+  }
+
+  g_hash_table_remove(self->pages, page);
+}
+
+/* Replaces whatever the page was indexed with before, takes the doc. Only
+ * the trigrams that differ between the old and the new text touch the
+ * postings, an edit usually changes a handful of them. */
+void
+trigram_index_set_page(TrigramIndex *self, EditorPage *page, TrigramDoc *doc)
+{
+  TrigramDoc *old;
+  GArray *a;
+  GArray *b;
+  guint i = 0;
+  guint j = 0;
+
+  g_return_if_fail(self != NULL);
+  g_return_if_fail(page != NULL);
+  g_return_if_fail(doc != NULL);
+
+  old = g_hash_table_lookup(self->pages, page);
+  if (old == NULL) {
+    for (i = 0; i < doc->trigrams->len; i++) {
+      post(self, g_array_index(doc->trigrams, guint32, i), page);
+    }
+    g_hash_table_insert(self->pages, g_object_ref(page), doc);
+    return;
+  }
+
+  a = old->trigrams;
+  b = doc->trigrams;
+
+  /* Both are sorted, walk them side by side */
+  while (i < a->len || j < b->len) {
+    if (j == b->len || (i < a->len && g_array_index(a, guint32, i) <
+                                          g_array_index(b, guint32, j))) {
+      unpost(self, g_array_index(a, guint32, i++), page);
+    } else if (i == a->len || g_array_index(b, guint32, j) <
+                                g_array_index(a, guint32, i)) {
+      post(self, g_array_index(b, guint32, j++), page);
+    } else {
+      i++;
+      j++;
+    }
+  }
+
+  g_hash_table_insert(self->pages, g_object_ref(page), doc);
+}
+
+static guint
+count_matches(const gchar *text, gsize text_len, const gchar *needle, gsize len)
+{
+  const gchar *iter = text;
+  const gchar *end = text + text_len;
+  guint hits = 0;
+
+  while ((gsize) (end - iter) >= len) {
+    const gchar *found = memchr(iter, needle[0], end - iter - len + 1);
+
+    if (found == NULL) {
+      break;
+    }
+
+    if (memcmp(found, needle, len) == 0) {
+      hits++;
+      iter = found + len;
+    } else {
+      iter = found + 1;
+    }
+  }
+
+  return hits;
+}
+
+/* The text is only around while it is checked */
+static guint
+page_matches(TrigramIndex *self,
+             EditorPage *page,
+             const gchar *needle,
+             gsize len)
+{
+  gchar *text;
+  gsize text_len;
+  guint hits;
+
+  text = self->text_func(page, self->user_data);
+  if (text == NULL) {
+    return 0;
+  }
+
+  text_len = strlen(text);
+  for (gsize i = 0; i < text_len; i++) {
+    text[i] = g_ascii_tolower(text[i]);
+  }
+
+  hits = count_matches(text, text_len, needle, len);
+  g_free(text);
+
+  return hits;
+}
+
+static gint
+postings_size_cmp(gconstpointer a, gconstpointer b)
+{
+  guint sa = g_hash_table_size(*((GHashTable **) a));
+  guint sb = g_hash_table_size(*((GHashTable **) b));
+
+  return (sa > sb) - (sa < sb);
+}
+
+/* Pages containing the needle, ignoring ASCII case, most hits first. The
+ * trigrams only narrow down the candidates, every one of them is verified
+ * against the text of the page. That can mean parsing an evicted page, so
+ * needles shorter than TRIGRAM_MIN_QUERY, which every page is a candidate
+ * for, match nothing. */
+GArray *
+trigram_index_query(TrigramIndex *self, const gchar *needle)
+{
+  GArray *res = g_array_new(FALSE, FALSE, sizeof(SearchResult));
+  GPtrArray *lists;
+  GHashTableIter iter;
+  EditorPage *page;
+  GArray *grams;
+  gchar *folded;
+  gsize len;
+
+  g_return_val_if_fail(self != NULL, res);
+  g_return_val_if_fail(needle != NULL, res);
+
+  len = strlen(needle);
+  if (len < TRIGRAM_MIN_QUERY) {
+    return res;
+  }
+
+  folded = g_ascii_strdown(needle, len);
+  grams = collect_trigrams(folded, len);
+  lists = g_ptr_array_new();
+
+  for (guint i = 0; i < grams->len; i++) {
+    GHashTable *pages;
+
+    pages = g_hash_table_lookup(
+      self->postings, GUINT_TO_POINTER(g_array_index(grams, guint32, i)));
+    if (pages == NULL) {
+      goto out;
+    }
+    g_ptr_array_add(lists, pages);
+  }
+
+  g_ptr_array_sort(lists, postings_size_cmp);
+
+  g_hash_table_iter_init(&iter, lists->pdata[0]);
+  while (g_hash_table_iter_next(&iter, (gpointer *) &page, NULL)) {
+    SearchResult result = { page, 0 };
+    guint i;
+
+    for (i = 1; i < lists->len; i++) {
+      if (!g_hash_table_contains(lists->pdata[i], page)) {
+        break;
+      }
+    }
+
+    if (i < lists->len) {
+      continue;
+    }
+
+    /* Having all the trigrams does not mean they are in order */
+    result.hits = page_matches(self, page, folded, len);
+    if (result.hits > 0) {
+      g_array_append_val(res, result);
+    }
+  }
+
+  search_results_sort(res);
+
+out:
+  g_ptr_array_unref(lists);
+  g_array_unref(grams);
+  g_free(folded);
+  return res;
+}
+
+guint
+trigram_index_n_trigrams(TrigramIndex *self)
+{
+  g_return_val_if_fail(self != NULL, 0);
+
+  return g_hash_table_size(self->postings);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glib.h>
+
+#include "editor_page.h"
+
+G_BEGIN_DECLS
+
+typedef struct _TrigramIndex TrigramIndex;
+
+/* Shorter queries have no trigram to narrow the pages down with */
+#define TRIGRAM_MIN_QUERY 3
+
+/* The sorted set of trigrams of a page. Built without touching any page, so
+ * it can be done in a worker thread. */
+typedef struct {
+  GArray *trigrams;
+} TrigramDoc;
+
+/* The text a page was indexed with, the index keeps no copy of its own */
+typedef gchar *(*TrigramTextFunc)(EditorPage *page, gpointer user_data);
+
+TrigramDoc *trigram_doc_new(const gchar *text, gssize len);
+
+void trigram_doc_free(TrigramDoc *doc);
+
+TrigramIndex *trigram_index_new(TrigramTextFunc text_func,
+                                gpointer user_data);
+
+void trigram_index_free(TrigramIndex *self);
+
+gboolean trigram_index_has_page(TrigramIndex *self, EditorPage *page);
+
+const GArray *trigram_index_get_trigrams(TrigramIndex *self, EditorPage *page);
+
+void trigram_index_set_page(TrigramIndex *self,
+                            EditorPage *page,
+                            TrigramDoc *doc);
+
+void trigram_index_remove_page(TrigramIndex *self, EditorPage *page);
+
+GArray *trigram_index_query(TrigramIndex *self, const gchar *needle);
+
+guint trigram_index_n_trigrams(TrigramIndex *self);
+
+G_END_DECLS
@@ -55,14 +55,14 @@ utils_match_pattern(const gchar *pattern,
       *start_res = iter;
       pos++;
       if (debug) {
-        g_message("Start buff match newline");
+        g_debug("Start buff match newline");
       }
       continue;
     }
 
     if (pattern[pos] == '\n' && pos > 0 && gtk_text_iter_ends_line(&iter)) {
       if (debug) {
-        g_message("Non-start match newline");
+        g_debug("Non-start match newline");
       }
       goto have_match;
     }
@@ -82,7 +82,7 @@ utils_match_pattern(const gchar *pattern,
 
     if (buff[0] == pattern[pos]) {
       if (debug)
-        g_message("Matched on '%c'", pattern[pos]);
+        g_debug("Matched on '%c'", pattern[pos]);
       goto have_match;
     }
 
@@ -116,8 +116,8 @@ utils_match_pattern(const gchar *pattern,
 
   failed_match:
     if (debug)
-      g_message("Failed at match pos %d  with %c vs '%c' [%s]", pos,
-                pattern[pos], buff[0], buff);
+      g_debug("Failed at match pos %d  with %c vs '%c' [%s]", pos,
+              pattern[pos], buff[0], buff);
     pos = 0;
     gtk_text_iter_forward_char(&iter);
   }
@@ -215,8 +215,8 @@ utils_insert_styling_tag(GtkTextBuffer *buffer,
   }
 
   if (do_start_del) {
-    g_message("Deleting from start (%s): %s", tag_name,
-              gtk_text_iter_get_text(&start_del, &start_tag));
+    g_debug("Deleting from start (%s): %s", tag_name,
+            gtk_text_iter_get_text(&start_del, &start_tag));
     gtk_text_buffer_delete(buffer, &start_del, &start_tag);
   }
 
@@ -241,7 +241,10 @@ utils_fix_specific_tag(GtkTextBuffer *buffer,
 
   gtk_text_buffer_get_start_iter(buffer, &start_bound);
 
-  g_message("Fixing %s, %s", name, pattern);
+  g_debug("Fixing %s, %s", name, pattern);
+
+  /* Restyling rewrites the markup, none of it should end up in undo */
+  gtk_text_buffer_begin_irreversible_action(buffer);
 
   while (utils_match_pattern(pattern, buffer, &start_bound, NULL, &start_res,
                              &stop_res)) {
@@ -250,10 +253,118 @@ utils_fix_specific_tag(GtkTextBuffer *buffer,
 
       utils_insert_styling_tag(buffer, &start_res, &stop_res, trim, name);
       gtk_text_buffer_get_iter_at_mark(buffer, &start_bound, search_start);
-      g_message("... found %s", name);
+      g_debug("... found %s", name);
     } else {
-      g_message("... found %s, but had tag", name);
+      g_debug("... found %s, but had tag", name);
       start_bound = stop_res;
     }
   }
-}
\ No newline at end of file
+
+  gtk_text_buffer_end_irreversible_action(buffer);
+}
+
+/* Deflate data into a compact blob, used for pages whose buffers have been
+ * released */
+GBytes *
+utils_compress(const gchar *data, gsize len)
+{
+  GError *lerr = NULL;
+  GOutputStream *mem;
+  GOutputStream *out;
+  GZlibCompressor *compressor;
+  GBytes *res = NULL;
+
+  mem = g_memory_output_stream_new_resizable();
+  compressor = g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW, 1);
+  out = g_converter_output_stream_new(mem, G_CONVERTER(compressor));
+
+  if (!g_output_stream_write_all(out, data, len, NULL, NULL, &lerr) ||
+      !g_output_stream_close(out, NULL, &lerr)) {
+    g_warning("Could not compress data: %s", lerr->message);
+    g_clear_error(&lerr);
+    goto out;
+  }
+
+  res = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(mem));
+
+out:
+  g_object_unref(out);
+  g_object_unref(compressor);
+  g_object_unref(mem);
+  return res;
+}
+
+gchar *
+utils_decompress(GBytes *data)
+{
+  GError *lerr = NULL;
+  GOutputStream *mem;
+  GOutputStream *out;
+  GZlibDecompressor *decompressor;
+  gconstpointer raw;
+  gsize len;
+  gchar *res = NULL;
+
+  g_return_val_if_fail(data != NULL, NULL);
+
+  raw = g_bytes_get_data(data, &len);
+
+  mem = g_memory_output_stream_new_resizable();
+  decompressor = g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW);
+  out = g_converter_output_stream_new(mem, G_CONVERTER(decompressor));
+
+  if (!g_output_stream_write_all(out, raw, len, NULL, NULL, &lerr) ||
+      !g_output_stream_close(out, NULL, &lerr)) {
+    g_warning("Could not decompress data: %s", lerr->message);
+    g_clear_error(&lerr);
+    goto out;
+  }
+
+  res = g_strndup(
+    g_memory_output_stream_get_data(G_MEMORY_OUTPUT_STREAM(mem)),
+    g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(mem)));
+
+out:
+  g_object_unref(out);
+  g_object_unref(decompressor);
+  g_object_unref(mem);
+  return res;
+}
+
+/* Key that orders text by the collation of the locale with case and
+ * accents left out, "apple" and "Äpple" before "Zebra". Keys compare with
+ * strcmp, so the collation is paid once per text and not per comparison. */
+gchar *
+utils_sort_key(const gchar *text)
+{
+  GString *bare;
+  gchar *decomposed;
+  gchar *folded;
+  gchar *res;
+
+  g_return_val_if_fail(text != NULL, NULL);
+
+  /* Accents become marks of their own and are dropped */
+  decomposed = g_utf8_normalize(text, -1, G_NORMALIZE_NFD);
+  if (decomposed == NULL) {
+    return g_strdup(text);
+  }
+
+  bare = g_string_sized_new(strlen(decomposed));
+  for (const gchar *p = decomposed; *p != '\0'; p = g_utf8_next_char(p)) {
+    gunichar c = g_utf8_get_char(p);
+
+    if (!g_unichar_ismark(c)) {
+      g_string_append_unichar(bare, c);
+    }
+  }
+
+  folded = g_utf8_casefold(bare->str, bare->len);
+  res = g_utf8_collate_key(folded, -1);
+
+  g_free(folded);
+  g_string_free(bare, TRUE);
+  g_free(decomposed);
+
+  return res;
+}
@@ -26,4 +26,10 @@ utils_insert_styling_tag(GtkTextBuffer *buffer,
                          const gchar *pattern,
                          const gchar *tag_name);
 
+GBytes *utils_compress(const gchar *data, gsize len);
+
+gchar *utils_decompress(GBytes *data);
+
+gchar *utils_sort_key(const gchar *text);
+
   G_END_DECLS
\ No newline at end of file
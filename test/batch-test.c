@@ -0,0 +1,142 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+
+#include "batch.h"
+#include "editor_page.h"
+
+#define GOOD_NOTE                                               \
+  "---\ntitle: \"Good\"\ndraft: true\ntags:\n  - Tag 1\n---\n" \
+  "See [Other]({{< ref \"other.md\" >}} \"Other\")\n"
+
+#define OTHER_NOTE                                               \
+  "---\ntitle: \"Other\"\ndraft: true\ntags:\n  - Tag 1\n---\n" \
+  "See [Missing]({{< ref \"missing.md\" >}} \"Missing\")\n"
+
+/* Loads fine, but is not how the editor saves it */
+#define LOOSE_NOTE                                              \
+  "---\ntitle: Loose\ndraft: true\ntags:\n  - Tag 1\n---\n" \
+  "some text\n"
+
+#define LOOSE_NOTE_SAVED                                          \
+  "---\ntitle: \"Loose\"\ndraft: true\ntags:\n  - Tag 1\n---\n" \
+  "some text\n"
+
+/* Links to a page that sorts and hashes before it, the placeholder of the
+ * target must outlive the page linking to it */
+#define ZULU_NOTE                                              \
+  "---\ntitle: Zulu\ndraft: true\ntags:\n  - Tag 1\n---\n" \
+  "See [Alpha]({{< ref \"alpha.md\" >}} \"Alpha\")\n"
+
+#define ZULU_NOTE_SAVED                                          \
+  "---\ntitle: \"Zulu\"\ndraft: true\ntags:\n  - Tag 1\n---\n" \
+  "See [Alpha]({{< ref \"alpha.md\" >}} \"Alpha\")\n"
+
+/* Same folder in the test and in its subprocesses */
+static gchar *
+workspace(const gchar *name)
+{
+  gchar *root = g_test_build_filename(G_TEST_BUILT, name, NULL);
+
+  g_assert_cmpint(g_mkdir_with_parents(root, 0755), ==, 0);
+
+  return root;
+}
+
+static void
+write_note(const gchar *root, const gchar *filename, const gchar *content)
+{
+  gchar *path = g_build_filename(root, filename, NULL);
+
+  g_assert_true(g_file_set_contents(path, content, -1, NULL));
+  g_free(path);
+}
+
+void
+test_batch_header(void)
+{
+  g_assert_null(editor_page_header_problem(GOOD_NOTE));
+  g_assert_cmpstr(editor_page_header_problem("Just text\n"), ==,
+                  "No front matter");
+  g_assert_cmpstr(editor_page_header_problem("---\ntitle: \"Open\"\n"), ==,
+                  "Front matter is not closed");
+  g_assert_cmpstr(editor_page_header_problem("---"), ==,
+                  "Front matter is not closed");
+  g_assert_cmpstr(editor_page_header_problem("---\ntitle: [\"x\"\n---\n"),
+                  ==, "Front matter is not valid YAML");
+  g_assert_cmpstr(editor_page_header_problem("---\ndraft: true\n---\nx\n"),
+                  ==, "Front matter has no title");
+}
+
+void
+test_batch_check(void)
+{
+  gchar *root = workspace("batch-check");
+
+  if (g_test_subprocess()) {
+    exit(batch_run(BATCH_CHECK, root));
+  }
+
+  write_note(root, "good.md", GOOD_NOTE);
+  write_note(root, "other.md", OTHER_NOTE);
+  write_note(root, "broken.md", "No front matter here\n");
+
+  g_test_trap_subprocess(NULL, 0, G_TEST_SUBPROCESS_DEFAULT);
+  g_test_trap_assert_failed();
+  g_test_trap_assert_stdout("*broken.md: No front matter*");
+  g_test_trap_assert_stdout("*other.md: Link to \"Missing\" has no file*");
+  g_test_trap_assert_stdout_unmatched("*good.md*");
+
+  g_free(root);
+}
+
+void
+test_batch_reformat(void)
+{
+  gchar *root = workspace("batch-reformat");
+  gchar *path = g_build_filename(root, "loose.md", NULL);
+  gchar *zulu = g_build_filename(root, "zulu.md", NULL);
+  gchar *content;
+
+  if (g_test_subprocess()) {
+    exit(batch_run(BATCH_REFORMAT, root));
+  }
+
+  write_note(root, "loose.md", LOOSE_NOTE);
+  write_note(root, "good.md", GOOD_NOTE);
+  write_note(root, "zulu.md", ZULU_NOTE);
+
+  g_test_trap_subprocess(NULL, 0, G_TEST_SUBPROCESS_DEFAULT);
+  g_test_trap_assert_passed();
+  g_test_trap_assert_stdout("*loose.md: Reformatted*");
+  g_test_trap_assert_stdout("*zulu.md: Reformatted*");
+  g_test_trap_assert_stdout_unmatched("*good.md*");
+
+  g_assert_true(g_file_get_contents(path, &content, NULL, NULL));
+  g_assert_cmpstr(content, ==, LOOSE_NOTE_SAVED);
+  g_free(content);
+  g_assert_true(g_file_get_contents(zulu, &content, NULL, NULL));
+  g_assert_cmpstr(content, ==, ZULU_NOTE_SAVED);
+  g_free(content);
+
+  /* Saved files come back the same */
+  g_test_trap_subprocess(NULL, 0, G_TEST_SUBPROCESS_DEFAULT);
+  g_test_trap_assert_passed();
+  g_test_trap_assert_stdout_unmatched("*Reformatted*");
+
+  g_free(zulu);
+  g_free(path);
+  g_free(root);
+}
+
+int
+main(int argc, char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/batch/header", test_batch_header);
+  g_test_add_func("/batch/check", test_batch_check);
+  g_test_add_func("/batch/reformat", test_batch_reformat);
+
+  return g_test_run();
+}
@@ -0,0 +1,75 @@
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "editor_page.h"
+#include "page_cache.h"
+
+/* Steps that do not run into each other, so each is one undo level */
+static void
+add_steps(EditorPage *page, guint n)
+{
+  for (guint i = 0; i < n; i++) {
+    GtkTextIter start;
+
+    gtk_text_buffer_get_start_iter(page->content, &start);
+    gtk_text_buffer_begin_user_action(page->content);
+    gtk_text_buffer_insert(page->content, &start, "line\n", -1);
+    gtk_text_buffer_end_user_action(page->content);
+  }
+}
+
+static guint
+count_undo(EditorPage *page)
+{
+  guint res = 0;
+
+  while (gtk_text_buffer_get_can_undo(page->content)) {
+    gtk_text_buffer_undo(page->content);
+    res++;
+  }
+
+  return res;
+}
+
+void
+test_cache_undo_capped(void)
+{
+  PageCache *cache = page_cache_new(G_MAXSIZE, 3);
+  EditorPage *first = editor_page_new("First", NULL, NULL, NULL, NULL, NULL);
+  EditorPage *second = editor_page_new("Second", NULL, NULL, NULL, NULL, NULL);
+
+  page_cache_add(cache, first);
+  page_cache_add(cache, second);
+
+  /* Pages that were never viewed keep no history at all */
+  add_steps(second, 2);
+  g_assert_false(gtk_text_buffer_get_can_undo(second->content));
+
+  /* The viewed page gets the whole budget and no more */
+  page_cache_touch(cache, first);
+  add_steps(first, 5);
+  g_assert_cmpuint(count_undo(first), ==, 3);
+
+  /* Viewing another page takes the budget, and the history, with it */
+  add_steps(first, 2);
+  page_cache_touch(cache, second);
+  g_assert_false(gtk_text_buffer_get_enable_undo(first->content));
+  g_assert_false(gtk_text_buffer_get_can_undo(first->content));
+
+  add_steps(second, 4);
+  g_assert_cmpuint(count_undo(second), ==, 3);
+
+  page_cache_free(cache);
+  g_object_unref(first);
+  g_object_unref(second);
+}
+
+int
+main(int argc, char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/cache/undo/capped", test_cache_undo_capped);
+
+  return g_test_run();
+}
@@ -0,0 +1,140 @@
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <string.h>
+
+#include "text_search.h"
+
+/* Highlighting every match in a big buffer, the way the find bar does it,
+ * against walking the buffer with gtk_text_iter_forward_search(). */
+
+static gint size_mb = 5;
+static gchar *needle = "needle_42";
+
+static GOptionEntry entries[] = {
+  { "size", 's', 0, G_OPTION_ARG_INT, &size_mb, "Size of the buffer in MB",
+    "N" },
+  { "needle", 'n', 0, G_OPTION_ARG_STRING, &needle, "Text to look for",
+    "TEXT" },
+  { NULL }
+};
+
+static guint
+highlight_snapshot(GtkTextBuffer *buffer, GtkTextTag *tag)
+{
+  GtkTextIter start;
+  GtkTextIter end;
+  GArray *hits;
+  gchar *text;
+  glong needle_chars = g_utf8_strlen(needle, -1);
+  glong chars = 0;
+  gsize bytes = 0;
+  guint res;
+
+  gtk_text_buffer_get_bounds(buffer, &start, &end);
+  text = gtk_text_buffer_get_slice(buffer, &start, &end, TRUE);
+  hits = text_search_find_all(text, strlen(text), needle, FALSE);
+
+  for (guint i = 0; i < hits->len; i++) {
+    gsize hit = g_array_index(hits, gsize, i);
+
+    chars += g_utf8_strlen(text + bytes, hit - bytes);
+    bytes = hit;
+
+    gtk_text_buffer_get_iter_at_offset(buffer, &start, chars);
+    gtk_text_buffer_get_iter_at_offset(buffer, &end, chars + needle_chars);
+    gtk_text_buffer_apply_tag(buffer, tag, &start, &end);
+  }
+
+  res = hits->len;
+  g_array_unref(hits);
+  g_free(text);
+
+  return res;
+}
+
+static guint
+highlight_iters(GtkTextBuffer *buffer, GtkTextTag *tag)
+{
+  GtkTextIter iter;
+  GtkTextIter match_start;
+  GtkTextIter match_end;
+  guint res = 0;
+
+  gtk_text_buffer_get_start_iter(buffer, &iter);
+
+  while (gtk_text_iter_forward_search(&iter, needle,
+                                      GTK_TEXT_SEARCH_CASE_INSENSITIVE |
+                                        GTK_TEXT_SEARCH_TEXT_ONLY,
+                                      &match_start, &match_end, NULL)) {
+    gtk_text_buffer_apply_tag(buffer, tag, &match_start, &match_end);
+    iter = match_end;
+    res++;
+  }
+
+  return res;
+}
+
+int
+main(int argc, char *argv[])
+{
+  GError *lerr = NULL;
+  GOptionContext *context;
+  GtkTextBuffer *buffer;
+  GtkTextTag *tag;
+  GtkTextIter start;
+  GtkTextIter end;
+  GString *text;
+  GTimer *timer;
+  guint found;
+  guint expected;
+
+  context = g_option_context_new("- highlighting all matches in a buffer");
+  g_option_context_add_main_entries(context, entries, NULL);
+  if (!g_option_context_parse(context, &argc, &argv, &lerr)) {
+    g_printerr("%s\n", lerr->message);
+    g_clear_error(&lerr);
+    return 1;
+  }
+  g_option_context_free(context);
+
+  text = g_string_new("");
+  for (guint line = 0; text->len < (gsize) size_mb * 1024 * 1024; line++) {
+    g_string_append_printf(text, "Line %u of the page, with some words and "
+                                 "a needle_%u in it.\n",
+                           line, line % 1000);
+  }
+  expected = 0;
+  for (const gchar *p = strstr(text->str, needle); p != NULL;
+       p = strstr(p + strlen(needle), needle)) {
+    expected++;
+  }
+
+  buffer = gtk_text_buffer_new(NULL);
+  gtk_text_buffer_set_text(buffer, text->str, text->len);
+  tag = gtk_text_buffer_create_tag(buffer, "match", "background", "yellow",
+                                   NULL);
+  g_print("Buffer of %" G_GSIZE_FORMAT " bytes, %u matches\n", text->len,
+          expected);
+
+  timer = g_timer_new();
+  found = highlight_snapshot(buffer, tag);
+  g_print("snapshot %10.2f ms  %u matches\n",
+          g_timer_elapsed(timer, NULL) * 1000, found);
+  if (found != expected) {
+    return 1;
+  }
+
+  gtk_text_buffer_get_bounds(buffer, &start, &end);
+  gtk_text_buffer_remove_tag(buffer, tag, &start, &end);
+
+  g_timer_start(timer);
+  found = highlight_iters(buffer, tag);
+  g_print("iters    %10.2f ms  %u matches\n",
+          g_timer_elapsed(timer, NULL) * 1000, found);
+
+  g_timer_destroy(timer);
+  g_object_unref(buffer);
+  g_string_free(text, TRUE);
+
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include <glib.h>
+#include <string.h>
+
+#include "text_search.h"
+
+static GArray *
+find(const gchar *haystack, const gchar *needle, gboolean match_case)
+{
+  return text_search_find_all(haystack, strlen(haystack), needle, match_case);
+}
+
+void
+test_find_all(void)
+{
+  GArray *hits;
+
+  hits = find("abc abcabc ab", "abc", TRUE);
+  g_assert_cmpuint(hits->len, ==, 3);
+  g_assert_cmpuint(g_array_index(hits, gsize, 0), ==, 0);
+  g_assert_cmpuint(g_array_index(hits, gsize, 1), ==, 4);
+  g_assert_cmpuint(g_array_index(hits, gsize, 2), ==, 7);
+  g_array_unref(hits);
+
+  /* Not overlapping */
+  hits = find("aaaa", "aa", TRUE);
+  g_assert_cmpuint(hits->len, ==, 2);
+  g_array_unref(hits);
+
+  hits = find("x", "xyz", TRUE);
+  g_assert_cmpuint(hits->len, ==, 0);
+  g_array_unref(hits);
+
+  hits = find("abc", "", TRUE);
+  g_assert_cmpuint(hits->len, ==, 0);
+  g_array_unref(hits);
+}
+
+void
+test_find_case(void)
+{
+  GArray *hits;
+
+  hits = find("Foo fOO foo", "foo", FALSE);
+  g_assert_cmpuint(hits->len, ==, 3);
+  g_array_unref(hits);
+
+  hits = find("Foo fOO foo", "foo", TRUE);
+  g_assert_cmpuint(hits->len, ==, 1);
+  g_assert_cmpuint(g_array_index(hits, gsize, 0), ==, 8);
+  g_array_unref(hits);
+}
+
+void
+test_find_utf8(void)
+{
+  GArray *hits;
+
+  /* Byte offsets, "ö" is two bytes */
+  hits = find("ö café, Café", "café", FALSE);
+  g_assert_cmpuint(hits->len, ==, 2);
+  g_assert_cmpuint(g_array_index(hits, gsize, 0), ==, 3);
+  g_assert_cmpuint(g_array_index(hits, gsize, 1), ==, 10);
+  g_array_unref(hits);
+}
+
+int
+main(int argc, char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/find/all", test_find_all);
+  g_test_add_func("/find/case", test_find_case);
+  g_test_add_func("/find/utf8", test_find_utf8);
+
+  return g_test_run();
+}
@@ -0,0 +1,155 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+#include "editor_page.h"
+#include "frecency.h"
+#include "notes_page_store.h"
+
+#define DAY (G_USEC_PER_SEC * G_GINT64_CONSTANT(86400))
+#define NOW (G_GINT64_CONSTANT(20000) * DAY)
+
+void
+test_frecency_rank(void)
+{
+  Frecency often;
+  Frecency once;
+  Frecency never;
+
+  frecency_init(&often);
+  frecency_init(&once);
+  frecency_init(&never);
+
+  /* Used a lot a while ago against once just now */
+  for (guint i = 0; i < 8; i++) {
+    frecency_opened(&often, NOW - 60 * DAY);
+  }
+  frecency_opened(&once, NOW);
+  g_assert_cmpint(frecency_cmp(&once, &often), <, 0);
+
+  /* The same visits recently win */
+  for (guint i = 0; i < 8; i++) {
+    frecency_opened(&often, NOW);
+  }
+  g_assert_cmpint(frecency_cmp(&often, &once), <, 0);
+  g_assert_cmpint(frecency_cmp(&once, &never), <, 0);
+  g_assert_cmpuint(often.opens, ==, 16);
+
+  /* A link counts for more than an open */
+  frecency_init(&never);
+  frecency_linked(&never, NOW);
+  g_assert_cmpint(frecency_cmp(&never, &once), <, 0);
+  g_assert_cmpuint(never.links, ==, 1);
+}
+
+void
+test_frecency_file(void)
+{
+  GHashTable *records;
+  GHashTable *read;
+  Frecency page;
+  Frecency *back;
+  gchar *root;
+  gchar *path;
+
+  root = g_dir_make_tmp("frecency-XXXXXX", NULL);
+  path = g_build_filename(root, FRECENCY_FILE, NULL);
+
+  frecency_init(&page);
+  frecency_opened(&page, NOW);
+  frecency_linked(&page, NOW);
+
+  records = g_hash_table_new(g_str_hash, g_str_equal);
+  g_hash_table_insert(records, "Meeting notes", &page);
+  g_assert_true(frecency_write(path, records, NULL));
+  g_hash_table_unref(records);
+
+  read = frecency_read(path, NULL);
+  g_assert_nonnull(read);
+  back = g_hash_table_lookup(read, "Meeting notes");
+  g_assert_nonnull(back);
+  g_assert_cmpfloat(back->score, ==, page.score);
+  g_assert_cmpuint(back->opens, ==, 1);
+  g_assert_cmpuint(back->links, ==, 1);
+  g_hash_table_unref(read);
+
+  g_remove(path);
+  g_rmdir(root);
+  g_free(path);
+  g_free(root);
+}
+
+static void
+count_changes(G_GNUC_UNUSED GListModel *model,
+              guint position,
+              guint removed,
+              guint added,
+              guint *changes)
+{
+  changes[0] = position;
+  changes[1] = removed;
+  changes[2] = added;
+}
+
+void
+test_frecency_store(void)
+{
+  NotesPageStore *store = notes_page_store_new();
+  EditorPage *pages[4];
+  EditorPage *item;
+  guint changes[3] = { 0 };
+
+  pages[0] = editor_page_new("Alpha", NULL, NULL, NULL, NULL, NULL);
+  pages[1] = editor_page_new("Beta", NULL, NULL, NULL, NULL, NULL);
+  pages[2] = editor_page_new("Gamma", NULL, NULL, NULL, NULL, NULL);
+  pages[3] = editor_page_new("Delta", NULL, NULL, NULL, NULL, NULL);
+  for (guint i = 0; i < G_N_ELEMENTS(pages); i++) {
+    notes_page_store_add(store, pages[i]);
+  }
+
+  notes_page_store_set_sort(store, NOTES_PAGE_STORE_SORT_FRECENCY);
+  g_signal_connect(store, "items-changed", G_CALLBACK(count_changes),
+                   changes);
+
+  /* Two actions first, then the pages */
+  notes_page_store_opened(store, pages[2]);
+  item = g_list_model_get_item(G_LIST_MODEL(store), 2);
+  g_assert_true(item == pages[2]);
+  g_object_unref(item);
+
+  /* Gamma moved from the last place to the first, nothing else did */
+  g_assert_cmpuint(changes[0], ==, 2);
+  g_assert_cmpuint(changes[1], ==, 0);
+  g_assert_cmpuint(changes[2], ==, 1);
+
+  notes_page_store_linked(store, pages[1]);
+  notes_page_store_linked(store, pages[1]);
+  item = g_list_model_get_item(G_LIST_MODEL(store), 2);
+  g_assert_true(item == pages[1]);
+  g_object_unref(item);
+  item = g_list_model_get_item(G_LIST_MODEL(store), 3);
+  g_assert_true(item == pages[2]);
+  g_object_unref(item);
+
+  /* Never used ones by heading */
+  item = g_list_model_get_item(G_LIST_MODEL(store), 4);
+  g_assert_true(item == pages[0]);
+  g_object_unref(item);
+
+  g_object_unref(store);
+  for (guint i = 0; i < G_N_ELEMENTS(pages); i++) {
+    g_object_unref(pages[i]);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/frecency/rank", test_frecency_rank);
+  g_test_add_func("/frecency/file", test_frecency_file);
+  g_test_add_func("/frecency/store", test_frecency_store);
+
+  return g_test_run();
+}
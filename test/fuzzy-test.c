@@ -0,0 +1,66 @@
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "editor_page.h"
+#include "fuzzy.h"
+
+void
+test_fuzzy_fold(void)
+{
+  gchar *key;
+
+  key = fuzzy_fold("Émile's Café");
+  g_assert_cmpstr(key, ==, "emile's cafe");
+  g_free(key);
+}
+
+void
+test_fuzzy_match(void)
+{
+  g_assert_cmpint(fuzzy_score("meeting notes", "mtn"), !=, FUZZY_NO_MATCH);
+  g_assert_cmpint(fuzzy_score("meeting notes", "meeting notes"), !=,
+                  FUZZY_NO_MATCH);
+  g_assert_cmpint(fuzzy_score("meeting notes", "ntm"), ==, FUZZY_NO_MATCH);
+  g_assert_cmpint(fuzzy_score("notes", "notess"), ==, FUZZY_NO_MATCH);
+}
+
+void
+test_fuzzy_rank(void)
+{
+  /* Word starts beat letters in the middle of words */
+  g_assert_cmpint(fuzzy_score("meeting notes", "mn"), >,
+                  fuzzy_score("common", "mn"));
+  /* Runs beat scattered letters */
+  g_assert_cmpint(fuzzy_score("budget", "bud"), >,
+                  fuzzy_score("big used dog", "bud"));
+  /* Shorter wins on equal matches */
+  g_assert_cmpint(fuzzy_score("todo", "todo"), >,
+                  fuzzy_score("todo later", "todo"));
+}
+
+/* The switcher scores pages by a key they fold once, not on every open */
+void
+test_fuzzy_page_key(void)
+{
+  EditorPage *page = editor_page_new("Émile", NULL, NULL, NULL, NULL, NULL);
+
+  g_assert_cmpstr(page->fuzzy_key, ==, "emile");
+
+  g_object_set(page, "heading", "Café Notes", NULL);
+  g_assert_cmpstr(page->fuzzy_key, ==, "cafe notes");
+
+  g_object_unref(page);
+}
+
+int
+main(int argc, char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/fuzzy/fold", test_fuzzy_fold);
+  g_test_add_func("/fuzzy/match", test_fuzzy_match);
+  g_test_add_func("/fuzzy/rank", test_fuzzy_rank);
+  g_test_add_func("/fuzzy/page-key", test_fuzzy_page_key);
+
+  return g_test_run();
+}
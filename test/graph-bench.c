@@ -0,0 +1,92 @@
+#include <glib.h>
+
+#include "link_graph.h"
+
+/* Builds and analyses a random workspace sized like a large real one. The
+ * names are made up front so only the graph is timed. */
+
+static gint n_pages = 20000;
+static gint n_links = 200000;
+static gint seed = 42;
+
+static GOptionEntry entries[] = {
+  { "pages", 'p', 0, G_OPTION_ARG_INT, &n_pages, "Number of pages", "N" },
+  { "links", 'l', 0, G_OPTION_ARG_INT, &n_links, "Number of links", "N" },
+  { "seed", 's', 0, G_OPTION_ARG_INT, &seed, "Seed for the links", "N" },
+  { NULL }
+};
+
+int
+main(int argc, char *argv[])
+{
+  GError *lerr = NULL;
+  GOptionContext *context;
+  LinkGraph *graph;
+  GPtrArray *names;
+  GPtrArray *res;
+  GString *dot;
+  GTimer *timer;
+  GRand *rand;
+
+  context = g_option_context_new("- link graph analysis");
+  g_option_context_add_main_entries(context, entries, NULL);
+  if (!g_option_context_parse(context, &argc, &argv, &lerr)) {
+    g_printerr("%s\n", lerr->message);
+    g_clear_error(&lerr);
+    return 1;
+  }
+  g_option_context_free(context);
+
+  rand = g_rand_new_with_seed(seed);
+  names = g_ptr_array_new_with_free_func(g_free);
+
+  /* One in ten link targets has no page */
+  for (gint i = 0; i < n_pages + n_pages / 10; i++) {
+    g_ptr_array_add(names, g_strdup_printf("Page %d", i));
+  }
+
+  timer = g_timer_new();
+  graph = link_graph_new();
+
+  for (gint i = 0; i < n_pages; i++) {
+    link_graph_add_page(graph, names->pdata[i]);
+  }
+
+  for (gint i = 0; i < n_links; i++) {
+    link_graph_add_link(graph,
+                        names->pdata[g_rand_int_range(rand, 0, n_pages)],
+                        names->pdata[g_rand_int_range(rand, 0, names->len)]);
+  }
+  g_print("build     %8.2f ms\n", g_timer_elapsed(timer, NULL) * 1000);
+
+  g_timer_start(timer);
+  res = link_graph_orphans(graph);
+  g_print("orphans   %8.2f ms  %u\n", g_timer_elapsed(timer, NULL) * 1000,
+          res->len);
+  g_ptr_array_unref(res);
+
+  g_timer_start(timer);
+  res = link_graph_dangling(graph);
+  g_print("dangling  %8.2f ms  %u\n", g_timer_elapsed(timer, NULL) * 1000,
+          res->len);
+  g_ptr_array_unref(res);
+
+  g_timer_start(timer);
+  res = link_graph_clusters(graph);
+  g_print("clusters  %8.2f ms  %u\n", g_timer_elapsed(timer, NULL) * 1000,
+          res->len);
+  g_ptr_array_unref(res);
+
+  g_timer_start(timer);
+  dot = link_graph_to_dot(graph);
+  g_print("dot       %8.2f ms  %" G_GSIZE_FORMAT " bytes\n",
+          g_timer_elapsed(timer, NULL) * 1000, dot->len);
+  g_string_free(dot, TRUE);
+
+  link_graph_free(graph);
+  g_timer_destroy(timer);
+  g_ptr_array_unref(names);
+  g_rand_free(rand);
+
+  return 0;
+}
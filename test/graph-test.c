@@ -0,0 +1,123 @@
+#include <glib.h>
+#include <string.h>
+
+#include "link_graph.h"
+
+static LinkGraph *
+build(void)
+{
+  LinkGraph *graph = link_graph_new();
+
+  link_graph_add_page(graph, "A");
+  link_graph_add_page(graph, "B");
+  link_graph_add_page(graph, "C");
+  link_graph_add_page(graph, "Lonely");
+
+  /* A and B link to each other, C only links out */
+  link_graph_add_link(graph, "A", "B");
+  link_graph_add_link(graph, "B", "A");
+  link_graph_add_link(graph, "B", "A");
+  link_graph_add_link(graph, "C", "A");
+  link_graph_add_link(graph, "C", "Placeholder");
+  link_graph_add_link(graph, "Lonely", "Lonely");
+
+  return graph;
+}
+
+void
+test_graph_orphans(void)
+{
+  LinkGraph *graph = build();
+  GPtrArray *names;
+
+  names = link_graph_orphans(graph);
+  g_assert_cmpuint(names->len, ==, 2);
+  g_assert_cmpstr(names->pdata[0], ==, "C");
+  /* Linking to itself does not count */
+  g_assert_cmpstr(names->pdata[1], ==, "Lonely");
+  g_ptr_array_unref(names);
+
+  names = link_graph_dangling(graph);
+  g_assert_cmpuint(names->len, ==, 1);
+  g_assert_cmpstr(names->pdata[0], ==, "Placeholder");
+  g_ptr_array_unref(names);
+
+  link_graph_free(graph);
+}
+
+void
+test_graph_clusters(void)
+{
+  LinkGraph *graph = build();
+  GPtrArray *clusters;
+  GPtrArray *cluster;
+
+  link_graph_add_link(graph, "A", "C");
+
+  clusters = link_graph_clusters(graph);
+  g_assert_cmpuint(clusters->len, ==, 1);
+  cluster = clusters->pdata[0];
+  g_assert_cmpuint(cluster->len, ==, 3);
+  g_assert_cmpstr(cluster->pdata[0], ==, "A");
+  g_assert_cmpstr(cluster->pdata[1], ==, "B");
+  g_assert_cmpstr(cluster->pdata[2], ==, "C");
+  g_ptr_array_unref(clusters);
+
+  link_graph_free(graph);
+}
+
+void
+test_graph_long_chain(void)
+{
+  LinkGraph *graph = link_graph_new();
+  GPtrArray *clusters;
+
+  /* Deep enough to overflow a recursive walk */
+  for (guint i = 0; i < 200000; i++) {
+    gchar *from = g_strdup_printf("%u", i);
+    gchar *to = g_strdup_printf("%u", (i + 1) % 200000);
+
+    link_graph_add_link(graph, from, to);
+    g_free(from);
+    g_free(to);
+  }
+
+  clusters = link_graph_clusters(graph);
+  g_assert_cmpuint(clusters->len, ==, 1);
+  g_assert_cmpuint(((GPtrArray *) clusters->pdata[0])->len, ==, 200000);
+  g_ptr_array_unref(clusters);
+
+  link_graph_free(graph);
+}
+
+void
+test_graph_dot(void)
+{
+  LinkGraph *graph = build();
+  GString *dot;
+
+  dot = link_graph_to_dot(graph);
+  g_assert_true(g_str_has_prefix(dot->str, "digraph notes {\n"));
+  g_assert_nonnull(strstr(dot->str, "\"Placeholder\" [style=dashed];\n"));
+  g_assert_nonnull(strstr(dot->str, "\"C\" -> \"Placeholder\";\n"));
+  /* Repeated links are one edge */
+  g_assert_nonnull(strstr(dot->str, "\"B\" -> \"A\";\n"));
+  g_assert_null(strstr(strstr(dot->str, "\"B\" -> \"A\";\n") + 1,
+                       "\"B\" -> \"A\";\n"));
+  g_string_free(dot, TRUE);
+
+  link_graph_free(graph);
+}
+
+int
+main(int argc, char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/graph/orphans", test_graph_orphans);
+  g_test_add_func("/graph/clusters", test_graph_clusters);
+  g_test_add_func("/graph/long-chain", test_graph_long_chain);
+  g_test_add_func("/graph/dot", test_graph_dot);
+
+  return g_test_run();
+}
@@ -0,0 +1,176 @@
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <string.h>
+
+#include "editor_page.h"
+
+static EditorPage *
+fetch_page(const gchar *heading, gpointer user_data)
+{
+  return g_hash_table_lookup((GHashTable *) user_data, heading);
+}
+
+static void
+page_created(EditorPage *page, GHashTable *pages)
+{
+  g_hash_table_insert(pages, g_strdup(page->heading), page);
+}
+
+static EditorPage *
+load(GHashTable *pages, const gchar *md)
+{
+  gchar *content = g_strdup(md);
+  EditorPage *page;
+
+  page = editor_page_load(content, fetch_page, pages, G_CALLBACK(page_created),
+                          pages);
+  editor_page_fix_content(page);
+  g_free(content);
+
+  return page;
+}
+
+static guint
+links_from(EditorPage *target, EditorPage *source)
+{
+  return GPOINTER_TO_UINT(
+    g_hash_table_lookup(editor_page_get_backlinks(target), source));
+}
+
+void
+test_backlinks(void)
+{
+  GHashTable *pages;
+  EditorPage *source;
+  EditorPage *target;
+  GtkTextIter start;
+  GtkTextIter end;
+
+  pages = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                g_object_unref);
+
+  source = load(pages,
+                "---\ntitle: \"Source\"\ndraft: true\ntags:\n  - Test\n---\n"
+                "One [Target]({{< ref \"target.md\" >}} \"Target\") and "
+                "two [Target]({{< ref \"target.md\" >}} \"Target\")\n");
+  target = g_hash_table_lookup(pages, "Target");
+
+  g_assert_nonnull(target);
+  g_assert_cmpuint(g_hash_table_size(editor_page_get_backlinks(target)), ==,
+                   1);
+  g_assert_cmpuint(links_from(target, source), ==, 2);
+  g_assert_cmpuint(g_hash_table_size(editor_page_get_backlinks(source)), ==,
+                   0);
+
+  /* Deleting the text with the first link */
+  gtk_text_buffer_get_start_iter(source->content, &start);
+  end = start;
+  gtk_text_iter_forward_chars(&end, 5);
+  gtk_text_buffer_delete(source->content, &start, &end);
+  g_assert_cmpuint(links_from(target, source), ==, 1);
+
+  /* Releasing and restoring the buffer is not an edit */
+  gtk_text_buffer_set_modified(source->content, FALSE);
+  g_assert_true(editor_page_evict(source));
+  g_assert_cmpuint(links_from(target, source), ==, 1);
+  editor_page_restore(source);
+  g_assert_cmpuint(links_from(target, source), ==, 1);
+
+  gtk_text_buffer_set_text(source->content, "", -1);
+  g_assert_cmpuint(links_from(target, source), ==, 0);
+
+  g_hash_table_unref(pages);
+}
+
+void
+test_backlinks_evicted_rename(void)
+{
+  GHashTable *pages;
+  EditorPage *source;
+  EditorPage *target;
+  GtkTextChildAnchor *anchor;
+  GtkTextIter start;
+  GtkTextIter end;
+  GString *md;
+
+  pages = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                g_object_unref);
+
+  source = load(pages,
+                "---\ntitle: \"Source\"\ndraft: true\ntags:\n  - Test\n---\n"
+                "See [Target]({{< ref \"target.md\" >}} \"Target\")\n");
+  target = g_hash_table_lookup(pages, "Target");
+
+  gtk_text_buffer_set_modified(source->content, FALSE);
+  g_assert_true(editor_page_evict(source));
+
+  /* Renamed while the source is evicted, the way the page store rekeys */
+  g_object_set(target, "heading", "Renamed", NULL);
+  g_hash_table_steal(pages, "Target");
+  g_hash_table_insert(pages, g_strdup("Renamed"), target);
+  g_assert_cmpuint(links_from(target, source), ==, 1);
+
+  /* Saved under the new name without restoring */
+  md = editor_page_to_md(source);
+  g_assert_nonnull(strstr(md->str, "[Renamed]({{< ref \"renamed.md\" >}}"));
+  g_assert_null(strstr(md->str, "Target"));
+  g_string_free(md, TRUE);
+
+  /* Restored onto the same page, no placeholder for the old name */
+  editor_page_restore(source);
+  g_assert_cmpuint(g_hash_table_size(pages), ==, 2);
+
+  /* The anchor points at the renamed page and is counted once */
+  g_assert_cmpuint(source->anchors->len, ==, 1);
+  anchor = source->anchors->pdata[0];
+  g_assert_true(g_object_get_data(G_OBJECT(anchor), "target") == target);
+  g_assert_cmpuint(links_from(target, source), ==, 1);
+
+  /* Deleting the link takes the count down to nothing */
+  gtk_text_buffer_get_bounds(source->content, &start, &end);
+  gtk_text_buffer_delete(source->content, &start, &end);
+  g_assert_cmpuint(links_from(target, source), ==, 0);
+
+  g_hash_table_unref(pages);
+}
+
+/* The target goes first, the source still unlinks from it */
+void
+test_backlinks_release_order(void)
+{
+  GHashTable *pages;
+  EditorPage *source;
+  EditorPage *target;
+
+  pages = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                g_object_unref);
+
+  source = load(pages,
+                "---\ntitle: \"Source\"\ndraft: true\ntags:\n  - Test\n---\n"
+                "See [Target]({{< ref \"target.md\" >}} \"Target\")\n");
+  target = g_hash_table_lookup(pages, "Target");
+  g_object_add_weak_pointer(G_OBJECT(target), (gpointer *) &target);
+
+  /* Held by the link only */
+  g_hash_table_remove(pages, "Target");
+  g_assert_nonnull(target);
+  g_assert_cmpuint(links_from(target, source), ==, 1);
+
+  /* Releasing the source releases the target too */
+  g_hash_table_unref(pages);
+  g_assert_null(target);
+}
+
+int
+main(int argc, char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/links/backlinks", test_backlinks);
+  g_test_add_func("/links/backlinks/evicted-rename",
+                  test_backlinks_evicted_rename);
+  g_test_add_func("/links/backlinks/release-order",
+                  test_backlinks_release_order);
+
+  return g_test_run();
+}
@@ -0,0 +1,118 @@
+#include <glib.h>
+
+#include "markdown.h"
+
+#define ALL_TAGS_BODY                 \
+  "# Header 1\n"                      \
+  "some text\nsome more text\n\n"     \
+  "## Header 2\n"                     \
+  "And some text. **bold text**.\n"   \
+  "### Header 3\n"                    \
+  "some text\n"                       \
+  "````\nCode in monospace\n````\n"   \
+  "Ending text\n"                     \
+  "````\nCode in monospace again\n````\n"
+
+#define ALL_TAGS_JUST_TEXT        \
+  "Header 1\n"                    \
+  "some text\nsome more text\n\n" \
+  "Header 2\n"                    \
+  "And some text. bold text.\n"   \
+  "Header 3\n"                    \
+  "some text\n"                   \
+  "Code in monospace\n"           \
+  "Ending text\n"                 \
+  "Code in monospace again\n"
+
+static MarkdownSpan *
+find_span(MarkdownDoc *doc, enum markdown_span_type type, guint nth)
+{
+  for (guint i = 0; i < doc->spans->len; i++) {
+    MarkdownSpan *span = &g_array_index(doc->spans, MarkdownSpan, i);
+
+    if (span->type == type && nth-- == 0) {
+      return span;
+    }
+  }
+
+  return NULL;
+}
+
+void
+test_markdown_strip(void)
+{
+  MarkdownDoc *doc;
+
+  doc = markdown_parse(ALL_TAGS_BODY, -1);
+
+  g_assert_cmpstr(ALL_TAGS_JUST_TEXT, ==, doc->text->str);
+  g_assert_cmpuint(doc->spans->len, ==, 6);
+
+  markdown_doc_free(doc);
+}
+
+void
+test_markdown_spans(void)
+{
+  MarkdownDoc *doc;
+  MarkdownSpan *span;
+  gchar *text;
+
+  doc = markdown_parse(ALL_TAGS_BODY, -1);
+
+  span = find_span(doc, MARKDOWN_SPAN_H1, 0);
+  g_assert_nonnull(span);
+  g_assert_cmpint(span->start, ==, 0);
+  g_assert_cmpint(span->end, ==, 8);
+
+  span = find_span(doc, MARKDOWN_SPAN_BOLD, 0);
+  g_assert_nonnull(span);
+  text = g_utf8_substring(doc->text->str, span->start, span->end);
+  g_assert_cmpstr("bold text", ==, text);
+  g_free(text);
+
+  span = find_span(doc, MARKDOWN_SPAN_CODE, 1);
+  g_assert_nonnull(span);
+  text = g_utf8_substring(doc->text->str, span->start, span->end);
+  g_assert_cmpstr("Code in monospace again\n", ==, text);
+  g_free(text);
+
+  markdown_doc_free(doc);
+}
+
+void
+test_markdown_links(void)
+{
+  MarkdownDoc *doc;
+  MarkdownSpan *span;
+
+  doc = markdown_parse("See [[Other page]] and "
+                       "[Third]({{< ref \"third.md\" >}} \"Third\").\n",
+                       -1);
+
+  g_assert_cmpstr("See  and .\n", ==, doc->text->str);
+
+  span = find_span(doc, MARKDOWN_SPAN_LINK, 0);
+  g_assert_nonnull(span);
+  g_assert_cmpint(span->start, ==, 4);
+  g_assert_cmpstr("Other page", ==, span->target);
+
+  span = find_span(doc, MARKDOWN_SPAN_LINK, 1);
+  g_assert_nonnull(span);
+  g_assert_cmpint(span->start, ==, 9);
+  g_assert_cmpstr("Third", ==, span->target);
+
+  markdown_doc_free(doc);
+}
+
+int
+main(int argc, char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/markdown/strip", test_markdown_strip);
+  g_test_add_func("/markdown/spans", test_markdown_spans);
+  g_test_add_func("/markdown/links", test_markdown_links);
+
+  return g_test_run();
+}
@@ -211,6 +211,153 @@ test_match_load_strip_tags(void)
   g_object_unref(p);
 }
 
+/* Inserted the way a paste is, then the paste reported done */
+static void
+paste(EditorPage *p, const gchar *text)
+{
+  GtkTextIter end;
+
+  gtk_text_buffer_get_end_iter(p->content, &end);
+  gtk_text_buffer_insert(p->content, &end, text, -1);
+  g_signal_emit_by_name(p->content, "paste-done", NULL);
+}
+
+static gchar *
+buffer_text(EditorPage *p)
+{
+  GtkTextIter start;
+  GtkTextIter end;
+
+  gtk_text_buffer_get_bounds(p->content, &start, &end);
+  return gtk_text_buffer_get_text(p->content, &start, &end, FALSE);
+}
+
+static gboolean
+has_tag_at(EditorPage *p, gint offset, const gchar *name)
+{
+  GtkTextTagTable *table = gtk_text_buffer_get_tag_table(p->content);
+  GtkTextIter iter;
+
+  gtk_text_buffer_get_iter_at_offset(p->content, &iter, offset);
+  return gtk_text_iter_has_tag(&iter,
+                               gtk_text_tag_table_lookup(table, name));
+}
+
+void
+test_paste_styled(void)
+{
+  EditorPage *p = editor_page_new("Paste", NULL, NULL, NULL, NULL, NULL);
+  gchar *text;
+
+  paste(p, "Some **bold** text");
+
+  text = buffer_text(p);
+  g_assert_cmpstr(text, ==, "Some bold text");
+  g_assert_true(has_tag_at(p, 5, "bold"));
+  g_assert_false(has_tag_at(p, 0, "bold"));
+
+  g_free(text);
+  g_object_unref(p);
+}
+
+void
+test_paste_plain(void)
+{
+  EditorPage *p = editor_page_new("Paste", NULL, NULL, NULL, NULL, NULL);
+  GtkTextMark *mark;
+  GtkTextIter end;
+  GtkTextIter iter;
+
+  gtk_text_buffer_get_end_iter(p->content, &end);
+  gtk_text_buffer_insert(p->content, &end, "a [b c", -1);
+  gtk_text_buffer_get_iter_at_offset(p->content, &iter, 3);
+  mark = gtk_text_buffer_create_mark(p->content, NULL, &iter, TRUE);
+  g_signal_emit_by_name(p->content, "paste-done", NULL);
+
+  /* Left in place, a replaced text would have moved the mark */
+  gtk_text_buffer_get_iter_at_mark(p->content, &iter, mark);
+  g_assert_cmpint(gtk_text_iter_get_offset(&iter), ==, 3);
+
+  g_object_unref(p);
+}
+
+void
+test_paste_edited(void)
+{
+  EditorPage *p = editor_page_new("Paste", NULL, NULL, NULL, NULL, NULL);
+  GtkTextIter end;
+  gchar *text;
+
+  gtk_text_buffer_get_end_iter(p->content, &end);
+  gtk_text_buffer_insert(p->content, &end, "Some **bold** text", -1);
+
+  /* Typed before the paste could be styled */
+  gtk_text_buffer_get_end_iter(p->content, &end);
+  gtk_text_buffer_insert(p->content, &end, "!", -1);
+  g_signal_emit_by_name(p->content, "paste-done", NULL);
+
+  text = buffer_text(p);
+  g_assert_cmpstr(text, ==, "Some **bold** text!");
+
+  g_free(text);
+  g_object_unref(p);
+}
+
+/* Dropped text has no paste-done, a later paste must not take it along */
+void
+test_paste_dropped(void)
+{
+  EditorPage *p = editor_page_new("Paste", NULL, NULL, NULL, NULL, NULL);
+  GtkTextIter end;
+  gchar *text;
+
+  gtk_text_buffer_get_end_iter(p->content, &end);
+  gtk_text_buffer_insert(p->content, &end, "Some **bold** text", -1);
+
+  gtk_text_buffer_get_end_iter(p->content, &end);
+  gtk_text_buffer_insert(p->content, &end, "!", -1);
+  paste(p, " and more");
+
+  text = buffer_text(p);
+  g_assert_cmpstr(text, ==, "Some **bold** text! and more");
+
+  g_free(text);
+  g_object_unref(p);
+}
+
+void
+test_paste_worker(void)
+{
+  EditorPage *p = editor_page_new("Paste", NULL, NULL, NULL, NULL, NULL);
+  GString *md = g_string_new("");
+  gint n_chars;
+  gchar *text;
+
+  /* Large enough to be parsed in a worker */
+  while (md->len < 128 * 1024) {
+    g_string_append(md, "plain line\n");
+  }
+  g_string_append(md, "**end**");
+  n_chars = g_utf8_strlen(md->str, -1);
+
+  paste(p, md->str);
+  g_assert_cmpint(gtk_text_buffer_get_char_count(p->content), ==, n_chars);
+
+  for (guint i = 0;
+       i < 10000 && gtk_text_buffer_get_char_count(p->content) == n_chars;
+       i++) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+
+  text = buffer_text(p);
+  g_assert_true(g_str_has_suffix(text, "plain line\nend"));
+  g_assert_true(has_tag_at(p, n_chars - 7, "bold"));
+
+  g_free(text);
+  g_string_free(md, TRUE);
+  g_object_unref(p);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -225,6 +372,11 @@ main(int argc, char *argv[])
   g_test_add_func("/textbuffer/match/h3/middle", test_match_h3_middle);
   g_test_add_func("/textbuffer/match/load/strip", test_match_load_strip_tags);
   g_test_add_func("/textbuffer/match/save/unchanged", test_match_save_unchanged);
+  g_test_add_func("/textbuffer/paste/styled", test_paste_styled);
+  g_test_add_func("/textbuffer/paste/plain", test_paste_plain);
+  g_test_add_func("/textbuffer/paste/edited", test_paste_edited);
+  g_test_add_func("/textbuffer/paste/dropped", test_paste_dropped);
+  g_test_add_func("/textbuffer/paste/worker", test_paste_worker);
 
   return g_test_run();
 }
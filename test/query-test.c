@@ -0,0 +1,136 @@
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "editor_page.h"
+#include "page_query.h"
+#include "search_index.h"
+#include "tag_index.h"
+
+static EditorPage *
+add_page(TagIndex *tags,
+         SearchIndex *words,
+         const gchar *heading,
+         const gchar *tag_list,
+         gboolean draft,
+         const gchar *text)
+{
+  GPtrArray *array = g_ptr_array_new_with_free_func(
+    (GDestroyNotify) g_ref_string_release);
+  gchar **split = g_strsplit(tag_list, ",", -1);
+  EditorPage *page;
+
+  for (guint i = 0; split[i] != NULL; i++) {
+    g_ptr_array_add(array, g_ref_string_new_intern(split[i]));
+  }
+  g_strfreev(split);
+
+  page = editor_page_new(heading, array, NULL, NULL, NULL, NULL);
+  tag_index_set_page_tags(tags, page, page->tags);
+  tag_index_set_page_draft(tags, page, draft);
+  search_index_set_page(words, page, search_doc_new(text, -1));
+
+  return page;
+}
+
+static gchar *
+headings(TagIndex *tags, SearchIndex *words, const gchar *query)
+{
+  GListModel *res;
+  GString *out = g_string_new("");
+
+  res = page_query_run(query, tags, words, NULL);
+  g_assert_nonnull(res);
+
+  for (guint i = 0; i < g_list_model_get_n_items(res); i++) {
+    EditorPage *page = g_list_model_get_item(res, i);
+
+    g_string_append_printf(out, "%s%s", i > 0 ? "," : "", page->heading);
+    g_object_unref(page);
+  }
+  g_object_unref(res);
+
+  return g_string_free(out, FALSE);
+}
+
+#define assert_query(query, expected)                    \
+  G_STMT_START                                           \
+  {                                                      \
+    gchar *got = headings(tags, words, query);           \
+    g_assert_cmpstr(got, ==, expected);                  \
+    g_free(got);                                         \
+  }                                                      \
+  G_STMT_END
+
+void
+test_query_predicates(void)
+{
+  TagIndex *tags = tag_index_new();
+  SearchIndex *words = search_index_new();
+  EditorPage *pages[4];
+
+  pages[0] = add_page(tags, words, "Budget", "meeting,finance", TRUE,
+                      "Budget for Q3, the budget is tight");
+  pages[1] = add_page(tags, words, "Standup", "meeting", TRUE,
+                      "Nothing about money");
+  pages[2] = add_page(tags, words, "Retro", "meeting", FALSE,
+                      "The budget came up once");
+  pages[3] = add_page(tags, words, "Recipes", "home", FALSE, "Bread");
+
+  assert_query("tag:meeting draft:true text:'budget'", "Budget");
+  assert_query("tag:meeting text:budget", "Budget,Retro");
+  assert_query("tag:meeting -text:budget", "Standup");
+  assert_query("draft:false", "Recipes,Retro");
+  assert_query("-tag:meeting", "Recipes");
+  assert_query("tag:missing text:budget", "");
+  assert_query("TAG:Meeting", "");
+  assert_query("text:\"the budget\"", "Budget,Retro");
+
+  for (guint i = 0; i < G_N_ELEMENTS(pages); i++) {
+    g_object_unref(pages[i]);
+  }
+  search_index_free(words);
+  tag_index_free(tags);
+}
+
+void
+test_query_syntax(void)
+{
+  TagIndex *tags = tag_index_new();
+  SearchIndex *words = search_index_new();
+  GError *lerr = NULL;
+  GListModel *res;
+
+  g_assert_true(page_query_is_structured("tag:work"));
+  g_assert_true(page_query_is_structured("budget -draft:true"));
+  g_assert_false(page_query_is_structured("budget plan"));
+  g_assert_false(page_query_is_structured("foo_bar:baz"));
+
+  res = page_query_run("text:'budget", tags, words, &lerr);
+  g_assert_null(res);
+  g_assert_error(lerr, PAGE_QUERY_ERROR, PAGE_QUERY_ERROR_SYNTAX);
+  g_clear_error(&lerr);
+
+  res = page_query_run("draft:maybe", tags, words, &lerr);
+  g_assert_null(res);
+  g_assert_error(lerr, PAGE_QUERY_ERROR, PAGE_QUERY_ERROR_SYNTAX);
+  g_clear_error(&lerr);
+
+  res = page_query_run("tag:", tags, words, &lerr);
+  g_assert_null(res);
+  g_assert_error(lerr, PAGE_QUERY_ERROR, PAGE_QUERY_ERROR_SYNTAX);
+  g_clear_error(&lerr);
+
+  search_index_free(words);
+  tag_index_free(tags);
+}
+
+int
+main(int argc, char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/query/predicates", test_query_predicates);
+  g_test_add_func("/query/syntax", test_query_syntax);
+
+  return g_test_run();
+}
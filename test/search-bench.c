@@ -0,0 +1,282 @@
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <string.h>
+
+#include "editor_page.h"
+#include "search_index.h"
+#include "trigram_index.h"
+
+/* Substring queries answered by the trigram index against scanning the text
+ * of every page buffer, the way a search without an index would. Both have
+ * to agree on every query, so this doubles as a check of the index. */
+
+static gint n_pages = 2000;
+static gint page_lines = 200;
+static gint n_queries = 200;
+static gint seed = 42;
+
+static GOptionEntry entries[] = {
+  { "pages", 'p', 0, G_OPTION_ARG_INT, &n_pages, "Number of pages", "N" },
+  { "lines", 'l', 0, G_OPTION_ARG_INT, &page_lines,
+    "Lines of markdown in each page", "N" },
+  { "queries", 'q', 0, G_OPTION_ARG_INT, &n_queries, "Number of queries",
+    "N" },
+  { "seed", 's', 0, G_OPTION_ARG_INT, &seed, "Seed for pages and queries",
+    "N" },
+  { NULL }
+};
+
+static EditorPage *
+fetch_page(G_GNUC_UNUSED const gchar *heading,
+           G_GNUC_UNUSED gpointer user_data)
+{
+  return NULL;
+}
+
+static gchar *
+build_page(GRand *rand, gint n, gint lines)
+{
+  GString *md = g_string_new("");
+
+  /* Unique headings, equal hits are ordered by heading */
+  g_string_append_printf(md, "---\ntitle: \"Benchmark %d\"\ndraft: true\n"
+                             "tags:\n  - Bench\n---\n",
+                         n);
+
+  for (gint i = 0; i < lines; i++) {
+    switch (i % 10) {
+    case 0:
+      g_string_append_printf(md, "## Section %d\n", i / 10);
+      break;
+    case 4:
+      g_string_append_printf(md, "````\nret = handler_%d(ctx->slot[%d]);\n"
+                                 "````\n",
+                             g_rand_int_range(rand, 0, 5000),
+                             g_rand_int_range(rand, 0, 16));
+      break;
+    case 7:
+      g_string_append_printf(md, "Config lives in /etc/app/mod%d.conf\n",
+                             g_rand_int_range(rand, 0, 5000));
+      break;
+    default:
+      g_string_append(md, "Lorem ipsum dolor sit amet, consectetur "
+                          "adipiscing elit, sed do eiusmod tempor.\n");
+      break;
+    }
+  }
+
+  return g_string_free(md, FALSE);
+}
+
+static gchar *
+buffer_text(EditorPage *page, G_GNUC_UNUSED gpointer user_data)
+{
+  return editor_page_get_text(page);
+}
+
+static guint
+count_in(const gchar *haystack, const gchar *needle)
+{
+  gsize len = strlen(needle);
+  guint hits = 0;
+
+  for (const gchar *found = strstr(haystack, needle); found != NULL;
+       found = strstr(found + len, needle)) {
+    hits++;
+  }
+
+  return hits;
+}
+
+/* What searching costs without an index */
+static GArray *
+brute_force(GPtrArray *pages, const gchar *needle)
+{
+  GArray *res = g_array_new(FALSE, FALSE, sizeof(SearchResult));
+  gchar *folded = g_ascii_strdown(needle, -1);
+
+  for (guint i = 0; i < pages->len; i++) {
+    EditorPage *page = pages->pdata[i];
+    gchar *text = buffer_text(page, NULL);
+    gchar *lower = g_ascii_strdown(text, -1);
+    SearchResult result = { page, count_in(lower, folded) };
+
+    if (result.hits > 0) {
+      g_array_append_val(res, result);
+    }
+
+    g_free(lower);
+    g_free(text);
+  }
+
+  search_results_sort(res);
+  g_free(folded);
+  return res;
+}
+
+static gboolean
+same_results(GArray *a, GArray *b)
+{
+  if (a->len != b->len) {
+    return FALSE;
+  }
+
+  for (guint i = 0; i < a->len; i++) {
+    SearchResult *ra = &g_array_index(a, SearchResult, i);
+    SearchResult *rb = &g_array_index(b, SearchResult, i);
+
+    if (ra->page != rb->page || ra->hits != rb->hits) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static gint
+double_cmp(gconstpointer a, gconstpointer b)
+{
+  gdouble da = *((gdouble *) a);
+  gdouble db = *((gdouble *) b);
+
+  return (da > db) - (da < db);
+}
+
+static void
+report(const gchar *name, GArray *samples)
+{
+  gdouble p50;
+  gdouble p99;
+  gdouble max;
+
+  if (samples->len == 0) {
+    return;
+  }
+
+  g_array_sort(samples, double_cmp);
+
+  p50 = g_array_index(samples, gdouble, samples->len / 2);
+  p99 = g_array_index(samples, gdouble, (samples->len * 99) / 100);
+  max = g_array_index(samples, gdouble, samples->len - 1);
+
+  g_print("%-8s %8u queries  p50 %10.2f us  p99 %10.2f us  max %10.2f us\n",
+          name, samples->len, p50 * G_USEC_PER_SEC, p99 * G_USEC_PER_SEC,
+          max * G_USEC_PER_SEC);
+}
+
+static gchar *
+random_query(GRand *rand)
+{
+  switch (g_rand_int_range(rand, 0, 4)) {
+  case 0:
+    return g_strdup_printf("handler_%d(", g_rand_int_range(rand, 0, 5000));
+  case 1:
+    return g_strdup_printf("/mod%d.conf", g_rand_int_range(rand, 0, 5000));
+  case 2:
+    return g_strdup_printf("slot[%d]", g_rand_int_range(rand, 0, 16));
+  default:
+    /* Has every trigram in most pages, but never in that order */
+    return g_strdup("tempor.\nlorem");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  GError *lerr = NULL;
+  GOptionContext *context;
+  TrigramIndex *index;
+  GPtrArray *pages;
+  GArray *samples_index;
+  GArray *samples_scan;
+  GTimer *timer;
+  GRand *rand;
+  GtkTextIter end;
+  gchar *text;
+  gint ret = 0;
+
+  context = g_option_context_new("- substring search with and without index");
+  g_option_context_add_main_entries(context, entries, NULL);
+  if (!g_option_context_parse(context, &argc, &argv, &lerr)) {
+    g_printerr("%s\n", lerr->message);
+    g_clear_error(&lerr);
+    return 1;
+  }
+  g_option_context_free(context);
+
+  rand = g_rand_new_with_seed(seed);
+  pages = g_ptr_array_new_with_free_func(g_object_unref);
+
+  for (gint i = 0; i < n_pages; i++) {
+    gchar *md = build_page(rand, i, page_lines);
+
+    g_ptr_array_add(pages, editor_page_load(md, fetch_page, NULL, NULL, NULL));
+    g_free(md);
+  }
+
+  index = trigram_index_new(buffer_text, NULL);
+  timer = g_timer_new();
+
+  for (guint i = 0; i < pages->len; i++) {
+    text = buffer_text(pages->pdata[i], NULL);
+    trigram_index_set_page(index, pages->pdata[i], trigram_doc_new(text, -1));
+    g_free(text);
+  }
+
+  g_print("Indexed %u pages, %u trigrams in %.1f ms\n", pages->len,
+          trigram_index_n_trigrams(index),
+          g_timer_elapsed(timer, NULL) * 1000);
+
+  samples_index = g_array_new(FALSE, FALSE, sizeof(gdouble));
+  samples_scan = g_array_new(FALSE, FALSE, sizeof(gdouble));
+
+  for (gint i = 0; i < n_queries; i++) {
+    gchar *query = random_query(rand);
+    GArray *indexed;
+    GArray *scanned;
+    gdouble elapsed;
+
+    g_timer_start(timer);
+    indexed = trigram_index_query(index, query);
+    elapsed = g_timer_elapsed(timer, NULL);
+    g_array_append_val(samples_index, elapsed);
+
+    g_timer_start(timer);
+    scanned = brute_force(pages, query);
+    elapsed = g_timer_elapsed(timer, NULL);
+    g_array_append_val(samples_scan, elapsed);
+
+    if (!same_results(indexed, scanned)) {
+      g_printerr("Results differ for \"%s\": %u indexed, %u scanned\n", query,
+                 indexed->len, scanned->len);
+      ret = 1;
+    }
+
+    g_array_unref(indexed);
+    g_array_unref(scanned);
+    g_free(query);
+  }
+
+  report("index", samples_index);
+  report("scan", samples_scan);
+
+  /* Typing in one page and reindexing it only touches its changed trigrams */
+  gtk_text_buffer_get_end_iter(EDITOR_PAGE(pages->pdata[0])->content, &end);
+  gtk_text_buffer_insert(EDITOR_PAGE(pages->pdata[0])->content, &end,
+                         "unique_marker_xyz\n", -1);
+  g_timer_start(timer);
+  text = buffer_text(pages->pdata[0], NULL);
+  trigram_index_set_page(index, pages->pdata[0], trigram_doc_new(text, -1));
+  g_free(text);
+  g_print("Reindexed one page in %.2f us\n",
+          g_timer_elapsed(timer, NULL) * G_USEC_PER_SEC);
+
+  g_array_unref(samples_index);
+  g_array_unref(samples_scan);
+  g_timer_destroy(timer);
+  trigram_index_free(index);
+  g_ptr_array_unref(pages);
+  g_rand_free(rand);
+
+  return ret;
+}
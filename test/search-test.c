@@ -0,0 +1,298 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+#include "editor_page.h"
+#include "search_cache.h"
+#include "search_index.h"
+#include "trigram_index.h"
+
+void
+test_search_query(void)
+{
+  SearchIndex *index;
+  EditorPage *budget;
+  EditorPage *meeting;
+  GArray *res;
+
+  index = search_index_new();
+  budget = editor_page_new("Budget", NULL, NULL, NULL, NULL, NULL);
+  meeting = editor_page_new("Meeting", NULL, NULL, NULL, NULL, NULL);
+
+  search_index_set_page(index, budget,
+                        search_doc_new("The budget for Q3, budget again", -1));
+  search_index_set_page(index, meeting,
+                        search_doc_new("Meeting about the Budget", -1));
+
+  res = search_index_query(index, "budget");
+  g_assert_cmpuint(res->len, ==, 2);
+  /* Most hits first */
+  g_assert_true(g_array_index(res, SearchResult, 0).page == budget);
+  g_assert_cmpuint(g_array_index(res, SearchResult, 0).hits, ==, 2);
+  g_array_unref(res);
+
+  res = search_index_query(index, "BUDGET meeting");
+  g_assert_cmpuint(res->len, ==, 1);
+  g_assert_true(g_array_index(res, SearchResult, 0).page == meeting);
+  g_array_unref(res);
+
+  res = search_index_query(index, "budget missing");
+  g_assert_cmpuint(res->len, ==, 0);
+  g_array_unref(res);
+
+  search_index_free(index);
+  g_object_unref(budget);
+  g_object_unref(meeting);
+}
+
+void
+test_search_reindex(void)
+{
+  SearchIndex *index;
+  EditorPage *page;
+  GArray *res;
+
+  index = search_index_new();
+  page = editor_page_new("Page", NULL, NULL, NULL, NULL, NULL);
+
+  search_index_set_page(index, page, search_doc_new("old words", -1));
+  search_index_set_page(index, page, search_doc_new("new words", -1));
+
+  res = search_index_query(index, "old");
+  g_assert_cmpuint(res->len, ==, 0);
+  g_array_unref(res);
+
+  res = search_index_query(index, "new");
+  g_assert_cmpuint(res->len, ==, 1);
+  g_array_unref(res);
+
+  search_index_remove_page(index, page);
+  g_assert_cmpuint(search_index_n_terms(index), ==, 0);
+
+  search_index_free(index);
+  g_object_unref(page);
+}
+
+/* The trigram index keeps no text, the pages of these tests carry it */
+static gchar *
+doc_text(EditorPage *page, G_GNUC_UNUSED gpointer user_data)
+{
+  return g_strdup(g_object_get_data(G_OBJECT(page), "text"));
+}
+
+static void
+index_text(TrigramIndex *index, EditorPage *page, const gchar *text)
+{
+  g_object_set_data_full(G_OBJECT(page), "text", g_strdup(text), g_free);
+  trigram_index_set_page(index, page, trigram_doc_new(text, -1));
+}
+
+static gchar *
+page_text(EditorPage *page, G_GNUC_UNUSED gpointer user_data)
+{
+  return editor_page_get_text(page);
+}
+
+void
+test_trigram_query(void)
+{
+  TrigramIndex *index;
+  EditorPage *code;
+  EditorPage *prose;
+  GArray *res;
+
+  index = trigram_index_new(doc_text, NULL);
+  code = editor_page_new("Code", NULL, NULL, NULL, NULL, NULL);
+  prose = editor_page_new("Prose", NULL, NULL, NULL, NULL, NULL);
+
+  index_text(index, code, "ret = ctx->slot[3]; /etc/App.conf");
+  index_text(index, prose, "slot three, ctx and etc");
+
+  res = trigram_index_query(index, "ctx->slot[");
+  g_assert_cmpuint(res->len, ==, 1);
+  g_assert_true(g_array_index(res, SearchResult, 0).page == code);
+  g_array_unref(res);
+
+  res = trigram_index_query(index, "/ETC/app");
+  g_assert_cmpuint(res->len, ==, 1);
+  g_array_unref(res);
+
+  /* Every trigram is in the prose page, but not in this order */
+  res = trigram_index_query(index, "slot[3]; /etc and");
+  g_assert_cmpuint(res->len, ==, 0);
+  g_array_unref(res);
+
+  /* Shorter than a trigram, every page would have to be checked */
+  res = trigram_index_query(index, "et");
+  g_assert_cmpuint(res->len, ==, 0);
+  g_array_unref(res);
+
+  trigram_index_free(index);
+  g_object_unref(code);
+  g_object_unref(prose);
+}
+
+void
+test_trigram_update(void)
+{
+  TrigramIndex *index;
+  EditorPage *page;
+  GArray *res;
+
+  index = trigram_index_new(doc_text, NULL);
+  page = editor_page_new("Page", NULL, NULL, NULL, NULL, NULL);
+
+  index_text(index, page, "call foo_bar()");
+  index_text(index, page, "call foo_baz()");
+
+  res = trigram_index_query(index, "foo_bar");
+  g_assert_cmpuint(res->len, ==, 0);
+  g_array_unref(res);
+
+  res = trigram_index_query(index, "foo_baz(");
+  g_assert_cmpuint(res->len, ==, 1);
+  g_array_unref(res);
+
+  trigram_index_remove_page(index, page);
+  g_assert_cmpuint(trigram_index_n_trigrams(index), ==, 0);
+
+  trigram_index_free(index);
+  g_object_unref(page);
+}
+
+/* Candidates are checked against the page, also once it is evicted */
+void
+test_trigram_evicted(void)
+{
+  TrigramIndex *index;
+  EditorPage *page;
+  GArray *res;
+  gchar *content;
+  gchar *text;
+  gchar *stored;
+
+  index = trigram_index_new(page_text, NULL);
+  content = g_strdup("---\ntitle: \"Page\"\ndraft: true\ntags:\n---\n"
+                     "call **foo_bar**(ctx)\n");
+  page = editor_page_load(content, NULL, NULL, NULL, NULL);
+  editor_page_fix_content(page);
+  gtk_text_buffer_set_modified(page->content, FALSE);
+
+  text = editor_page_get_text(page);
+  trigram_index_set_page(index, page, trigram_doc_new(text, -1));
+  g_assert_true(editor_page_evict(page));
+
+  /* The stored body still has the markup, the text does not */
+  stored = editor_page_get_text(page);
+  g_assert_cmpstr(stored, ==, text);
+  g_free(stored);
+
+  res = trigram_index_query(index, "FOO_BAR(ctx");
+  g_assert_cmpuint(res->len, ==, 1);
+  g_array_unref(res);
+
+  res = trigram_index_query(index, "**foo");
+  g_assert_cmpuint(res->len, ==, 0);
+  g_array_unref(res);
+
+  trigram_index_free(index);
+  g_object_unref(page);
+  g_free(content);
+  g_free(text);
+}
+
+void
+test_search_cache(void)
+{
+  SearchStamp stamp = { G_GINT64_CONSTANT(1700000000) * G_USEC_PER_SEC, 42 };
+  SearchStamp changed = { G_GINT64_CONSTANT(1700000001) * G_USEC_PER_SEC,
+                          42 };
+  SearchCache *cache;
+  SearchIndex *index;
+  TrigramIndex *trigrams;
+  SearchDoc *doc;
+  TrigramDoc *grams;
+  EditorPage *budget;
+  EditorPage *meeting;
+  GArray *positions;
+  gchar *root;
+  gchar *path;
+
+  root = g_dir_make_tmp("search-cache-XXXXXX", NULL);
+  g_assert_nonnull(root);
+
+  index = search_index_new();
+  budget = editor_page_new("Budget", NULL, NULL, NULL, NULL, NULL);
+  meeting = editor_page_new("Meeting", NULL, NULL, NULL, NULL, NULL);
+  search_index_set_page(index, budget,
+                        search_doc_new("The budget for Q3, budget again", -1));
+  search_index_set_page(index, meeting,
+                        search_doc_new("Meeting about the Budget", -1));
+  trigrams = trigram_index_new(doc_text, NULL);
+  index_text(trigrams, budget, "The budget for Q3, budget again");
+  index_text(trigrams, meeting, "Meeting about the Budget");
+
+  cache = search_cache_new(root);
+  search_cache_stamp(cache, budget, "budget.md", &stamp);
+  search_cache_stamp(cache, meeting, "meeting.md", &stamp);
+  g_assert_true(search_cache_write(cache, index, trigrams, NULL));
+  search_cache_free(cache);
+
+  cache = search_cache_new(root);
+  doc = search_cache_lookup(cache, "budget.md", &stamp);
+  g_assert_nonnull(doc);
+  positions = g_hash_table_lookup(doc->terms, "budget");
+  g_assert_nonnull(positions);
+  g_assert_cmpuint(positions->len, ==, 2);
+  g_assert_cmpuint(g_array_index(positions, guint32, 0), ==, 1);
+  g_assert_cmpuint(g_array_index(positions, guint32, 1), ==, 4);
+  g_assert_cmpuint(g_hash_table_size(doc->terms), ==, 5);
+  search_doc_free(doc);
+
+  /* The trigrams come back as they were, no need to parse the file */
+  grams = search_cache_lookup_trigrams(cache, "meeting.md", &stamp);
+  g_assert_nonnull(grams);
+  g_assert_cmpmem(grams->trigrams->data,
+                  grams->trigrams->len * sizeof(guint32),
+                  trigram_index_get_trigrams(trigrams, meeting)->data,
+                  trigram_index_get_trigrams(trigrams, meeting)->len *
+                    sizeof(guint32));
+  trigram_doc_free(grams);
+
+  /* Changed on disk since it was indexed */
+  g_assert_null(search_cache_lookup(cache, "meeting.md", &changed));
+  g_assert_null(search_cache_lookup_trigrams(cache, "meeting.md", &changed));
+  g_assert_null(search_cache_lookup(cache, "missing.md", &stamp));
+  search_cache_free(cache);
+
+  /* Anything that is not a cache is an empty one */
+  path = g_build_filename(root, SEARCH_CACHE_FILE, NULL);
+  g_assert_true(g_file_set_contents(path, "NEINDEX", -1, NULL));
+  cache = search_cache_new(root);
+  g_assert_null(search_cache_lookup(cache, "budget.md", &stamp));
+  search_cache_free(cache);
+
+  g_remove(path);
+  g_rmdir(root);
+  g_free(path);
+  g_free(root);
+  trigram_index_free(trigrams);
+  search_index_free(index);
+  g_object_unref(budget);
+  g_object_unref(meeting);
+}
+
+int
+main(int argc, char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/search/query", test_search_query);
+  g_test_add_func("/search/reindex", test_search_reindex);
+  g_test_add_func("/search/trigram-query", test_trigram_query);
+  g_test_add_func("/search/trigram-update", test_trigram_update);
+  g_test_add_func("/search/trigram-evicted", test_trigram_evicted);
+  g_test_add_func("/search/cache", test_search_cache);
+
+  return g_test_run();
+}
@@ -0,0 +1,116 @@
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "editor_page.h"
+#include "notes_page_store.h"
+
+/* Builds the page store the way loading a workspace does, one page at a
+ * time in the order the folder lists them, and times the adds. */
+
+static gint n_pages = 10000;
+static gint seed = 42;
+
+static GOptionEntry entries[] = {
+  { "pages", 'p', 0, G_OPTION_ARG_INT, &n_pages, "Pages to load", "N" },
+  { "seed", 's', 0, G_OPTION_ARG_INT, &seed, "Seed for the headings", "N" },
+  { NULL }
+};
+
+/* The store prints every page it adds, which would drown the timings */
+static void
+quiet_print(G_GNUC_UNUSED const gchar *string)
+{
+}
+
+static void
+count_change(G_GNUC_UNUSED GListModel *model,
+             G_GNUC_UNUSED guint position,
+             G_GNUC_UNUSED guint removed,
+             G_GNUC_UNUSED guint added,
+             guint *n_changes)
+{
+  (*n_changes)++;
+}
+
+static gboolean
+check_sorted(NotesPageStore *store)
+{
+  GListModel *model = G_LIST_MODEL(store);
+  EditorPage *prev = NULL;
+  gboolean res = TRUE;
+
+  for (guint i = 0; i < g_list_model_get_n_items(model) && res; i++) {
+    EditorPage *page = g_list_model_get_item(model, i);
+
+    if (page->sort_rank == 0) {
+      res = prev == NULL || editor_page_cmp(prev, page) <= 0;
+      g_set_object(&prev, page);
+    }
+    g_object_unref(page);
+  }
+
+  g_clear_object(&prev);
+  return res;
+}
+
+int
+main(int argc, char *argv[])
+{
+  GError *lerr = NULL;
+  GOptionContext *context;
+  NotesPageStore *store;
+  GPtrArray *pages;
+  GTimer *timer;
+  GRand *rand;
+  GPrintFunc print;
+  guint n_changes = 0;
+  gdouble elapsed;
+
+  context = g_option_context_new("- loading pages into the page store");
+  g_option_context_add_main_entries(context, entries, NULL);
+  if (!g_option_context_parse(context, &argc, &argv, &lerr)) {
+    g_printerr("%s\n", lerr->message);
+    g_clear_error(&lerr);
+    return 1;
+  }
+  g_option_context_free(context);
+
+  /* Folder order has nothing to do with heading order */
+  rand = g_rand_new_with_seed(seed);
+  pages = g_ptr_array_new_with_free_func(g_object_unref);
+  for (gint i = 0; i < n_pages; i++) {
+    gchar *heading = g_strdup_printf("Page %08x %d", g_rand_int(rand), i);
+
+    g_ptr_array_add(pages, editor_page_new(heading, NULL, NULL, NULL, NULL,
+                                           NULL));
+    g_free(heading);
+  }
+
+  store = notes_page_store_new();
+  g_signal_connect(store, "items-changed", G_CALLBACK(count_change),
+                   &n_changes);
+
+  print = g_set_print_handler(quiet_print);
+  timer = g_timer_new();
+  for (guint i = 0; i < pages->len; i++) {
+    notes_page_store_add(store, pages->pdata[i]);
+  }
+  elapsed = g_timer_elapsed(timer, NULL);
+  g_set_print_handler(print);
+
+  g_print("add      %8d pages  %10.2f ms  %8.2f us/page  %u changes\n",
+          n_pages, elapsed * 1000, elapsed * 1e6 / MAX(n_pages, 1),
+          n_changes);
+
+  if (!check_sorted(store)) {
+    g_printerr("Store is not sorted\n");
+    return 1;
+  }
+
+  g_timer_destroy(timer);
+  g_object_unref(store);
+  g_ptr_array_unref(pages);
+  g_rand_free(rand);
+
+  return 0;
+}
@@ -0,0 +1,230 @@
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "editor_page.h"
+#include "notes_page_store.h"
+
+typedef struct {
+  guint position;
+  guint removed;
+  guint added;
+} Change;
+
+static void
+record_change(G_GNUC_UNUSED GListModel *model,
+              guint position,
+              guint removed,
+              guint added,
+              GArray *changes)
+{
+  Change change = { position, removed, added };
+
+  g_array_append_val(changes, change);
+}
+
+static void
+assert_change(GArray *changes,
+              guint i,
+              guint position,
+              guint removed,
+              guint added)
+{
+  Change *change;
+
+  g_assert_cmpuint(i, <, changes->len);
+  change = &g_array_index(changes, Change, i);
+  g_assert_cmpuint(change->position, ==, position);
+  g_assert_cmpuint(change->removed, ==, removed);
+  g_assert_cmpuint(change->added, ==, added);
+}
+
+static const gchar *
+heading_at(NotesPageStore *store, guint position)
+{
+  EditorPage *page = g_list_model_get_item(G_LIST_MODEL(store), position);
+  const gchar *res = page->heading;
+
+  g_object_unref(page);
+  return res;
+}
+
+void
+test_store_add(void)
+{
+  NotesPageStore *store = notes_page_store_new();
+  GArray *changes = g_array_new(FALSE, FALSE, sizeof(Change));
+  const gchar *headings[] = { "Delta", "Alpha", "Charlie", "Bravo" };
+  EditorPage *pages[G_N_ELEMENTS(headings)];
+
+  g_signal_connect(store, "items-changed", G_CALLBACK(record_change),
+                   changes);
+
+  for (guint i = 0; i < G_N_ELEMENTS(headings); i++) {
+    pages[i] = editor_page_new(headings[i], NULL, NULL, NULL, NULL, NULL);
+    notes_page_store_add(store, pages[i]);
+  }
+
+  /* Each page is one insertion where it sorts, after the two actions */
+  g_assert_cmpuint(changes->len, ==, 4);
+  assert_change(changes, 0, 2, 0, 1);
+  assert_change(changes, 1, 2, 0, 1);
+  assert_change(changes, 2, 3, 0, 1);
+  assert_change(changes, 3, 3, 0, 1);
+
+  g_assert_cmpstr(heading_at(store, 2), ==, "Alpha");
+  g_assert_cmpstr(heading_at(store, 5), ==, "Delta");
+
+  g_object_unref(store);
+  for (guint i = 0; i < G_N_ELEMENTS(pages); i++) {
+    g_object_unref(pages[i]);
+  }
+  g_array_unref(changes);
+}
+
+void
+test_store_rename(void)
+{
+  NotesPageStore *store = notes_page_store_new();
+  GArray *changes = g_array_new(FALSE, FALSE, sizeof(Change));
+  const gchar *headings[] = { "Alpha", "Bravo", "Charlie", "Delta" };
+  EditorPage *pages[G_N_ELEMENTS(headings)];
+
+  for (guint i = 0; i < G_N_ELEMENTS(headings); i++) {
+    pages[i] = editor_page_new(headings[i], NULL, NULL, NULL, NULL, NULL);
+    notes_page_store_add(store, pages[i]);
+  }
+
+  g_signal_connect(store, "items-changed", G_CALLBACK(record_change),
+                   changes);
+
+  /* Stays in place, the row relabels itself */
+  g_object_set(pages[1], "heading", "Bravo two", NULL);
+  g_assert_cmpuint(changes->len, ==, 0);
+
+  /* Alpha goes last, one removal and one insertion */
+  g_object_set(pages[0], "heading", "Echo", NULL);
+  g_assert_cmpuint(changes->len, ==, 2);
+  assert_change(changes, 0, 2, 1, 0);
+  assert_change(changes, 1, 5, 0, 1);
+  g_assert_cmpstr(heading_at(store, 2), ==, "Bravo two");
+  g_assert_cmpstr(heading_at(store, 5), ==, "Echo");
+
+  g_object_unref(store);
+  for (guint i = 0; i < G_N_ELEMENTS(pages); i++) {
+    g_object_unref(pages[i]);
+  }
+  g_array_unref(changes);
+}
+
+void
+test_store_bulk(void)
+{
+  NotesPageStore *store = notes_page_store_new();
+  GArray *changes = g_array_new(FALSE, FALSE, sizeof(Change));
+  const gchar *headings[] = { "Delta", "Alpha", "Charlie", "Bravo" };
+  EditorPage *pages[G_N_ELEMENTS(headings)];
+
+  g_signal_connect(store, "items-changed", G_CALLBACK(record_change),
+                   changes);
+
+  notes_page_store_begin_update(store);
+  notes_page_store_begin_update(store);
+  for (guint i = 0; i < G_N_ELEMENTS(headings); i++) {
+    pages[i] = editor_page_new(headings[i], NULL, NULL, NULL, NULL, NULL);
+    notes_page_store_add(store, pages[i]);
+  }
+  notes_page_store_end_update(store);
+
+  /* Held back, but found by heading */
+  g_assert_cmpuint(changes->len, ==, 0);
+  g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(store)), ==, 2);
+  g_assert_true(notes_page_store_find(store, "Charlie") == pages[2]);
+
+  /* All pages in one insertion after the two actions */
+  notes_page_store_end_update(store);
+  g_assert_cmpuint(changes->len, ==, 1);
+  assert_change(changes, 0, 2, 0, 4);
+  g_assert_cmpstr(heading_at(store, 2), ==, "Alpha");
+  g_assert_cmpstr(heading_at(store, 5), ==, "Delta");
+
+  g_object_unref(store);
+  for (guint i = 0; i < G_N_ELEMENTS(pages); i++) {
+    g_object_unref(pages[i]);
+  }
+  g_array_unref(changes);
+}
+
+void
+test_store_collate(void)
+{
+  NotesPageStore *store = notes_page_store_new();
+  const gchar *headings[] = { "zebra", "\xc3\x89mile", "Banana", "apple" };
+  EditorPage *pages[G_N_ELEMENTS(headings)];
+
+  for (guint i = 0; i < G_N_ELEMENTS(headings); i++) {
+    pages[i] = editor_page_new(headings[i], NULL, NULL, NULL, NULL, NULL);
+    notes_page_store_add(store, pages[i]);
+  }
+
+  /* Case and accents do not count */
+  g_assert_cmpstr(heading_at(store, 2), ==, "apple");
+  g_assert_cmpstr(heading_at(store, 3), ==, "Banana");
+  g_assert_cmpstr(heading_at(store, 4), ==, "\xc3\x89mile");
+  g_assert_cmpstr(heading_at(store, 5), ==, "zebra");
+
+  /* The key follows a rename */
+  g_object_set(pages[0], "heading", "Aardvark", NULL);
+  g_assert_cmpstr(heading_at(store, 2), ==, "Aardvark");
+  g_assert_cmpint(editor_page_cmp(pages[0], pages[3]), <, 0);
+
+  g_object_unref(store);
+  for (guint i = 0; i < G_N_ELEMENTS(pages); i++) {
+    g_object_unref(pages[i]);
+  }
+}
+
+void
+test_store_find(void)
+{
+  NotesPageStore *store = notes_page_store_new();
+  EditorPage *first = editor_page_new("Same", NULL, NULL, NULL, NULL, NULL);
+  EditorPage *second = editor_page_new("Same", NULL, NULL, NULL, NULL, NULL);
+  EditorPage *held;
+
+  notes_page_store_add(store, first);
+  notes_page_store_add(store, second);
+  g_assert_true(notes_page_store_find(store, "Same") == first);
+  g_assert_null(notes_page_store_find(store, "Other"));
+
+  /* Found under the new heading only, the other page takes the old one */
+  g_object_set(first, "heading", "Other", NULL);
+  g_assert_true(notes_page_store_find(store, "Other") == first);
+  g_assert_true(notes_page_store_find(store, "Same") == second);
+
+  /* Held back pages are found before the update ends */
+  notes_page_store_begin_update(store);
+  held = editor_page_new("Held", NULL, NULL, NULL, NULL, NULL);
+  notes_page_store_add(store, held);
+  g_assert_true(notes_page_store_find(store, "Held") == held);
+  notes_page_store_end_update(store);
+  g_assert_true(notes_page_store_find(store, "Held") == held);
+
+  g_object_unref(store);
+  g_object_unref(first);
+  g_object_unref(second);
+  g_object_unref(held);
+}
+
+int
+main(int argc, char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/store/add", test_store_add);
+  g_test_add_func("/store/rename", test_store_rename);
+  g_test_add_func("/store/bulk", test_store_bulk);
+  g_test_add_func("/store/collate", test_store_collate);
+  g_test_add_func("/store/find", test_store_find);
+
+  return g_test_run();
+}
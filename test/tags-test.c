@@ -0,0 +1,320 @@
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "editor_page.h"
+#include "notes_tag.h"
+#include "tag_index.h"
+
+static EditorPage *
+tagged(TagIndex *index, const gchar *heading, const gchar *tags)
+{
+  GPtrArray *array = g_ptr_array_new_with_free_func(
+    (GDestroyNotify) g_ref_string_release);
+  gchar **split = g_strsplit(tags, ",", -1);
+  EditorPage *page;
+
+  for (guint i = 0; split[i] != NULL; i++) {
+    g_ptr_array_add(array, g_ref_string_new_intern(split[i]));
+  }
+  g_strfreev(split);
+
+  page = editor_page_new(heading, array, NULL, NULL, NULL, NULL);
+  tag_index_set_page_tags(index, page, page->tags);
+
+  return page;
+}
+
+static guint
+count(TagIndex *index, const gchar *expr)
+{
+  GPtrArray *pages;
+  guint res;
+
+  pages = tag_index_filter(index, expr, NULL);
+  g_assert_nonnull(pages);
+  res = pages->len;
+  g_ptr_array_unref(pages);
+
+  return res;
+}
+
+void
+test_tags_filter(void)
+{
+  TagIndex *index = tag_index_new();
+  EditorPage *pages[4];
+
+  pages[0] = tagged(index, "One", "work,done");
+  pages[1] = tagged(index, "Two", "work");
+  pages[2] = tagged(index, "Three", "home,Not done yet");
+  pages[3] = tagged(index, "Four", "home,work");
+
+  g_assert_cmpuint(count(index, "work"), ==, 3);
+  g_assert_cmpuint(count(index, "work and not done"), ==, 2);
+  g_assert_cmpuint(count(index, "work -done home"), ==, 1);
+  g_assert_cmpuint(count(index, "done | home"), ==, 3);
+  g_assert_cmpuint(count(index, "(done or home) and work"), ==, 2);
+  g_assert_cmpuint(count(index, "\"Not done yet\""), ==, 1);
+  g_assert_cmpuint(count(index, "missing"), ==, 0);
+  g_assert_cmpuint(count(index, "not missing"), ==, 4);
+
+  /* New tags replace the old ones */
+  g_ptr_array_set_size(pages[0]->tags, 0);
+  g_ptr_array_add(pages[0]->tags, g_ref_string_new_intern("home"));
+  tag_index_set_page_tags(index, pages[0], pages[0]->tags);
+  g_assert_cmpuint(count(index, "done"), ==, 0);
+  g_assert_cmpuint(count(index, "home"), ==, 3);
+
+  tag_index_remove_page(index, pages[3]);
+  g_assert_cmpuint(count(index, "not missing"), ==, 3);
+
+  tag_index_free(index);
+  for (guint i = 0; i < G_N_ELEMENTS(pages); i++) {
+    g_object_unref(pages[i]);
+  }
+}
+
+void
+test_tags_syntax(void)
+{
+  TagIndex *index = tag_index_new();
+  GError *lerr = NULL;
+
+  g_assert_null(tag_index_filter(index, "(work", &lerr));
+  g_assert_error(lerr, TAG_INDEX_ERROR, TAG_INDEX_ERROR_SYNTAX);
+  g_clear_error(&lerr);
+
+  g_assert_null(tag_index_filter(index, "work or", &lerr));
+  g_assert_error(lerr, TAG_INDEX_ERROR, TAG_INDEX_ERROR_SYNTAX);
+  g_clear_error(&lerr);
+
+  tag_index_free(index);
+}
+
+static void
+record_position(G_GNUC_UNUSED GListModel *model,
+                guint position,
+                guint removed,
+                guint added,
+                GArray *positions)
+{
+  g_assert_cmpuint(removed, ==, 0);
+  g_assert_cmpuint(added, ==, 1);
+  g_array_append_val(positions, position);
+}
+
+void
+test_tags_model(void)
+{
+  NotesTag *tag = notes_tag_new("work");
+  GArray *positions = g_array_new(FALSE, FALSE, sizeof(guint));
+  const gchar *headings[] = { "Charlie", "Alpha", "Delta", "Bravo" };
+  const guint expected[] = { 0, 0, 2, 1 };
+  EditorPage *pages[G_N_ELEMENTS(headings)];
+  EditorPage *page;
+
+  g_signal_connect(tag, "items-changed", G_CALLBACK(record_position),
+                   positions);
+
+  for (guint i = 0; i < G_N_ELEMENTS(headings); i++) {
+    pages[i] = editor_page_new(headings[i], NULL, NULL, NULL, NULL, NULL);
+    notes_tag_add_page(tag, pages[i]);
+  }
+
+  /* Added twice, listed once */
+  notes_tag_add_page(tag, pages[0]);
+
+  g_assert_cmpuint(positions->len, ==, G_N_ELEMENTS(expected));
+  for (guint i = 0; i < G_N_ELEMENTS(expected); i++) {
+    g_assert_cmpuint(g_array_index(positions, guint, i), ==, expected[i]);
+  }
+
+  g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(tag)), ==, 4);
+  page = g_list_model_get_item(G_LIST_MODEL(tag), 1);
+  g_assert_cmpstr(page->heading, ==, "Bravo");
+  g_object_unref(page);
+
+  g_object_unref(tag);
+  g_array_unref(positions);
+  for (guint i = 0; i < G_N_ELEMENTS(pages); i++) {
+    g_object_unref(pages[i]);
+  }
+}
+
+/* Position, removed and added of every change, one after the other */
+static void
+record_move(G_GNUC_UNUSED GListModel *model,
+            guint position,
+            guint removed,
+            guint added,
+            GArray *changes)
+{
+  g_array_append_val(changes, position);
+  g_array_append_val(changes, removed);
+  g_array_append_val(changes, added);
+}
+
+/* A renamed page moves to where it sorts, one removal and one insertion */
+void
+test_tags_rename(void)
+{
+  NotesTag *tag = notes_tag_new("work");
+  GArray *changes = g_array_new(FALSE, FALSE, sizeof(guint));
+  const gchar *headings[] = { "Alpha", "Bravo", "Charlie" };
+  const guint expected[] = { 0, 1, 0, 2, 0, 1 };
+  EditorPage *pages[G_N_ELEMENTS(headings)];
+  EditorPage *page;
+
+  for (guint i = 0; i < G_N_ELEMENTS(headings); i++) {
+    pages[i] = editor_page_new(headings[i], NULL, NULL, NULL, NULL, NULL);
+    notes_tag_add_page(tag, pages[i]);
+  }
+
+  g_signal_connect(tag, "items-changed", G_CALLBACK(record_move), changes);
+
+  g_object_set(pages[0], "heading", "Delta", NULL);
+  g_assert_cmpuint(changes->len, ==, 6);
+  for (guint i = 0; i < 6; i++) {
+    g_assert_cmpuint(g_array_index(changes, guint, i), ==, expected[i]);
+  }
+
+  /* Stays in place, nothing to tell the views */
+  g_object_set(pages[1], "heading", "Bravo two", NULL);
+  g_assert_cmpuint(changes->len, ==, 6);
+
+  page = g_list_model_get_item(G_LIST_MODEL(tag), 2);
+  g_assert_true(page == pages[0]);
+  g_object_unref(page);
+
+  /* Found where it sorts now, removing it empties nothing else */
+  g_assert_false(notes_tag_remove_page(tag, pages[0]));
+  g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(tag)), ==, 2);
+
+  /* No longer listed, no longer followed */
+  g_array_set_size(changes, 0);
+  g_object_set(pages[0], "heading", "Aardvark", NULL);
+  g_assert_cmpuint(changes->len, ==, 0);
+
+  g_object_unref(tag);
+  g_array_unref(changes);
+  for (guint i = 0; i < G_N_ELEMENTS(pages); i++) {
+    g_object_unref(pages[i]);
+  }
+}
+
+static void
+record_change(G_GNUC_UNUSED GListModel *model,
+              guint position,
+              guint removed,
+              guint added,
+              guint *n_changes)
+{
+  g_assert_cmpuint(position, ==, 0);
+  g_assert_cmpuint(removed, ==, 0);
+  g_assert_cmpuint(added, ==, 3);
+  (*n_changes)++;
+}
+
+void
+test_tags_bulk(void)
+{
+  NotesTag *tag = notes_tag_new("work");
+  const gchar *headings[] = { "Charlie", "Alpha", "Bravo" };
+  EditorPage *pages[G_N_ELEMENTS(headings)];
+  EditorPage *page;
+  guint n_changes = 0;
+
+  g_signal_connect(tag, "items-changed", G_CALLBACK(record_change),
+                   &n_changes);
+
+  notes_tag_begin_update(tag);
+  for (guint i = 0; i < G_N_ELEMENTS(headings); i++) {
+    pages[i] = editor_page_new(headings[i], NULL, NULL, NULL, NULL, NULL);
+    notes_tag_add_page(tag, pages[i]);
+  }
+  notes_tag_add_page(tag, pages[0]);
+
+  g_assert_cmpuint(n_changes, ==, 0);
+  g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(tag)), ==, 0);
+
+  notes_tag_end_update(tag);
+  g_assert_cmpuint(n_changes, ==, 1);
+  g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(tag)), ==, 3);
+
+  page = g_list_model_get_item(G_LIST_MODEL(tag), 0);
+  g_assert_cmpstr(page->heading, ==, "Alpha");
+  g_object_unref(page);
+
+  g_object_unref(tag);
+  for (guint i = 0; i < G_N_ELEMENTS(pages); i++) {
+    g_object_unref(pages[i]);
+  }
+}
+
+void
+test_tags_interned(void)
+{
+  TagIndex *index = tag_index_new();
+  EditorPage *a = tagged(index, "A", "work,home");
+  EditorPage *b = tagged(index, "B", "work");
+  EditorPage *c = editor_page_new("C", NULL, NULL, NULL, NULL, NULL);
+  EditorPage *d = editor_page_new("C", NULL, NULL, NULL, NULL, NULL);
+
+  /* One copy of a name, whichever page it came from */
+  g_assert_true(a->tags->pdata[0] == b->tags->pdata[0]);
+  g_assert_true(c->tags->pdata[0] == d->tags->pdata[0]);
+  g_assert_true(c->heading == d->heading);
+
+  g_object_unref(a);
+  g_object_unref(b);
+  g_object_unref(c);
+  g_object_unref(d);
+  tag_index_free(index);
+}
+
+void
+test_tags_single(void)
+{
+  TagIndex *index = tag_index_new();
+  EditorPage *a = tagged(index, "A", "work,home");
+  EditorPage *b = tagged(index, "B", "work");
+  GPtrArray *others;
+
+  tag_index_set_page_tag(index, b, "home", TRUE);
+  g_assert_cmpuint(count(index, "home"), ==, 2);
+
+  /* Twice is once */
+  tag_index_set_page_tag(index, a, "work", TRUE);
+  tag_index_set_page_tag(index, a, "work", FALSE);
+  g_assert_cmpuint(count(index, "work"), ==, 1);
+  g_assert_cmpuint(count(index, "work and home"), ==, 1);
+
+  /* Tags added one at a time are cleared when the page gets new ones */
+  others = g_ptr_array_new_with_free_func(
+    (GDestroyNotify) g_ref_string_release);
+  g_ptr_array_add(others, g_ref_string_new_intern("other"));
+  tag_index_set_page_tags(index, b, others);
+  g_assert_cmpuint(count(index, "home"), ==, 1);
+  g_assert_cmpuint(count(index, "work"), ==, 0);
+
+  g_ptr_array_unref(others);
+  g_object_unref(a);
+  g_object_unref(b);
+  tag_index_free(index);
+}
+
+int
+main(int argc, char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/tags/filter", test_tags_filter);
+  g_test_add_func("/tags/syntax", test_tags_syntax);
+  g_test_add_func("/tags/model", test_tags_model);
+  g_test_add_func("/tags/rename", test_tags_rename);
+  g_test_add_func("/tags/bulk", test_tags_bulk);
+  g_test_add_func("/tags/interned", test_tags_interned);
+  g_test_add_func("/tags/single", test_tags_single);
+
+  return g_test_run();
+}
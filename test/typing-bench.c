@@ -0,0 +1,328 @@
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "editor_page.h"
+
+/* Replays keystrokes through the GtkTextBuffer API of a loaded page, so the
+ * insert-text handler and everything else attached to the buffer runs as it
+ * does while typing. No widget is created, so no display is needed. */
+
+enum bench_op {
+  BENCH_OP_CHAR = 0,
+  BENCH_OP_LINK,
+  BENCH_OP_DELETE,
+  BENCH_OP_STYLE,
+  BENCH_OP_LAST
+};
+
+static const gchar *op_names[BENCH_OP_LAST] = { "char", "link", "delete",
+                                                "style" };
+
+struct bench_step {
+  enum bench_op op;
+  gchar *arg;
+};
+
+static gint page_lines = 2000;
+static gint n_ops = 20000;
+static gint seed = 42;
+static gchar *replay_file = NULL;
+
+static GOptionEntry entries[] = {
+  { "lines", 'l', 0, G_OPTION_ARG_INT, &page_lines,
+    "Lines of markdown in the page", "N" },
+  { "ops", 'n', 0, G_OPTION_ARG_INT, &n_ops,
+    "Number of synthetic operations", "N" },
+  { "seed", 's', 0, G_OPTION_ARG_INT, &seed, "Seed for the synthetic stream",
+    "N" },
+  { "replay", 'r', 0, G_OPTION_ARG_FILENAME, &replay_file,
+    "Replay a recorded stream, one \"char|link|delete|style [arg]\" per line",
+    "FILE" },
+  { NULL }
+};
+
+static EditorPage *
+fetch_page(const gchar *heading, gpointer user_data)
+{
+  GHashTable *pages = (GHashTable *) user_data;
+
+  return g_hash_table_lookup(pages, heading);
+}
+
+static void
+page_created(EditorPage *page, GHashTable *pages)
+{
+  g_hash_table_insert(pages, g_strdup(page->heading), page);
+}
+
+static gchar *
+build_page(gint lines)
+{
+  GString *md = g_string_new("---\ntitle: \"Benchmark\"\ndraft: true\n"
+                             "tags:\n  - Bench\n---\n");
+
+  for (gint i = 0; i < lines; i++) {
+    switch (i % 10) {
+    case 0:
+      g_string_append_printf(md, "## Section %d\n", i / 10);
+      break;
+    case 3:
+      g_string_append_printf(md, "See [[Page %d]] for the **details** of "
+                                 "item %d.\n",
+                             i % 50, i);
+      break;
+    case 6:
+      g_string_append(md, "````\nsome_code(with, arguments);\n````\n");
+      break;
+    default:
+      g_string_append(md, "Lorem ipsum dolor sit amet, consectetur "
+                          "adipiscing elit, sed do eiusmod tempor.\n");
+      break;
+    }
+  }
+
+  return g_string_free(md, FALSE);
+}
+
+static GArray *
+synthetic_steps(gint n)
+{
+  GArray *steps = g_array_new(FALSE, TRUE, sizeof(struct bench_step));
+  GRand *rand = g_rand_new_with_seed(seed);
+  const gchar *letters = "etaoin shrdlu";
+
+  for (gint i = 0; i < n; i++) {
+    struct bench_step step = { 0 };
+    gint roll = g_rand_int_range(rand, 0, 100);
+
+    if (roll < 80) {
+      step.op = BENCH_OP_CHAR;
+      step.arg = g_strndup(letters + g_rand_int_range(rand, 0, 13), 1);
+    } else if (roll < 85) {
+      step.op = BENCH_OP_LINK;
+      step.arg = g_strdup_printf("Page %d", g_rand_int_range(rand, 0, 100));
+    } else if (roll < 95) {
+      step.op = BENCH_OP_DELETE;
+    } else {
+      step.op = BENCH_OP_STYLE;
+    }
+
+    g_array_append_val(steps, step);
+  }
+
+  g_rand_free(rand);
+  return steps;
+}
+
+static GArray *
+load_steps(const gchar *file)
+{
+  GError *lerr = NULL;
+  GArray *steps;
+  gchar *content;
+  gchar **lines;
+
+  if (!g_file_get_contents(file, &content, NULL, &lerr)) {
+    g_printerr("Could not read %s: %s\n", file, lerr->message);
+    g_clear_error(&lerr);
+    return NULL;
+  }
+
+  steps = g_array_new(FALSE, TRUE, sizeof(struct bench_step));
+  lines = g_strsplit(content, "\n", -1);
+
+  for (guint i = 0; lines[i] != NULL; i++) {
+    struct bench_step step = { 0 };
+    gchar **parts = g_strsplit(lines[i], " ", 2);
+
+    if (parts[0] == NULL) {
+      g_strfreev(parts);
+      continue;
+    }
+
+    for (step.op = 0; step.op < BENCH_OP_LAST; step.op++) {
+      if (g_strcmp0(parts[0], op_names[step.op]) == 0) {
+        break;
+      }
+    }
+
+    if (step.op != BENCH_OP_LAST) {
+      step.arg = g_strdup(parts[1] != NULL ? parts[1] : "x");
+      g_array_append_val(steps, step);
+    }
+
+    g_strfreev(parts);
+  }
+
+  g_strfreev(lines);
+  g_free(content);
+  return steps;
+}
+
+static void
+run_idle(void)
+{
+  /* Links are turned into anchors from an idle callback */
+  while (g_main_context_pending(NULL)) {
+    g_main_context_iteration(NULL, FALSE);
+  }
+}
+
+static void
+type_text(GtkTextBuffer *buffer, const gchar *text)
+{
+  for (const gchar *c = text; *c != '\0'; c = g_utf8_next_char(c)) {
+    gtk_text_buffer_insert_interactive_at_cursor(
+      buffer, c, g_utf8_next_char(c) - c, TRUE);
+  }
+}
+
+static void
+run_step(EditorPage *page, struct bench_step *step)
+{
+  GtkTextBuffer *buffer = page->content;
+  GtkTextIter iter;
+  GtkTextIter start;
+  gchar *link;
+
+  gtk_text_buffer_get_iter_at_mark(buffer, &iter,
+                                   gtk_text_buffer_get_insert(buffer));
+
+  switch (step->op) {
+  case BENCH_OP_CHAR:
+    type_text(buffer, step->arg);
+    break;
+
+  case BENCH_OP_LINK:
+    link = g_strdup_printf("[[%s]]", step->arg);
+    type_text(buffer, link);
+    run_idle();
+    g_free(link);
+    break;
+
+  case BENCH_OP_DELETE:
+    gtk_text_buffer_backspace(buffer, &iter, TRUE, TRUE);
+    break;
+
+  case BENCH_OP_STYLE:
+    start = iter;
+    gtk_text_iter_backward_chars(&start, 10);
+    gtk_text_buffer_select_range(buffer, &start, &iter);
+    editor_page_update_style(page, STYLE_BOLD);
+    gtk_text_buffer_get_iter_at_mark(buffer, &iter,
+                                     gtk_text_buffer_get_selection_bound(
+                                       buffer));
+    gtk_text_buffer_place_cursor(buffer, &iter);
+    break;
+
+  default:
+    break;
+  }
+}
+
+static gint
+double_cmp(gconstpointer a, gconstpointer b)
+{
+  gdouble da = *((gdouble *) a);
+  gdouble db = *((gdouble *) b);
+
+  return (da > db) - (da < db);
+}
+
+static void
+report(enum bench_op op, GArray *samples)
+{
+  gdouble p50;
+  gdouble p99;
+  gdouble max;
+
+  if (samples->len == 0) {
+    return;
+  }
+
+  g_array_sort(samples, double_cmp);
+
+  p50 = g_array_index(samples, gdouble, samples->len / 2);
+  p99 = g_array_index(samples, gdouble, (samples->len * 99) / 100);
+  max = g_array_index(samples, gdouble, samples->len - 1);
+
+  g_print("%-8s %8u ops  p50 %10.2f us  p99 %10.2f us  max %10.2f us\n",
+          op_names[op], samples->len, p50 * G_USEC_PER_SEC,
+          p99 * G_USEC_PER_SEC, max * G_USEC_PER_SEC);
+}
+
+int
+main(int argc, char *argv[])
+{
+  GError *lerr = NULL;
+  GOptionContext *context;
+  GHashTable *pages;
+  EditorPage *page;
+  GArray *steps;
+  GArray *samples[BENCH_OP_LAST];
+  GTimer *timer;
+  GtkTextIter end;
+  gchar *md;
+
+  context = g_option_context_new("- typing latency of a page buffer");
+  g_option_context_add_main_entries(context, entries, NULL);
+  if (!g_option_context_parse(context, &argc, &argv, &lerr)) {
+    g_printerr("%s\n", lerr->message);
+    g_clear_error(&lerr);
+    return 1;
+  }
+  g_option_context_free(context);
+
+  pages = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+  md = build_page(page_lines);
+  /* Loading and the fixups after it, what opening the file costs */
+  timer = g_timer_new();
+  page = editor_page_load(md, fetch_page, pages, G_CALLBACK(page_created),
+                          pages);
+  editor_page_fix_content(page);
+  g_print("Loaded %d lines, %d chars in %.1f ms\n", page_lines,
+          gtk_text_buffer_get_char_count(page->content),
+          g_timer_elapsed(timer, NULL) * 1000);
+  g_free(md);
+
+  if (replay_file != NULL) {
+    steps = load_steps(replay_file);
+    if (steps == NULL) {
+      return 1;
+    }
+  } else {
+    steps = synthetic_steps(n_ops);
+  }
+
+  for (gint i = 0; i < BENCH_OP_LAST; i++) {
+    samples[i] = g_array_new(FALSE, FALSE, sizeof(gdouble));
+  }
+
+  gtk_text_buffer_get_end_iter(page->content, &end);
+  gtk_text_buffer_place_cursor(page->content, &end);
+
+  for (guint i = 0; i < steps->len; i++) {
+    struct bench_step *step = &g_array_index(steps, struct bench_step, i);
+    gdouble elapsed;
+
+    g_timer_start(timer);
+    run_step(page, step);
+    elapsed = g_timer_elapsed(timer, NULL);
+
+    g_array_append_val(samples[step->op], elapsed);
+  }
+
+  for (gint i = 0; i < BENCH_OP_LAST; i++) {
+    report(i, samples[i]);
+    g_array_unref(samples[i]);
+  }
+
+  for (guint i = 0; i < steps->len; i++) {
+    g_free(g_array_index(steps, struct bench_step, i).arg);
+  }
+  g_array_unref(steps);
+  g_timer_destroy(timer);
+
+  return 0;
+}